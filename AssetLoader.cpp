@@ -0,0 +1,295 @@
+#include "AssetLoader.h"
+#include "MeshBuilder.h"
+#include <wincodec.h>
+
+// --------------------------------------------------------
+// WIC pixel formats kept as they are, because a DXGI format
+// with the same layout can generate mips
+// --------------------------------------------------------
+struct WICFormatMapping
+{
+	const GUID* wicFormat;
+	DXGI_FORMAT format;
+	unsigned int bitsPerPixel;
+};
+
+static const WICFormatMapping WICFormats[] = {
+	{ &GUID_WICPixelFormat32bppRGBA, DXGI_FORMAT_R8G8B8A8_UNORM, 32 },
+	{ &GUID_WICPixelFormat32bppBGRA, DXGI_FORMAT_B8G8R8A8_UNORM, 32 },
+	{ &GUID_WICPixelFormat64bppRGBA, DXGI_FORMAT_R16G16B16A16_UNORM, 64 },
+	{ &GUID_WICPixelFormat16bppGray, DXGI_FORMAT_R16_UNORM, 16 },
+	{ &GUID_WICPixelFormat8bppGray, DXGI_FORMAT_R8_UNORM, 8 } };
+
+// --------------------------------------------------------
+// Whether the file's metadata says its colors are sRGB: a
+// PNG's sRGB chunk, or the EXIF color space of a JPEG or
+// TIFF.  Files that say nothing load as linear.
+// --------------------------------------------------------
+static bool IsSRGB(IWICBitmapDecoder* decoder, IWICBitmapFrameDecode* frame)
+{
+	GUID container = {};
+	Microsoft::WRL::ComPtr<IWICMetadataQueryReader> metadata;
+	if (FAILED(decoder->GetContainerFormat(&container)) || FAILED(frame->GetMetadataQueryReader(metadata.GetAddressOf())))
+		return false;
+
+	PROPVARIANT value;
+	PropVariantInit(&value);
+
+	bool sRGB = false;
+	if (container == GUID_ContainerFormatPng)
+	{
+		sRGB = SUCCEEDED(metadata->GetMetadataByName(L"/sRGB/RenderingIntent", &value));
+	}
+	else if (container == GUID_ContainerFormatJpeg || container == GUID_ContainerFormatTiff)
+	{
+		const wchar_t* colorSpace = container == GUID_ContainerFormatJpeg ? L"/app1/ifd/exif/{ushort=40961}" : L"/ifd/exif/{ushort=40961}";
+		sRGB = SUCCEEDED(metadata->GetMetadataByName(colorSpace, &value)) && value.vt == VT_UI2 && value.uiVal == 1;
+	}
+
+	PropVariantClear(&value);
+	return sRGB;
+}
+
+AssetLoader::AssetLoader(unsigned int workerCount)
+	: jobs(workerCount)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+}
+
+unsigned int AssetLoader::GetWorkerCount()
+{
+	return jobs.GetThreadCount();
+}
+
+// --------------------------------------------------------
+// Queues a mesh file to be decoded (from its cache when
+// possible) on a worker thread
+// --------------------------------------------------------
+std::future<MeshData> AssetLoader::LoadMeshData(std::string filename)
+{
+	return jobs.Submit([filename]()
+	{
+		MeshData meshData;
+		MeshBuilder::LoadMeshData(filename.c_str(), meshData);
+		return meshData;
+	});
+}
+
+// --------------------------------------------------------
+// Queues an image file to be decoded on a worker thread
+// --------------------------------------------------------
+std::future<ImageData> AssetLoader::LoadImageData(std::wstring filename)
+{
+	return jobs.Submit([filename]()
+	{
+		ImageData image;
+		DecodeImage(filename.c_str(), image);
+		return image;
+	});
+}
+
+// --------------------------------------------------------
+// Decodes any WIC-supported image file, the way DirectXTK's
+// CreateWICTextureFromFile() does
+//
+// - Formats with a DXGI equivalent (see WICFormats) are
+//   kept, so grayscale maps stay one channel; anything else
+//   becomes 32-bit RGBA
+// - Only files whose metadata says sRGB get an _SRGB format,
+//   as before.  None of the game's do: the shaders linearize
+//   albedo and sky colors themselves.
+// - Images larger than maxSize on either side are scaled
+//   down to fit, keeping their aspect ratio
+//
+// Requires COM to be initialized on the calling thread,
+// which is always the case on JobSystem workers
+// --------------------------------------------------------
+bool AssetLoader::DecodeImage(const wchar_t* filename, ImageData& image, unsigned int maxSize)
+{
+	Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+	HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()));
+	if (FAILED(hr)) return false;
+
+	Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+	hr = factory->CreateDecoderFromFilename(filename, 0, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+	if (FAILED(hr)) return false;
+
+	Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+	hr = decoder->GetFrame(0, frame.GetAddressOf());
+	if (FAILED(hr)) return false;
+
+	Microsoft::WRL::ComPtr<IWICBitmapSource> source = frame;
+
+	UINT width = 0, height = 0;
+	hr = frame->GetSize(&width, &height);
+	if (FAILED(hr) || width == 0 || height == 0) return false;
+
+	// Too big for a texture, so shrink the longer side to fit
+	if (width > maxSize || height > maxSize)
+	{
+		float aspectRatio = (float)height / width;
+		if (width > height)
+		{
+			width = maxSize;
+			height = (UINT)(maxSize * aspectRatio);
+		}
+		else
+		{
+			height = maxSize;
+			width = (UINT)(maxSize / aspectRatio);
+		}
+		if (width == 0) width = 1;
+		if (height == 0) height = 1;
+
+		Microsoft::WRL::ComPtr<IWICBitmapScaler> scaler;
+		hr = factory->CreateBitmapScaler(scaler.GetAddressOf());
+		if (FAILED(hr)) return false;
+
+		hr = scaler->Initialize(frame.Get(), width, height, WICBitmapInterpolationModeFant);
+		if (FAILED(hr)) return false;
+
+		source = scaler;
+	}
+
+	WICPixelFormatGUID sourceFormat = {};
+	hr = source->GetPixelFormat(&sourceFormat);
+	if (FAILED(hr)) return false;
+
+	const WICFormatMapping* mapping = &WICFormats[0];
+	for (unsigned int i = 0; i < ARRAYSIZE(WICFormats); i++)
+	{
+		if (*WICFormats[i].wicFormat == sourceFormat)
+		{
+			mapping = &WICFormats[i];
+			break;
+		}
+	}
+
+	// No DXGI equivalent, so convert to RGBA (the first entry)
+	if (*mapping->wicFormat != sourceFormat)
+	{
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		hr = factory->CreateFormatConverter(converter.GetAddressOf());
+		if (FAILED(hr)) return false;
+
+		hr = converter->Initialize(source.Get(), *mapping->wicFormat, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeCustom);
+		if (FAILED(hr)) return false;
+
+		source = converter;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.rowPitch = (width * mapping->bitsPerPixel + 7) / 8;
+	image.format = mapping->format;
+	image.pixels.resize((size_t)image.rowPitch * height);
+
+	if (IsSRGB(decoder.Get(), frame.Get()))
+	{
+		if (image.format == DXGI_FORMAT_R8G8B8A8_UNORM) image.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		if (image.format == DXGI_FORMAT_B8G8R8A8_UNORM) image.format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	}
+
+	hr = source->CopyPixels(0, image.rowPitch, (UINT)image.pixels.size(), &image.pixels[0]);
+	return SUCCEEDED(hr);
+}
+
+// --------------------------------------------------------
+// Creates a texture with a full mip chain from a decoded image
+//
+// The context is needed to generate the mips, so this
+// must be called from the thread that owns the context
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::CreateTexture(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const ImageData& image)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (image.pixels.empty())
+		return srv;
+
+	// Mips are generated on the GPU, so the texture
+	// must also be usable as a render target
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = image.width;
+	textureDesc.Height = image.height;
+	textureDesc.MipLevels = 0; // Full chain
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = image.format;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(device->CreateTexture2D(&textureDesc, 0, texture.GetAddressOf())))
+		return srv;
+
+	device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf());
+
+	// Upload the top mip and let the GPU fill in the rest
+	context->UpdateSubresource(texture.Get(), 0, 0, &image.pixels[0], image.rowPitch, 0);
+	context->GenerateMips(srv.Get());
+
+	return srv;
+}
+
+// --------------------------------------------------------
+// Creates a cube map from six decoded faces, in the order
+// +X, -X, +Y, -Y, +Z, -Z
+//
+// Fails unless all faces have the same resolution and format.
+// Only needs the device, so it is safe to call from any thread.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::CreateCubemap(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	const ImageData faces[6])
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
+
+	// Each face becomes one array slice of the initial data
+	D3D11_SUBRESOURCE_DATA faceData[6] = {};
+	for (int i = 0; i < 6; i++)
+	{
+		if (faces[i].pixels.empty() ||
+			faces[i].width != faces[0].width ||
+			faces[i].height != faces[0].height ||
+			faces[i].format != faces[0].format)
+			return cubeSRV;
+
+		faceData[i].pSysMem = &faces[i].pixels[0];
+		faceData[i].SysMemPitch = faces[i].rowPitch;
+	}
+
+	// Describe the resource for the cube map, which is simply
+	// a "texture 2d array" with the TEXTURECUBE flag
+	D3D11_TEXTURE2D_DESC cubeDesc = {};
+	cubeDesc.ArraySize = 6; // Cube map!
+	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	cubeDesc.CPUAccessFlags = 0;
+	cubeDesc.Format = faces[0].format;
+	cubeDesc.Width = faces[0].width;
+	cubeDesc.Height = faces[0].height;
+	cubeDesc.MipLevels = 1; // Only need 1
+	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	cubeDesc.SampleDesc.Count = 1;
+	cubeDesc.SampleDesc.Quality = 0;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
+	if (FAILED(device->CreateTexture2D(&cubeDesc, faceData, cubeMapTexture.GetAddressOf())))
+		return cubeSRV;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = cubeDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	srvDesc.TextureCube.MipLevels = 1;
+	srvDesc.TextureCube.MostDetailedMip = 0;
+	device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, cubeSRV.GetAddressOf());
+
+	return cubeSRV;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <future>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// A decoded image, in the DXGI format closest to the file's
+// own (see AssetLoader::DecodeImage)
+// --------------------------------------------------------
+struct ImageData
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int rowPitch = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	std::vector<unsigned char> pixels;
+};
+
+// --------------------------------------------------------
+// Loads assets in two stages:
+//
+// - Decode: file reading and parsing into CPU-side data,
+//   done on a worker pool.  LoadMeshData() and LoadImageData()
+//   return futures, and need no Direct3D device at all
+// - Create: turning decoded data into Direct3D resources,
+//   done on the calling thread by the static Create*() helpers
+// --------------------------------------------------------
+class AssetLoader {
+public:
+	AssetLoader(unsigned int workerCount = 0);
+	~AssetLoader();
+
+	// Decode stage
+	std::future<MeshData> LoadMeshData(std::string filename);
+	std::future<ImageData> LoadImageData(std::wstring filename);
+	unsigned int GetWorkerCount();
+
+	static bool DecodeImage(const wchar_t* filename, ImageData& image, unsigned int maxSize = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION);
+
+	// Create stage
+	static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateTexture(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const ImageData& image);
+
+	static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		const ImageData faces[6]);
+
+private:
+	JobSystem jobs;
+};
@@ -0,0 +1,154 @@
+#include "AutoExposure.h"
+#include <math.h>
+
+AutoExposure::AutoExposure(const AutoExposureSettings& settings)
+{
+	this->settings = settings;
+	this->Reset();
+}
+
+// --------------------------------------------------------
+// Starts out exposed at 1, like AutoExposureCS's buffer
+// --------------------------------------------------------
+void AutoExposure::Reset()
+{
+	this->adaptedLog2Luminance = GetInitialLog2Luminance(this->settings);
+	this->exposure = GetExposure(this->adaptedLog2Luminance, this->settings);
+}
+
+// --------------------------------------------------------
+// One frame of adaptation to the image, the way one
+// AutoExposureCS dispatch does it
+// --------------------------------------------------------
+void AutoExposure::Update(const BloomImage& image, float deltaTime)
+{
+	unsigned int histogram[BinCount];
+	BuildHistogram(image, this->settings, histogram);
+
+	float target = AverageLog2Luminance(histogram, this->settings);
+	this->adaptedLog2Luminance = Adapt(
+		this->adaptedLog2Luminance,
+		target,
+		GetAdaptation(deltaTime, this->settings.brightenSpeed),
+		GetAdaptation(deltaTime, this->settings.darkenSpeed));
+	this->exposure = GetExposure(this->adaptedLog2Luminance, this->settings);
+}
+
+float AutoExposure::GetExposure()
+{
+	return this->exposure;
+}
+
+float AutoExposure::GetAdaptedLog2Luminance()
+{
+	return this->adaptedLog2Luminance;
+}
+
+// --------------------------------------------------------
+// Distance between samples, in texels, so neither side has
+// more than MaxSamplesPerSide
+// --------------------------------------------------------
+unsigned int AutoExposure::GetSampleStep(unsigned int width, unsigned int height)
+{
+	unsigned int size = width > height ? width : height;
+	unsigned int step = (size + MaxSamplesPerSide - 1) / MaxSamplesPerSide;
+	return step > 0 ? step : 1;
+}
+
+// --------------------------------------------------------
+// How far to move toward the target this frame, so that
+// adapting doesn't depend on the frame rate
+// --------------------------------------------------------
+float AutoExposure::GetAdaptation(float deltaTime, float speed)
+{
+	return 1.0f - expf(-deltaTime * speed);
+}
+
+float AutoExposure::GetInitialLog2Luminance(const AutoExposureSettings& settings)
+{
+	return log2f(settings.key);
+}
+
+// --------------------------------------------------------
+// Rec. 709 luminance of a linear color
+// --------------------------------------------------------
+float AutoExposure::Luminance(const DirectX::XMFLOAT4& color)
+{
+	return color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f;
+}
+
+int AutoExposure::GetBin(float luminance, const AutoExposureSettings& settings)
+{
+	float range = settings.maxLog2Luminance - settings.minLog2Luminance;
+	if (!(luminance > 0.0f))
+		return 0;
+
+	float t = (log2f(luminance) - settings.minLog2Luminance) / range;
+	if (t <= 0.0f)
+		return 0;
+	if (t > 1.0f)
+		t = 1.0f;
+	return 1 + (int)(t * (BinCount - 2));
+}
+
+// --------------------------------------------------------
+// Counts the grid of samples AutoExposureCS reads into bins
+// --------------------------------------------------------
+void AutoExposure::BuildHistogram(const BloomImage& image, const AutoExposureSettings& settings, unsigned int* histogram)
+{
+	for (int b = 0; b < BinCount; b++)
+		histogram[b] = 0;
+
+	unsigned int step = GetSampleStep(image.width, image.height);
+	for (unsigned int y = 0; y < image.height / step; y++)
+	{
+		for (unsigned int x = 0; x < image.width / step; x++)
+			histogram[GetBin(Luminance(image.pixels[y * step * image.width + x * step]), settings)]++;
+	}
+}
+
+// --------------------------------------------------------
+// The average log2 luminance of the samples between the
+// low and high percentages, with each bin's samples taken
+// to be at the middle of the bin
+// --------------------------------------------------------
+float AutoExposure::AverageLog2Luminance(const unsigned int* histogram, const AutoExposureSettings& settings)
+{
+	unsigned int total = 0;
+	for (int b = 0; b < BinCount; b++)
+		total += histogram[b];
+
+	float low = total * settings.lowPercent;
+	float high = total * settings.highPercent;
+	float range = settings.maxLog2Luminance - settings.minLog2Luminance;
+
+	float below = 0.0f;
+	float weightedSum = 0.0f;
+	float weight = 0.0f;
+	for (int b = 0; b < BinCount; b++)
+	{
+		float count = (float)histogram[b];
+		float taken = fminf(fmaxf(below + count, low), high) - fminf(fmaxf(below, low), high);
+		float log2Luminance = b == 0 ?
+			settings.minLog2Luminance :
+			settings.minLog2Luminance + (b - 0.5f) / (BinCount - 2) * range;
+
+		weightedSum += taken * log2Luminance;
+		weight += taken;
+		below += count;
+	}
+
+	return weight > 0.0f ? weightedSum / weight : settings.minLog2Luminance;
+}
+
+float AutoExposure::Adapt(float adaptedLog2Luminance, float targetLog2Luminance, float brightenAdaptation, float darkenAdaptation)
+{
+	float adaptation = targetLog2Luminance > adaptedLog2Luminance ? brightenAdaptation : darkenAdaptation;
+	return adaptedLog2Luminance + (targetLog2Luminance - adaptedLog2Luminance) * adaptation;
+}
+
+float AutoExposure::GetExposure(float adaptedLog2Luminance, const AutoExposureSettings& settings)
+{
+	float exposure = settings.key / exp2f(adaptedLog2Luminance);
+	return fminf(fmaxf(exposure, settings.minExposure), settings.maxExposure);
+}
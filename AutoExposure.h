@@ -0,0 +1,69 @@
+#pragma once
+
+#include "BloomFilter.h"
+
+// --------------------------------------------------------
+// Tuning for AutoExposure, sent to AutoExposureCS as is
+// --------------------------------------------------------
+struct AutoExposureSettings
+{
+	float minLog2Luminance = -10.0f;	// Anything darker counts as this dark
+	float maxLog2Luminance = 6.0f;
+	float lowPercent = 0.5f;			// The darkest half of the screen is ignored...
+	float highPercent = 0.95f;			// ...and so are the brightest highlights
+	float key = 0.18f;					// What the average is exposed to
+	float minExposure = 0.03f;
+	float maxExposure = 16.0f;
+	float brightenSpeed = 3.0f;			// Adapting to a brighter scene, per second
+	float darkenSpeed = 1.0f;			// Adapting to a darker one (eyes are slower)
+};
+
+// --------------------------------------------------------
+// Exposure from a luminance histogram, adapted over time
+//
+// - Luminance is sampled on a grid of at most
+//   MaxSamplesPerSide texels each way, and each sample goes
+//   into one of BinCount bins, log2 spaced (bin 0 is for
+//   anything at or below minLog2Luminance)
+// - The average log2 luminance of the samples between
+//   lowPercent and highPercent, counting up from the
+//   darkest, is what the scene "is"
+// - The adapted luminance moves toward that exponentially,
+//   and the exposure maps it to the key
+//
+// AutoExposureCS does all of it in one dispatch of a single
+// group, keeping the state on the GPU, so the exposure is
+// never read back.  This is the same maths on the CPU, step
+// for step, for tests.  Needs no Direct3D device at all.
+// --------------------------------------------------------
+class AutoExposure {
+public:
+	// Must match the defines in AutoExposureCS.hlsl
+	static const int BinCount = 128;
+	static const unsigned int ThreadsPerSide = 32;
+	static const unsigned int MaxSamplesPerSide = 256;
+
+	AutoExposure(const AutoExposureSettings& settings);
+
+	void Reset();
+	void Update(const BloomImage& image, float deltaTime);
+
+	float GetExposure();
+	float GetAdaptedLog2Luminance();
+
+	static unsigned int GetSampleStep(unsigned int width, unsigned int height);
+	static float GetAdaptation(float deltaTime, float speed);
+	static float GetInitialLog2Luminance(const AutoExposureSettings& settings);
+
+	static float Luminance(const DirectX::XMFLOAT4& color);
+	static int GetBin(float luminance, const AutoExposureSettings& settings);
+	static void BuildHistogram(const BloomImage& image, const AutoExposureSettings& settings, unsigned int* histogram);
+	static float AverageLog2Luminance(const unsigned int* histogram, const AutoExposureSettings& settings);
+	static float Adapt(float adaptedLog2Luminance, float targetLog2Luminance, float brightenAdaptation, float darkenAdaptation);
+	static float GetExposure(float adaptedLog2Luminance, const AutoExposureSettings& settings);
+
+private:
+	AutoExposureSettings settings;
+	float adaptedLog2Luminance;
+	float exposure;
+};
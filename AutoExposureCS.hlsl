@@ -0,0 +1,90 @@
+// Must match AutoExposure in AutoExposure.h
+#define AUTO_EXPOSURE_BIN_COUNT			128
+#define AUTO_EXPOSURE_THREADS_PER_SIDE	32
+
+cbuffer externalData : register(b0) {
+	uint2 sampleCount;		// Grid samples each way
+	uint sampleStep;		// Texels between them
+	float minLog2Luminance;
+	float maxLog2Luminance;
+	float lowPercent;
+	float highPercent;
+	float key;
+	float minExposure;
+	float maxExposure;
+	float brightenAdaptation;	// How far to move toward the target
+	float darkenAdaptation;		// this frame, from 0 to 1
+}
+
+Texture2D source						: register(t0);
+RWStructuredBuffer<float> exposureState	: register(u0);	// Exposure, then the adapted log2 luminance
+
+groupshared uint histogram[AUTO_EXPOSURE_BIN_COUNT];
+
+int GetBin(float luminance)
+{
+	if (!(luminance > 0))
+		return 0;
+
+	float t = (log2(luminance) - minLog2Luminance) / (maxLog2Luminance - minLog2Luminance);
+	if (t <= 0)
+		return 0;
+	return 1 + (int)(min(t, 1) * (AUTO_EXPOSURE_BIN_COUNT - 2));
+}
+
+// --------------------------------------------------------
+// Builds a luminance histogram of the source, then adapts
+// the exposure toward its average, all in one group so the
+// exposure never has to be read back (see AutoExposure for
+// the CPU reference, and the details)
+// --------------------------------------------------------
+[numthreads(AUTO_EXPOSURE_THREADS_PER_SIDE, AUTO_EXPOSURE_THREADS_PER_SIDE, 1)]
+void main(uint3 threadID : SV_GroupThreadID, uint threadIndex : SV_GroupIndex)
+{
+	if (threadIndex < AUTO_EXPOSURE_BIN_COUNT)
+		histogram[threadIndex] = 0;
+	GroupMemoryBarrierWithGroupSync();
+
+	for (uint y = threadID.y; y < sampleCount.y; y += AUTO_EXPOSURE_THREADS_PER_SIDE)
+	{
+		for (uint x = threadID.x; x < sampleCount.x; x += AUTO_EXPOSURE_THREADS_PER_SIDE)
+		{
+			float3 color = source.Load(int3(uint2(x, y) * sampleStep, 0)).rgb;
+			InterlockedAdd(histogram[GetBin(dot(color, float3(0.2126f, 0.7152f, 0.0722f)))], 1);
+		}
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// A single walk over the bins is cheaper than syncing the
+	// group for a parallel one
+	if (threadIndex != 0)
+		return;
+
+	float total = (float)(sampleCount.x * sampleCount.y);
+	float low = total * lowPercent;
+	float high = total * highPercent;
+	float range = maxLog2Luminance - minLog2Luminance;
+
+	float below = 0;
+	float weightedSum = 0;
+	float weight = 0;
+	for (int b = 0; b < AUTO_EXPOSURE_BIN_COUNT; b++)
+	{
+		float count = (float)histogram[b];
+		float taken = min(max(below + count, low), high) - min(max(below, low), high);
+		float log2Luminance = b == 0 ?
+			minLog2Luminance :
+			minLog2Luminance + (b - 0.5f) / (AUTO_EXPOSURE_BIN_COUNT - 2) * range;
+
+		weightedSum += taken * log2Luminance;
+		weight += taken;
+		below += count;
+	}
+	float target = weight > 0 ? weightedSum / weight : minLog2Luminance;
+
+	float adapted = exposureState[1];
+	adapted += (target - adapted) * (target > adapted ? brightenAdaptation : darkenAdaptation);
+
+	exposureState[0] = clamp(key / exp2(adapted), minExposure, maxExposure);
+	exposureState[1] = adapted;
+}
@@ -0,0 +1,483 @@
+#include "Benchmarks.h"
+#include "MappedFile.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "ObjLoader.h"
+#include "ShaderArchive.h"
+#include "ShaderPermutations.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include "AssetLoader.h"
+#endif
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// The meshes the game loads
+static const char* MeshFiles[] = {
+	"cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj", "starship.obj" };
+static const unsigned int MeshFileCount = sizeof(MeshFiles) / sizeof(MeshFiles[0]);
+
+// --------------------------------------------------------
+// Parses an OBJ held in a string, for the malformed cases
+// --------------------------------------------------------
+static bool ParseObj(const char* text)
+{
+	MeshData meshData;
+	return ObjLoader::Parse(text, strlen(text), meshData);
+}
+
+// --------------------------------------------------------
+// Times ObjLoader::Load() on each of the game's OBJs,
+// straight from the file (the game itself usually reads the
+// mesh cache instead), reports how much deduplication saved,
+// and checks that malformed faces fail the load rather than
+// being cut short
+//
+// meshDirectory - Where the OBJs are, ending in a slash
+// --------------------------------------------------------
+bool BenchmarkObjLoader(const std::string& meshDirectory)
+{
+	const int runCount = 20;
+
+	bool passed = true;
+	for (unsigned int f = 0; f < MeshFileCount; f++)
+	{
+		std::string filename = meshDirectory + MeshFiles[f];
+
+		MeshData meshData;
+		bool loaded = true;
+		double startTime = GetTime();
+		for (int run = 0; run < runCount && loaded; run++)
+			loaded = ObjLoader::Load(filename.c_str(), meshData);
+		double endTime = GetTime();
+
+		if (!loaded)
+		{
+			printf("ObjLoader: %s failed to load (MISMATCH)\n", MeshFiles[f]);
+			passed = false;
+			continue;
+		}
+
+		unsigned long long fileSize = 0, modifiedTime = 0;
+		MappedFile::GetInfo(filename.c_str(), fileSize, modifiedTime);
+
+		// Deduplication only pays off if every corner still
+		// points at a vertex that exists
+		bool indicesValid = meshData.indices.size() % 3 == 0;
+		for (size_t i = 0; i < meshData.indices.size(); i++)
+			indicesValid = indicesValid && meshData.indices[i] < meshData.vertices.size();
+		passed = passed && indicesValid;
+
+		double seconds = (endTime - startTime) / runCount;
+		printf("ObjLoader: %s - %.3f ms, %.1f MB/s, %.0f vertices/s, %zu unique of %zu vertices (%.1fx smaller)%s\n",
+			MeshFiles[f],
+			seconds * 1000.0,
+			fileSize / (1024.0 * 1024.0) / seconds,
+			meshData.vertices.size() / seconds,
+			meshData.vertices.size(),
+			meshData.indices.size(),
+			meshData.vertices.empty() ? 0.0 : (double)meshData.indices.size() / meshData.vertices.size(),
+			indicesValid ? "" : " (MISMATCH)");
+	}
+
+	// A zero index, indices past the end (or before the start)
+	// and one too long for an int
+	const char* header = "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n";
+	const char* faces[] = {
+		"f 1 2 0\n",
+		"f 1 2 4\n",
+		"f 1 2 -4\n",
+		"f 1/1/1 2/2/1 3/1/1\n",
+		"f 1/1/1 2/1/2 3/1/1\n",
+		"f 1 2 99999999999999999999\n" };
+
+	const unsigned int faceCount = sizeof(faces) / sizeof(faces[0]);
+
+	bool wellFormedLoads = ParseObj((std::string(header) + "f 1/1/1 2/1/1 -1/-1/-1\n").c_str());
+	unsigned int rejected = 0;
+	for (unsigned int i = 0; i < faceCount; i++)
+	{
+		if (!ParseObj((std::string(header) + faces[i]).c_str()))
+			rejected++;
+	}
+
+	bool malformedRejected = wellFormedLoads && rejected == faceCount;
+	printf("ObjLoader: %u/%u malformed faces rejected%s\n",
+		rejected,
+		faceCount,
+		malformedRejected ? "" : " (MISMATCH)");
+	return passed && malformedRejected;
+}
+
+// --------------------------------------------------------
+// Largest difference between two sets of tangents.  A NaN
+// (from degenerate UVs) only matches another NaN, so one
+// that appears on just one side is an infinite difference.
+// --------------------------------------------------------
+static float MaxTangentDifference(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+{
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		const float* ta = &a[i].tangent.x;
+		const float* tb = &b[i].tangent.x;
+		for (int c = 0; c < 3; c++)
+		{
+			float difference = fabsf(ta[c] - tb[c]);
+			if (isnan(ta[c]) != isnan(tb[c]))
+				difference = INFINITY;
+			if (difference > maxDifference)
+				maxDifference = difference;
+		}
+	}
+	return maxDifference;
+}
+
+// --------------------------------------------------------
+// Times MeshBuilder::CalculateTangents() against the scalar
+// reference on each of the game's OBJs, and checks both
+// produce the same tangents.  Runs on the parsed OBJ, since
+// a mesh cache hit in the game skips tangents entirely.
+// Also compares them on a small mesh with a triangle whose
+// corners share one position and a vertex no triangle uses,
+// so both have zero-length tangents.
+//
+// meshDirectory - Where the OBJs are, ending in a slash
+// --------------------------------------------------------
+bool BenchmarkTangents(const std::string& meshDirectory)
+{
+	const int runCount = 20;
+
+	bool passed = true;
+	for (unsigned int f = 0; f < MeshFileCount; f++)
+	{
+		MeshData meshData;
+		if (!ObjLoader::Load((meshDirectory + MeshFiles[f]).c_str(), meshData))
+		{
+			printf("Tangents: %s failed to load (MISMATCH)\n", MeshFiles[f]);
+			passed = false;
+			continue;
+		}
+
+		int vertexCount = (int)meshData.vertices.size();
+		int indexCount = (int)meshData.indices.size();
+		std::vector<Vertex> referenceVertices = meshData.vertices;
+
+		double startTime = GetTime();
+		for (int run = 0; run < runCount; run++)
+			MeshBuilder::CalculateTangentsScalar(&referenceVertices[0], vertexCount, &meshData.indices[0], indexCount);
+		double scalarTime = GetTime();
+		for (int run = 0; run < runCount; run++)
+			MeshBuilder::CalculateTangents(&meshData.vertices[0], vertexCount, &meshData.indices[0], indexCount);
+		double simdTime = GetTime();
+
+		float maxDifference = MaxTangentDifference(meshData.vertices, referenceVertices);
+		passed = passed && maxDifference <= 0.0001f;
+
+		double triangles = indexCount / 3.0 * runCount;
+		double scalarSeconds = scalarTime - startTime;
+		double simdSeconds = simdTime - scalarTime;
+		printf("Tangents: %s - scalar %.2f Mtri/s, SSE %.2f Mtri/s, max difference %g%s\n",
+			MeshFiles[f],
+			scalarSeconds > 0 ? triangles / scalarSeconds / 1000000.0 : 0.0,
+			simdSeconds > 0 ? triangles / simdSeconds / 1000000.0 : 0.0,
+			maxDifference,
+			maxDifference > 0.0001f ? " (MISMATCH)" : "");
+	}
+
+	// A quad, then a triangle collapsed to a point (but with
+	// distinct UVs) and a vertex left out.  Five triangles, so
+	// both the four-wide loop and the leftover one see it.
+	std::vector<Vertex> degenerate(8);
+	const float corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	for (int i = 0; i < 8; i++)
+	{
+		const float* corner = corners[i % 4];
+		degenerate[i].position = i < 4 ? XMFLOAT3(corner[0], corner[1], 0) : XMFLOAT3(2, 2, 0);
+		degenerate[i].normal = XMFLOAT3(0, 0, -1);
+		degenerate[i].uv = XMFLOAT2(corner[0], 1 - corner[1]);
+	}
+	unsigned int degenerateIndices[] = { 0, 1, 2, 0, 2, 3, 4, 5, 6, 1, 2, 3, 4, 6, 5 };
+	int degenerateIndexCount = (int)(sizeof(degenerateIndices) / sizeof(degenerateIndices[0]));
+
+	std::vector<Vertex> referenceDegenerate = degenerate;
+	MeshBuilder::CalculateTangentsScalar(&referenceDegenerate[0], 8, degenerateIndices, degenerateIndexCount);
+	MeshBuilder::CalculateTangents(&degenerate[0], 8, degenerateIndices, degenerateIndexCount);
+
+	bool zeroLength = true;
+	for (int i = 4; i < 8; i++)
+	{
+		const XMFLOAT3& tangent = referenceDegenerate[i].tangent;
+		zeroLength = zeroLength && tangent.x == 0 && tangent.y == 0 && tangent.z == 0;
+	}
+	float degenerateDifference = MaxTangentDifference(degenerate, referenceDegenerate);
+	bool degenerateMatch = degenerateDifference <= 0.0001f && zeroLength;
+	printf("Tangents: degenerate triangle - max difference %g, %s%s\n",
+		degenerateDifference,
+		zeroLength ? "zero-length tangents stay zero" : "zero-length tangents aren't zero",
+		degenerateMatch ? "" : " (MISMATCH)");
+	return passed && degenerateMatch;
+}
+
+// --------------------------------------------------------
+// Times a mesh cache hit against parsing the OBJ and
+// calculating its tangents and bounds, on each of the game's
+// OBJs, and checks the cache gives back exactly what was
+// saved.  Also checks a cache from an older generator
+// version is rejected, then rebuilds it.
+//
+// meshDirectory - Where the OBJs are, ending in a slash
+// --------------------------------------------------------
+bool BenchmarkMeshCache(const std::string& meshDirectory)
+{
+	const int runCount = 20;
+
+	bool passed = true;
+	for (unsigned int f = 0; f < MeshFileCount; f++)
+	{
+		std::string filename = meshDirectory + MeshFiles[f];
+
+		MeshData parsed;
+		bool loaded = true;
+		double startTime = GetTime();
+		for (int run = 0; run < runCount && loaded; run++)
+		{
+			loaded = ObjLoader::Load(filename.c_str(), parsed);
+			if (loaded)
+			{
+				MeshBuilder::CalculateTangents(&parsed.vertices[0], (int)parsed.vertices.size(), &parsed.indices[0], (int)parsed.indices.size());
+				MeshBuilder::CalculateBounds(&parsed.vertices[0], (int)parsed.vertices.size(), parsed.bounds);
+			}
+		}
+		double parsedTime = GetTime();
+
+		if (!loaded || !MeshCache::Save(filename.c_str(), parsed))
+		{
+			printf("MeshCache: %s failed to load or save (MISMATCH)\n", MeshFiles[f]);
+			passed = false;
+			continue;
+		}
+
+		MeshData cached;
+		bool hit = true;
+		for (int run = 0; run < runCount && hit; run++)
+			hit = MeshCache::Load(filename.c_str(), cached);
+		double cachedTime = GetTime();
+
+		bool match = hit &&
+			cached.vertices.size() == parsed.vertices.size() &&
+			cached.indices == parsed.indices &&
+			memcmp(&cached.vertices[0], &parsed.vertices[0], sizeof(Vertex) * parsed.vertices.size()) == 0 &&
+			memcmp(&cached.bounds, &parsed.bounds, sizeof(MeshBounds)) == 0;
+
+		// Pretend an older generator wrote the cache
+		bool staleRejected = false;
+		FILE* file = fopen((filename + ".meshcache").c_str(), "r+b");
+		if (file)
+		{
+			MeshCacheHeader header = {};
+			if (fread(&header, sizeof(header), 1, file) == 1)
+			{
+				header.generatorVersion = MESH_CACHE_GENERATOR_VERSION - 1;
+				fseek(file, 0, SEEK_SET);
+				fwrite(&header, sizeof(header), 1, file);
+			}
+			fclose(file);
+
+			MeshData stale;
+			staleRejected = !MeshCache::Load(filename.c_str(), stale);
+		}
+		MeshCache::Save(filename.c_str(), parsed);
+		passed = passed && match && staleRejected;
+
+		double parseMs = (parsedTime - startTime) * 1000.0 / runCount;
+		double cacheMs = (cachedTime - parsedTime) * 1000.0 / runCount;
+		printf("MeshCache: %s - parse %.3f ms, cache hit %.3f ms (%.1fx), %s, stale generator %s\n",
+			MeshFiles[f],
+			parseMs,
+			cacheMs,
+			cacheMs > 0 ? parseMs / cacheMs : 0.0,
+			match ? "matches" : "(MISMATCH)",
+			staleRejected ? "rejected" : "(MISMATCH: accepted)");
+	}
+	return passed;
+}
+
+// --------------------------------------------------------
+// Checks that a packed archive hands back exactly what went
+// into it, misses keys that didn't, and refuses bad entries
+// and damaged files, timing lookups
+// --------------------------------------------------------
+bool CheckShaderArchive()
+{
+	// Assorted sizes, keyed the way permutations are
+	const unsigned int entryCount = 1000;
+	std::vector<ShaderArchiveEntry> entries(entryCount);
+	for (unsigned int e = 0; e < entryCount; e++)
+	{
+		std::string name = "Synthetic " + std::to_string(e);
+		entries[e].key = ShaderPermutations::Hash(name.c_str(), name.size());
+		entries[e].bytecode.resize(1 + (e * 37) % 500);
+		for (unsigned int b = 0; b < entries[e].bytecode.size(); b++)
+			entries[e].bytecode[b] = (unsigned char)(e * 7 + b);
+	}
+
+	std::vector<unsigned char> bytes;
+	ShaderArchive synthetic;
+	bool packed = ShaderArchive::Pack(entries, 1234, bytes) && synthetic.Open(&bytes[0], bytes.size());
+
+	unsigned int found = 0;
+	unsigned int falseHits = 0;
+	for (unsigned int e = 0; e < entryCount; e++)
+	{
+		unsigned int size = 0;
+		const void* bytecode = synthetic.Find(entries[e].key, size);
+		if (bytecode && size == entries[e].bytecode.size() && memcmp(bytecode, &entries[e].bytecode[0], size) == 0)
+			found++;
+
+		std::string missing = "Missing " + std::to_string(e);
+		if (synthetic.Find(ShaderPermutations::Hash(missing.c_str(), missing.size()), size))
+			falseHits++;
+	}
+
+	// A key packed twice, or an empty entry, is a build error
+	std::vector<unsigned char> rejected;
+	std::vector<ShaderArchiveEntry> duplicate(entries.begin(), entries.begin() + 2);
+	duplicate[1].key = duplicate[0].key;
+	std::vector<ShaderArchiveEntry> empty(1);
+	empty[0].key = 1;
+	bool refusesBadEntries = !ShaderArchive::Pack(duplicate, 0, rejected) && !ShaderArchive::Pack(empty, 0, rejected);
+
+	// A cut off or foreign file is never trusted
+	ShaderArchive damaged;
+	std::vector<unsigned char> truncated(bytes.begin(), bytes.begin() + bytes.size() / 2);
+	std::vector<unsigned char> badMagic = bytes;
+	badMagic[0] ^= 0xFF;
+	bool refusesDamage =
+		!damaged.Open(&truncated[0], truncated.size()) &&
+		!damaged.Open(&badMagic[0], badMagic.size());
+
+	const unsigned int lookupCount = 1000000;
+	unsigned long long totalSize = 0;
+	double startTime = GetTime();
+	for (unsigned int i = 0; i < lookupCount; i++)
+	{
+		unsigned int size = 0;
+		synthetic.Find(entries[i % entryCount].key, size);
+		totalSize += size;
+	}
+	double lookupNs = (GetTime() - startTime) * 1e9 / lookupCount;
+
+	bool ok = packed && found == entryCount && falseHits == 0 && refusesBadEntries && refusesDamage && totalSize > 0;
+	printf("Shader archive: %u/%u synthetic entries round trip, %u false hits, %u slots, longest probe %u, %.1f ns per lookup%s\n",
+		found,
+		entryCount,
+		falseHits,
+		synthetic.GetSlotCount(),
+		synthetic.GetMaxProbeCount(),
+		lookupNs,
+		ok ? "" : " (MISMATCH)");
+	return ok;
+}
+
+#ifdef _WIN32
+// The textures the game loads, which only WIC can decode
+static const wchar_t* TextureFiles[] = {
+	L"skybox\\right.png", L"skybox\\left.png", L"skybox\\up.png", L"skybox\\down.png", L"skybox\\front.png", L"skybox\\back.png",
+	L"starship_albedo.png", L"starship_emissive.png", L"starship_roughness.png", L"starship_metallic.png", L"starship_normal.png" };
+
+// --------------------------------------------------------
+// Times decoding every texture and mesh the game loads at
+// startup, one after another on this thread and then all
+// queued at once on an AssetLoader's workers, and checks
+// both produce the same data, with the grayscale maps kept
+// single channel.  Meshes go through
+// MeshBuilder::LoadMeshData() like the game's, so an
+// untimed first pass makes sure both timed ones read the
+// mesh caches.
+//
+// assetDirectory - The game's assets folder, ending in a slash
+// --------------------------------------------------------
+bool BenchmarkAssetDecoding(const std::string& assetDirectory)
+{
+	const unsigned int textureCount = sizeof(TextureFiles) / sizeof(TextureFiles[0]);
+	const unsigned int meshCount = MeshFileCount;
+
+	std::wstring textureDirectory = std::wstring(assetDirectory.begin(), assetDirectory.end()) + L"textures\\";
+	std::string meshDirectory = assetDirectory + "meshes\\";
+
+	std::vector<ImageData> serialImages(textureCount), parallelImages(textureCount);
+	std::vector<MeshData> serialMeshes(meshCount), parallelMeshes(meshCount);
+	for (unsigned int m = 0; m < meshCount; m++)
+		MeshBuilder::LoadMeshData((meshDirectory + MeshFiles[m]).c_str(), serialMeshes[m]);
+
+	// Serial, the way Init used to load
+	double startTime = GetTime();
+	for (unsigned int t = 0; t < textureCount; t++)
+		AssetLoader::DecodeImage((textureDirectory + TextureFiles[t]).c_str(), serialImages[t]);
+	for (unsigned int m = 0; m < meshCount; m++)
+		MeshBuilder::LoadMeshData((meshDirectory + MeshFiles[m]).c_str(), serialMeshes[m]);
+	double serialTime = GetTime();
+
+	// Parallel, with the workers already started as they
+	// are by the time Init queues its first job
+	AssetLoader assetLoader;
+	std::vector<std::future<ImageData>> imageFutures(textureCount);
+	std::vector<std::future<MeshData>> meshFutures(meshCount);
+
+	double parallelStartTime = GetTime();
+	for (unsigned int t = 0; t < textureCount; t++)
+		imageFutures[t] = assetLoader.LoadImageData(textureDirectory + TextureFiles[t]);
+	for (unsigned int m = 0; m < meshCount; m++)
+		meshFutures[m] = assetLoader.LoadMeshData(meshDirectory + MeshFiles[m]);
+	for (unsigned int t = 0; t < textureCount; t++)
+		parallelImages[t] = imageFutures[t].get();
+	for (unsigned int m = 0; m < meshCount; m++)
+		parallelMeshes[m] = meshFutures[m].get();
+	double parallelTime = GetTime();
+
+	// The roughness and metal maps are 8-bit grayscale PNGs
+	bool match = true;
+	unsigned int singleChannelCount = 0;
+	for (unsigned int t = 0; t < textureCount; t++)
+	{
+		match = match &&
+			!serialImages[t].pixels.empty() &&
+			serialImages[t].width == parallelImages[t].width &&
+			serialImages[t].height == parallelImages[t].height &&
+			serialImages[t].format == parallelImages[t].format &&
+			serialImages[t].pixels == parallelImages[t].pixels;
+
+		if (serialImages[t].format == DXGI_FORMAT_R8_UNORM)
+			singleChannelCount++;
+	}
+	match = match && singleChannelCount == 2;
+	for (unsigned int m = 0; m < meshCount; m++)
+	{
+		const MeshData& a = serialMeshes[m];
+		const MeshData& b = parallelMeshes[m];
+		match = match &&
+			!a.vertices.empty() &&
+			a.vertices.size() == b.vertices.size() &&
+			a.indices == b.indices &&
+			memcmp(&a.vertices[0], &b.vertices[0], sizeof(Vertex) * a.vertices.size()) == 0;
+	}
+
+	double serialMs = (serialTime - startTime) * 1000.0;
+	double parallelMs = (parallelTime - parallelStartTime) * 1000.0;
+	printf("Asset decoding: %u textures (%u single channel) and %u meshes - serial %.2f ms, %u workers %.2f ms (%.1fx)%s\n",
+		textureCount,
+		singleChannelCount,
+		meshCount,
+		serialMs,
+		assetLoader.GetWorkerCount(),
+		parallelMs,
+		parallelMs > 0 ? serialMs / parallelMs : 0.0,
+		match ? "" : " (MISMATCH)");
+	return match;
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+// --------------------------------------------------------
+// Benchmarks and checks of everything that needs no Direct3D
+// device, run by Benchmarks.exe instead of on every debug
+// launch of the game.  Each prints one line (or a few) and
+// flags anything that doesn't match its reference with
+// "(MISMATCH)".  The ones that check something return false
+// on a mismatch, and Benchmarks.exe exits with 1 if any did.
+//
+// The ones that compare a shader against its CPU reference
+// need a device and stay in the game, behind -gpuchecks.
+// The ones that need SimpleShader or WIC are only built on
+// Windows; everything else also builds with CMake elsewhere.
+// --------------------------------------------------------
+
+// Main.cpp
+double GetTime(); // Seconds, from a steady clock
+
+// SceneBenchmarks.cpp
+void BenchmarkTransforms();
+void BenchmarkHierarchies();
+void BenchmarkEntityStorage();
+bool BenchmarkFrustumCulling();
+bool BenchmarkRenderQueue();
+bool CheckInstancePacking();
+bool CheckEntityParenting();
+bool BenchmarkLightClusters();
+
+// ShaderBenchmarks.cpp (Windows only)
+bool BenchmarkShaderSetters();
+void BenchmarkConstantBufferUploads();
+
+// PostProcessChecks.cpp
+bool CheckGaussianKernels();
+bool CheckRenderTargetPool();
+bool CheckFrameGraph();
+bool CheckBloomTiers();
+bool CheckBloomEarlyOut();
+bool CheckAutoExposure();
+
+// AssetBenchmarks.cpp
+bool BenchmarkObjLoader(const std::string& meshDirectory);
+bool BenchmarkTangents(const std::string& meshDirectory);
+bool BenchmarkMeshCache(const std::string& meshDirectory);
+bool CheckShaderArchive();
+bool BenchmarkAssetDecoding(const std::string& assetDirectory); // Windows only
@@ -0,0 +1,61 @@
+#include "LayoutOnlyShader.h"
+#include <string.h>
+
+LayoutOnlyShader::LayoutOnlyShader(const unsigned int* bufferSizes, unsigned int bufferCount, const LayoutVariable* variables, unsigned int variableCount)
+	: ISimpleShader(0, 0)
+{
+	this->shaderValid = true;
+	this->uploadedBytes = 0;
+
+	this->constantBufferCount = bufferCount;
+	this->constantBuffers = new SimpleConstantBuffer[bufferCount];
+	for (unsigned int b = 0; b < bufferCount; b++)
+	{
+		this->constantBuffers[b].Size = bufferSizes[b];
+		this->constantBuffers[b].LocalDataBuffer = new unsigned char[bufferSizes[b]];
+		memset(this->constantBuffers[b].LocalDataBuffer, 0, bufferSizes[b]);
+	}
+
+	for (unsigned int v = 0; v < variableCount; v++)
+	{
+		SimpleShaderVariable variable = { variables[v].byteOffset, variables[v].size, variables[v].buffer };
+		this->varTable.insert(std::pair<std::string, SimpleShaderVariable>(variables[v].name, variable));
+		this->constantBuffers[variables[v].buffer].Variables.push_back(variable);
+	}
+}
+
+LayoutOnlyShader::~LayoutOnlyShader()
+{
+	this->CleanUp();
+}
+
+// There's no shader to bind anything to
+bool LayoutOnlyShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	return false;
+}
+
+bool LayoutOnlyShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	return false;
+}
+
+bool LayoutOnlyShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+{
+	return false;
+}
+
+void LayoutOnlyShader::SetShaderAndCBs()
+{
+}
+
+// --------------------------------------------------------
+// Counts the bytes a real shader would have uploaded, and
+// marks the buffer clean the way it would
+// --------------------------------------------------------
+void LayoutOnlyShader::UploadBufferData(SimpleConstantBuffer* cb)
+{
+	this->uploadedBytes += cb->Size;
+	cb->DirtyStart = 0;
+	cb->DirtyEnd = 0;
+}
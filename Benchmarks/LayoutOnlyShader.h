@@ -0,0 +1,35 @@
+#pragma once
+
+#include "SimpleShader.h"
+
+// One constant buffer variable of a hand-written layout
+struct LayoutVariable
+{
+	const char* name;
+	unsigned int buffer;
+	unsigned int byteOffset;
+	unsigned int size;
+};
+
+// --------------------------------------------------------
+// A shader whose constant buffer layout is filled in by hand
+// instead of by reflection, so its setters and uploads can
+// be exercised without a device or compiled shader.  Uploads
+// are only counted.
+// --------------------------------------------------------
+class LayoutOnlyShader : public ISimpleShader
+{
+public:
+	LayoutOnlyShader(const unsigned int* bufferSizes, unsigned int bufferCount, const LayoutVariable* variables, unsigned int variableCount);
+	~LayoutOnlyShader();
+
+	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+
+	unsigned int uploadedBytes;
+
+protected:
+	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
+	void SetShaderAndCBs();
+	void UploadBufferData(SimpleConstantBuffer* cb);
+};
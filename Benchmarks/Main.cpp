@@ -0,0 +1,86 @@
+#include "Benchmarks.h"
+#include <chrono>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+double GetTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --------------------------------------------------------
+// Finds the game's assets folder: the first argument if
+// there is one, otherwise two folders up from the exe,
+// which is where the solution's output puts it
+// --------------------------------------------------------
+static std::string GetAssetDirectory(int argc, char* argv[])
+{
+	if (argc > 1)
+	{
+		std::string directory = argv[1];
+		if (directory.back() != '\\' && directory.back() != '/')
+			directory += '/';
+		return directory;
+	}
+
+	std::string exePath = argv[0];
+	return exePath.substr(0, exePath.find_last_of("/\\") + 1) + "../../assets/";
+}
+
+// --------------------------------------------------------
+// Entry point for the benchmarks, a console application.
+// Always built optimized (see DX11Starter.sln and
+// CMakeLists.txt), so timings mean what they would in the
+// game's release build.
+// Returns 1 if any check reported a mismatch.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int failures = 0;
+
+	BenchmarkTransforms();
+	BenchmarkHierarchies();
+	BenchmarkEntityStorage();
+	if (!BenchmarkFrustumCulling()) failures++;
+	if (!BenchmarkRenderQueue()) failures++;
+	if (!CheckInstancePacking()) failures++;
+	if (!CheckEntityParenting()) failures++;
+	if (!BenchmarkLightClusters()) failures++;
+
+#ifdef _WIN32
+	if (!BenchmarkShaderSetters()) failures++;
+	BenchmarkConstantBufferUploads();
+#endif
+
+	if (!CheckGaussianKernels()) failures++;
+	if (!CheckRenderTargetPool()) failures++;
+	if (!CheckFrameGraph()) failures++;
+	if (!CheckBloomTiers()) failures++;
+	if (!CheckBloomEarlyOut()) failures++;
+	if (!CheckAutoExposure()) failures++;
+
+	std::string assetDirectory = GetAssetDirectory(argc, argv);
+	if (!BenchmarkObjLoader(assetDirectory + "meshes/")) failures++;
+	if (!BenchmarkTangents(assetDirectory + "meshes/")) failures++;
+	if (!BenchmarkMeshCache(assetDirectory + "meshes/")) failures++;
+	if (!CheckShaderArchive()) failures++;
+
+#ifdef _WIN32
+	// WIC needs COM on this thread too, for the serial decode
+	CoInitializeEx(0, COINIT_MULTITHREADED);
+	if (!BenchmarkAssetDecoding(assetDirectory)) failures++;
+	CoUninitialize();
+#endif
+
+	if (failures > 0)
+	{
+		printf("%d check%s failed\n", failures, failures == 1 ? "" : "s");
+		return 1;
+	}
+
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,676 @@
+#include "Benchmarks.h"
+#include "GaussianKernel.h"
+#include "BloomFilter.h"
+#include "BloomEarlyOut.h"
+#include "AutoExposure.h"
+#include "RenderTargetPool.h"
+#include "FrameGraph.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace DirectX;
+
+static float ClampedTexel(const std::vector<float>& texels, int index)
+{
+	int last = (int)texels.size() - 1;
+	return texels[index < 0 ? 0 : (index > last ? last : index)];
+}
+
+// --------------------------------------------------------
+// Blurs a random row of texels with several kernels, once
+// texel by texel and once with the merged bilinear taps
+// (filtering emulated in full precision), and reports the
+// largest difference and the samples each way
+// --------------------------------------------------------
+bool CheckGaussianKernels()
+{
+	const int texelCount = 256;
+	const int sigmaCount = 5;
+	const float sigmas[sigmaCount] = { 0.5f, 1.0f, 2.5f, 4.0f, 7.5f };
+
+	std::vector<float> texels(texelCount);
+	srand(12345);
+	for (int i = 0; i < texelCount; i++)
+		texels[i] = rand() / (float)RAND_MAX;
+
+	bool match = true;
+	for (int s = 0; s < sigmaCount; s++)
+	{
+		GaussianKernel kernel(sigmas[s]);
+		const float* weights = kernel.GetWeights();
+		const float* tapWeights = kernel.GetTapWeights();
+		const float* tapOffsets = kernel.GetTapOffsets();
+
+		float maxError = 0.0f;
+		for (int i = 0; i < texelCount; i++)
+		{
+			float discrete = texels[i] * weights[0];
+			for (int r = 1; r <= kernel.GetRadius(); r++)
+				discrete += (ClampedTexel(texels, i - r) + ClampedTexel(texels, i + r)) * weights[r];
+
+			float merged = texels[i] * tapWeights[0];
+			for (int t = 1; t < kernel.GetTapCount(); t++)
+			{
+				for (int side = -1; side <= 1; side += 2)
+				{
+					float position = i + side * tapOffsets[t];
+					int left = (int)floorf(position);
+					float fraction = position - left;
+					merged += (ClampedTexel(texels, left) * (1.0f - fraction) + ClampedTexel(texels, left + 1) * fraction) * tapWeights[t];
+				}
+			}
+
+			maxError = fmaxf(maxError, fabsf(discrete - merged));
+		}
+
+		match = match && maxError < 0.0001f;
+		printf("Gaussian kernel: sigma %.1f, radius %d - %d samples per pixel instead of %d, max error %.7f%s\n",
+			sigmas[s],
+			kernel.GetRadius(),
+			kernel.GetTapCount() * 2 - 1,
+			kernel.GetRadius() * 2 + 1,
+			maxError,
+			maxError < 0.0001f ? "" : " (MISMATCH)");
+	}
+	return match;
+}
+
+// --------------------------------------------------------
+// Acquires and releases targets in the same order as one
+// frame of Game::Draw's post processing
+// --------------------------------------------------------
+static void ReplayPostProcessTargets(RenderTargetPool& pool, unsigned int width, unsigned int height, int levelCount, bool compute)
+{
+	const DXGI_FORMAT format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+	pool.BeginFrame();
+	unsigned int scene = pool.Acquire(width, height, format);
+
+	unsigned int extract = 0;
+	if (!compute && levelCount > 0)
+		extract = pool.Acquire(BloomFilter::LevelSize(width, 2), BloomFilter::LevelSize(height, 2), format);
+
+	std::vector<unsigned int> levels;
+	for (int i = 0; i < levelCount; i++)
+	{
+		width = BloomFilter::LevelSize(width, 2);
+		height = BloomFilter::LevelSize(height, 2);
+		if (compute)
+		{
+			levels.push_back(pool.Acquire(width, height, format));
+			continue;
+		}
+
+		unsigned int horizontal = pool.Acquire(width, height, format);
+		if (i == 0)
+			pool.Release(extract);
+		levels.push_back(pool.Acquire(width, height, format));
+		pool.Release(horizontal);
+	}
+
+	for (size_t i = 0; i < levels.size(); i++)
+		pool.Release(levels[i]);
+	pool.Release(scene);
+}
+
+// --------------------------------------------------------
+// Compares the memory the old fixed post processing targets
+// took with the pool's peak for each bloom path, and checks
+// that steady frames create nothing and that targets a
+// frame stops using are destroyed
+// --------------------------------------------------------
+bool CheckRenderTargetPool()
+{
+	const int maxLevels = 5;
+	const unsigned int sizes[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+
+	for (int s = 0; s < 2; s++)
+	{
+		unsigned int width = sizes[s][0];
+		unsigned int height = sizes[s][1];
+
+		// The scene, the extract, and a horizontal, vertical
+		// and compute target for every level
+		const unsigned int bytesPerPixel = RenderTargetPool::GetBytesPerPixel(DXGI_FORMAT_R16G16B16A16_FLOAT);
+		unsigned long long fixedBytes = (unsigned long long)width * height * bytesPerPixel;
+		fixedBytes += (unsigned long long)(width / 2) * (height / 2) * bytesPerPixel;
+		for (int i = 1; i <= maxLevels; i++)
+			fixedBytes += 3ull * (width >> i) * (height >> i) * bytesPerPixel;
+
+		RenderTargetPool computePool, pixelPool, fewLevelsPool;
+		for (int frame = 0; frame < 3; frame++)
+		{
+			ReplayPostProcessTargets(computePool, width, height, maxLevels, true);
+			ReplayPostProcessTargets(pixelPool, width, height, maxLevels, false);
+			ReplayPostProcessTargets(fewLevelsPool, width, height, 2, true);
+		}
+
+		printf("Render target pool: %ux%u - fixed targets %.1f MB, pooled peak %.1f MB compute bloom (%u targets), %.1f MB pixel shader bloom (%u targets), %.1f MB with 2 levels\n",
+			width, height,
+			fixedBytes / 1048576.0,
+			computePool.GetPeakBytes() / 1048576.0,
+			computePool.GetTargetCount(),
+			pixelPool.GetPeakBytes() / 1048576.0,
+			pixelPool.GetTargetCount(),
+			fewLevelsPool.GetPeakBytes() / 1048576.0);
+	}
+
+	// Both paths, then a resize: the first frame of each
+	// creates what it needs, the rest reuse it, and targets
+	// from the other path or the old size go away
+	RenderTargetPool pool;
+	unsigned int steadyCreates = 0;
+	for (int frame = 0; frame < 4; frame++)
+	{
+		unsigned int before = pool.GetCreateCount();
+		ReplayPostProcessTargets(pool, 1280, 720, maxLevels, true);
+		if (frame > 0)
+			steadyCreates += pool.GetCreateCount() - before;
+	}
+	unsigned int computeTargets = pool.GetTargetCount();
+
+	ReplayPostProcessTargets(pool, 1280, 720, maxLevels, false);
+	ReplayPostProcessTargets(pool, 1280, 720, maxLevels, false);
+	unsigned int pixelTargets = pool.GetTargetCount();
+
+	ReplayPostProcessTargets(pool, 640, 360, maxLevels, false);
+	ReplayPostProcessTargets(pool, 640, 360, maxLevels, false);
+	bool resized = pool.GetTargetCount() == pixelTargets && pool.GetAllocatedBytes() < pool.GetPeakBytes() / 2;
+
+	bool ok = steadyCreates == 0 &&
+		computeTargets == 1 + maxLevels &&
+		pixelTargets == 1 + maxLevels * 2 &&
+		resized;
+	printf("Render target pool: %u targets created after the first frame, %u targets for compute bloom, %u for pixel shader bloom (extract shared with the first level)%s\n",
+		steadyCreates,
+		computeTargets,
+		pixelTargets,
+		ok ? "" : " (MISMATCH)");
+	return ok;
+}
+
+// --------------------------------------------------------
+// Declares the same passes as Game::Draw, with nothing to
+// execute, and the registers the shaders actually use.  A
+// debug view can be added that nothing reads.
+// --------------------------------------------------------
+static void DeclarePostProcessFrame(FrameGraph& graph, unsigned int width, unsigned int height, const BloomTier& tier, int levelCount, bool compute, bool debugView)
+{
+	const DXGI_FORMAT format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+	unsigned int backBuffer = graph.ImportTarget("Back buffer", width, height, DXGI_FORMAT_R8G8B8A8_UNORM);
+	unsigned int depthBuffer = graph.ImportTarget("Depth buffer", width, height, DXGI_FORMAT_D24_UNORM_S8_UINT);
+	unsigned int scene = graph.CreateTarget("Scene", width, height, format);
+
+	unsigned int pass = graph.AddPass("Clear back buffer", 0);
+	graph.Write(pass, backBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+	pass = graph.AddPass("Clear depth buffer", 0);
+	graph.Write(pass, depthBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+	pass = graph.AddPass("Clear scene", 0);
+	graph.Write(pass, scene, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+
+	for (int i = 0; i < 2; i++)
+	{
+		pass = graph.AddPass(i == 0 ? "Scene" : "Sky", 0);
+		graph.Write(pass, scene, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_PRESERVE);
+		graph.Write(pass, depthBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_PRESERVE);
+	}
+
+	if (debugView)
+	{
+		unsigned int view = graph.CreateTarget("Debug view", width, height, format);
+		pass = graph.AddPass("Debug view", 0);
+		graph.Write(pass, view, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+		graph.Read(pass, scene, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, 0);
+	}
+
+	std::vector<unsigned int> levels;
+	unsigned int source = scene;
+	if (!compute && levelCount > 0)
+	{
+		source = graph.CreateTarget("Bloom extract", BloomFilter::LevelSize(width, tier.firstStep), BloomFilter::LevelSize(height, tier.firstStep), tier.format);
+		pass = graph.AddPass("Bloom extract", 0);
+		graph.Write(pass, source, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+		graph.Read(pass, scene, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, 0);
+	}
+
+	unsigned int step = tier.firstStep;
+	for (int i = 0; i < levelCount; i++)
+	{
+		width = BloomFilter::LevelSize(width, step);
+		height = BloomFilter::LevelSize(height, step);
+		step = 2;
+		std::string name = "Bloom level " + std::to_string(i);
+		unsigned int level = graph.CreateTarget(name, width, height, tier.format);
+		if (compute)
+		{
+			pass = graph.AddPass(name, 0);
+			graph.Read(pass, source, FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE, 0);
+			graph.Write(pass, level, FRAME_GRAPH_BIND_UNORDERED_ACCESS, 0, FRAME_GRAPH_WRITE_DISCARD);
+		}
+		else
+		{
+			unsigned int horizontal = graph.CreateTarget(name + " horizontal", width, height, tier.format);
+			pass = graph.AddPass(name + " horizontal blur", 0);
+			graph.Write(pass, horizontal, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+			graph.Read(pass, source, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, 0);
+			pass = graph.AddPass(name + " vertical blur", 0);
+			graph.Write(pass, level, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+			graph.Read(pass, horizontal, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, 0);
+		}
+		levels.push_back(level);
+		source = level;
+	}
+
+	pass = graph.AddPass("Bloom combine", 0);
+	graph.Write(pass, backBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+	graph.Read(pass, scene, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, 0);
+	for (size_t i = 0; i < levels.size(); i++)
+		graph.Read(pass, levels[i], FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, 1 + (unsigned int)i);
+}
+
+// --------------------------------------------------------
+// Compiles a few frames without a device and compares each
+// to the pass order, culling and unbinding it should have
+// --------------------------------------------------------
+bool CheckFrameGraph()
+{
+	const char* computeGolden =
+		"Clear back buffer (culled)\n"
+		"Clear depth buffer\n"
+		"Clear scene\n"
+		"Scene\n"
+		"Sky\n"
+		"Bloom level 0 - unbind render targets\n"
+		"Bloom level 1 - unbind cs u0\n"
+		"Bloom level 2 - unbind cs u0\n"
+		"Bloom combine - unbind cs u0\n"
+		"End - unbind cs t0, ps t0, ps t1, ps t2, ps t3\n";
+	const char* pixelGolden =
+		"Clear back buffer (culled)\n"
+		"Clear depth buffer\n"
+		"Clear scene\n"
+		"Scene\n"
+		"Sky\n"
+		"Bloom extract\n"
+		"Bloom level 0 horizontal blur\n"
+		"Bloom level 0 vertical blur - unbind ps t0\n"
+		"Bloom level 1 horizontal blur\n"
+		"Bloom level 1 vertical blur\n"
+		"Bloom combine\n"
+		"End - unbind ps t0, ps t1, ps t2\n";
+	const char* noBloomGolden =
+		"Clear back buffer (culled)\n"
+		"Clear depth buffer\n"
+		"Clear scene\n"
+		"Scene\n"
+		"Sky\n"
+		"Debug view (culled)\n"
+		"Bloom combine\n"
+		"End - unbind ps t0\n";
+
+	const BloomTier& high = BloomFilter::GetTier(BLOOM_QUALITY_HIGH);
+	RenderTargetPool pool;
+	FrameGraph graph(&pool);
+
+	pool.BeginFrame();
+	DeclarePostProcessFrame(graph, 1280, 720, high, 3, true, false);
+	graph.Compile();
+	bool computeMatch = graph.Describe() == computeGolden;
+
+	// The extract is only read by the first horizontal blur,
+	// so the first level gets its texture
+	pool.BeginFrame();
+	graph.Reset();
+	DeclarePostProcessFrame(graph, 1280, 720, high, 2, false, false);
+	graph.Compile();
+	bool pixelMatch = graph.Describe() == pixelGolden && graph.GetTarget(3) == graph.GetTarget(4);
+	unsigned int pixelUnbinds = graph.GetUnbindCount();
+
+	// The scene's target is reused, and the debug view never
+	// gets one
+	pool.BeginFrame();
+	graph.Reset();
+	unsigned int createCount = pool.GetCreateCount();
+	DeclarePostProcessFrame(graph, 1280, 720, high, 0, false, true);
+	graph.Compile();
+	bool noBloomMatch = graph.Describe() == noBloomGolden && pool.GetCreateCount() == createCount;
+
+	printf("Frame graph: compute bloom %s, pixel shader bloom %s (%u unbinds instead of 16 every frame), no bloom with an unread debug view %s\n",
+		computeMatch ? "matches" : "(MISMATCH)",
+		pixelMatch ? "matches" : "(MISMATCH)",
+		pixelUnbinds,
+		noBloomMatch ? "matches" : "(MISMATCH)");
+	return computeMatch && pixelMatch && noBloomMatch;
+}
+
+// --------------------------------------------------------
+// Runs the CPU reference of the compute bloom chain for one
+// quality tier, storing every level (and the scene) in the
+// format the GPU would, and combines it with the scene.
+// Without a tier, nothing is rounded at all.
+// --------------------------------------------------------
+static void ReferenceBloom(const BloomImage& scene, const BloomTier* tier, const float* sigmas, int levelCount, float threshold, BloomImage& result)
+{
+	const int maxLevels = 5;
+	BloomImage levels[maxLevels];
+	float intensities[maxLevels] = { 1, 1, 1, 1, 1 };
+
+	BloomImage storedScene = scene;
+	if (tier)
+		BloomFilter::Quantize(storedScene, DXGI_FORMAT_R16G16B16A16_FLOAT);
+
+	const BloomImage* source = &storedScene;
+	unsigned int step = tier ? tier->firstStep : 2;
+	for (int i = 0; i < levelCount; i++)
+	{
+		GaussianKernel kernel(sigmas[i] * (tier ? tier->sigmaScale : 1.0f));
+		BloomFilter::DownsampleBlur(*source, step, i == 0 ? threshold : 0.0f, kernel.GetWeights(), kernel.GetRadius(), levels[i]);
+		if (tier)
+			BloomFilter::Quantize(levels[i], tier->format);
+
+		source = &levels[i];
+		step = 2;
+	}
+
+	BloomFilter::Combine(storedScene, levels, intensities, levelCount, result);
+}
+
+// --------------------------------------------------------
+// What each bloom quality tier costs and loses:
+//  - Bytes every compute bloom pass reads and writes at
+//    1080p, and the whole bloom chain's traffic (combine
+//    included) at 1080p and 4K on both paths
+//  - The error each tier adds to the final image, against
+//    the CPU reference at full float precision and half
+//    resolution, for a dark scene with a few bright lights
+//  - That a viewport too small for the low tier's first
+//    step still gets 1x1 levels instead of empty ones
+// --------------------------------------------------------
+bool CheckBloomTiers()
+{
+	const int levelCount = 5;
+	const unsigned int sizes[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+
+	RenderTargetPool pool;
+	FrameGraph graph(&pool);
+	for (int q = 0; q < BLOOM_QUALITY_COUNT; q++)
+	{
+		const BloomTier& tier = BloomFilter::GetTier((BloomQuality)q);
+		pool.BeginFrame();
+		graph.Reset();
+		DeclarePostProcessFrame(graph, 1920, 1080, tier, levelCount, true, false);
+		graph.Compile();
+
+		printf("Bloom tiers: %s at 1920x1080, compute bloom -", tier.name);
+		for (unsigned int p = 0; p < graph.GetPassCount(); p++)
+		{
+			if (graph.IsPassCulled(p) || graph.GetPassName(p).compare(0, 5, "Bloom") != 0)
+				continue;
+			printf(" %s %.2f/%.2f MB%s",
+				graph.GetPassName(p).c_str(),
+				graph.GetBytesRead(p) / 1048576.0,
+				graph.GetBytesWritten(p) / 1048576.0,
+				p + 1 < graph.GetPassCount() ? "," : "");
+		}
+		printf(" (read/written)\n");
+	}
+
+	for (int s = 0; s < 2; s++)
+	{
+		printf("Bloom tiers: %ux%u bloom traffic -", sizes[s][0], sizes[s][1]);
+		for (int q = 0; q < BLOOM_QUALITY_COUNT; q++)
+		{
+			const BloomTier& tier = BloomFilter::GetTier((BloomQuality)q);
+			unsigned long long bytes[2] = {};
+			for (int compute = 0; compute < 2; compute++)
+			{
+				pool.BeginFrame();
+				graph.Reset();
+				DeclarePostProcessFrame(graph, sizes[s][0], sizes[s][1], tier, levelCount, compute == 1, false);
+				graph.Compile();
+				for (unsigned int p = 0; p < graph.GetPassCount(); p++)
+				{
+					if (!graph.IsPassCulled(p) && graph.GetPassName(p).compare(0, 5, "Bloom") == 0)
+						bytes[compute] += graph.GetBytesRead(p) + graph.GetBytesWritten(p);
+				}
+			}
+			printf(" %s %.1f MB compute, %.1f MB pixel shaders%s",
+				tier.name,
+				bytes[1] / 1048576.0,
+				bytes[0] / 1048576.0,
+				q + 1 < BLOOM_QUALITY_COUNT ? "," : "\n");
+		}
+	}
+
+	// A dim gradient with a grid of small, very bright lights
+	const unsigned int width = 480;
+	const unsigned int height = 272;
+	const float sigmas[levelCount] = { 7.5f, 7.5f, 7.5f, 7.5f, 7.5f };
+	const float threshold = 0.75f;
+
+	BloomImage scene;
+	scene.width = width;
+	scene.height = height;
+	scene.pixels.resize(width * height);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float base = 0.25f * x / width + 0.25f * y / height;
+			bool light = x % 60 >= 28 && x % 60 < 32 && y % 68 >= 32 && y % 68 < 36;
+			float value = light ? base + 16.0f : base;
+			scene.pixels[y * width + x] = XMFLOAT4(value, value * 0.8f, value * 0.6f, 1.0f);
+		}
+	}
+
+	BloomImage reference;
+	ReferenceBloom(scene, 0, sigmas, levelCount, threshold, reference);
+
+	printf("Bloom tiers: error against the full precision CPU reference at %ux%u -", width, height);
+	for (int q = 0; q < BLOOM_QUALITY_COUNT; q++)
+	{
+		const BloomTier& tier = BloomFilter::GetTier((BloomQuality)q);
+		BloomImage result;
+		ReferenceBloom(scene, &tier, sigmas, levelCount, threshold, result);
+
+		double squaredError = 0.0;
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < width * height; i++)
+		{
+			const float* expected = &reference.pixels[i].x;
+			const float* actual = &result.pixels[i].x;
+			for (int c = 0; c < 3; c++)
+			{
+				float error = fabsf(actual[c] - expected[c]);
+				squaredError += error * error;
+				maxError = fmaxf(maxError, error);
+			}
+		}
+
+		printf(" %s RMS %.5f max %.4f%s",
+			tier.name,
+			sqrt(squaredError / (width * height * 3)),
+			maxError,
+			q + 1 < BLOOM_QUALITY_COUNT ? "," : "\n");
+	}
+
+	// A viewport smaller than the low tier's first step, lit
+	// everywhere, still gets a level of every size and bloom
+	const unsigned int tinyWidth = 3;
+	const unsigned int tinyHeight = 2;
+	const BloomTier& lowTier = BloomFilter::GetTier(BLOOM_QUALITY_LOW);
+	BloomImage tinyScene;
+	tinyScene.width = tinyWidth;
+	tinyScene.height = tinyHeight;
+	tinyScene.pixels.assign(tinyWidth * tinyHeight, XMFLOAT4(4.0f, 4.0f, 4.0f, 1.0f));
+
+	BloomImage tinyLevels[levelCount];
+	float tinyIntensities[levelCount] = { 1, 1, 1, 1, 1 };
+	const BloomImage* tinySource = &tinyScene;
+	unsigned int tinyStep = lowTier.firstStep;
+	bool levelsNotEmpty = true;
+	for (int i = 0; i < levelCount; i++)
+	{
+		GaussianKernel kernel(sigmas[i] * lowTier.sigmaScale);
+		BloomFilter::DownsampleBlur(*tinySource, tinyStep, i == 0 ? threshold : 0.0f, kernel.GetWeights(), kernel.GetRadius(), tinyLevels[i]);
+		levelsNotEmpty = levelsNotEmpty && tinyLevels[i].width == 1 && tinyLevels[i].height == 1 && tinyLevels[i].pixels.size() == 1;
+		tinySource = &tinyLevels[i];
+		tinyStep = 2;
+	}
+
+	BloomImage tinyResult;
+	BloomFilter::Combine(tinyScene, tinyLevels, tinyIntensities, levelCount, tinyResult);
+	bool bloomAdded = true;
+	for (unsigned int i = 0; i < tinyWidth * tinyHeight; i++)
+		bloomAdded = bloomAdded && isfinite(tinyResult.pixels[i].x) && tinyResult.pixels[i].x > tinyScene.pixels[i].x;
+
+	printf("Bloom tiers: %ux%u at %s - levels %s, combine %s\n",
+		tinyWidth, tinyHeight, lowTier.name,
+		levelsNotEmpty ? "all 1x1" : "(MISMATCH: some are empty)",
+		bloomAdded ? "adds bloom" : "(MISMATCH)");
+	return levelsNotEmpty && bloomAdded;
+}
+
+// --------------------------------------------------------
+// Checks that bloom really is black for a scene just under
+// the threshold and isn't for one with a single bright
+// texel, at exposures that darken and brighten the scene
+// enough that ignoring them would flip the answer, and the
+// skipping decision over a few frames of results
+// --------------------------------------------------------
+bool CheckBloomEarlyOut()
+{
+	const unsigned int width = 333;
+	const unsigned int height = 187;
+	const float threshold = 0.75f;
+	const float exposures[3] = { 1.0f, 0.4f, 8.0f };
+
+	bool darkIsBlack = true;
+	bool brightIsNot = true;
+	srand(54321);
+	for (int e = 0; e < 3; e++)
+	{
+		float exposure = exposures[e];
+		for (int bright = 0; bright < 2; bright++)
+		{
+			// Just under the threshold once exposed, except for
+			// the bright texel
+			BloomImage scene;
+			scene.width = width;
+			scene.height = height;
+			scene.pixels.resize(width * height);
+			for (unsigned int i = 0; i < width * height; i++)
+			{
+				float* pixel = &scene.pixels[i].x;
+				for (int c = 0; c < 4; c++)
+				{
+					pixel[c] = c == 3 ? 1.0f : 0.7f / exposure * rand() / (float)RAND_MAX;
+					if (bright && i == width * (height / 2) + width / 2 && c == 2)
+						pixel[c] = 4.0f / exposure;
+				}
+			}
+
+			// The first level is black exactly when nothing is
+			// above the threshold once exposed.  The bloom passes
+			// divide the threshold by the exposure instead.
+			float sceneMax = BloomEarlyOut::FindMaxValue(scene, exposure);
+			GaussianKernel kernel(7.5f);
+			BloomImage level;
+			BloomFilter::DownsampleBlur(scene, 2, threshold / exposure, kernel.GetWeights(), kernel.GetRadius(), level);
+			float levelMax = BloomEarlyOut::FindMaxValue(level, 1.0f);
+			if (bright)
+				brightIsNot = brightIsNot && sceneMax > threshold && levelMax > 0.0f;
+			else
+				darkIsBlack = darkIsBlack && sceneMax <= threshold && levelMax == 0.0f;
+		}
+	}
+
+	// No result yet, a dark one, a bright one, then no more
+	// results until they're too old to trust
+	BloomEarlyOut earlyOut;
+	std::string decisions;
+	for (unsigned int frame = 0; frame < 10; frame++)
+	{
+		earlyOut.BeginFrame();
+		if (frame == 2)
+			earlyOut.SetResult(0.5f);
+		if (frame == 4)
+			earlyOut.SetResult(2.0f);
+		if (frame == 5)
+			earlyOut.SetResult(0.5f);
+		decisions += earlyOut.IsBloomNeeded(threshold) ? "B" : "-";
+	}
+	bool decisionsMatch = decisions == "BB--B---BB";
+
+	printf("Bloom early out: skipped bloom %s black, bright scene %s, decisions %s%s\n",
+		darkIsBlack ? "is" : "(MISMATCH) isn't",
+		brightIsNot ? "blooms" : "(MISMATCH) doesn't bloom",
+		decisions.c_str(),
+		decisionsMatch ? "" : " (MISMATCH)");
+	return darkIsBlack && brightIsNot && decisionsMatch;
+}
+
+// --------------------------------------------------------
+// Frames of adapting from one flat gray to another until the
+// exposure is within 10% (in stops) of where it settles
+// --------------------------------------------------------
+static int CountAdaptationFrames(const AutoExposureSettings& settings, float fromLuminance, float toLuminance)
+{
+	BloomImage image;
+	image.width = 64;
+	image.height = 64;
+	image.pixels.assign(64 * 64, XMFLOAT4(fromLuminance, fromLuminance, fromLuminance, 1.0f));
+
+	AutoExposure adapter(settings);
+	for (int frame = 0; frame < 1000; frame++)
+		adapter.Update(image, 1.0f / 60.0f);
+	float start = log2f(adapter.GetExposure());
+
+	image.pixels.assign(64 * 64, XMFLOAT4(toLuminance, toLuminance, toLuminance, 1.0f));
+	AutoExposure settled = adapter;
+	for (int frame = 0; frame < 1000; frame++)
+		settled.Update(image, 1.0f / 60.0f);
+	float end = log2f(settled.GetExposure());
+
+	int frames = 0;
+	while (fabsf(log2f(adapter.GetExposure()) - end) > 0.1f * fabsf(end - start) && frames < 1000)
+	{
+		adapter.Update(image, 1.0f / 60.0f);
+		frames++;
+	}
+	return frames;
+}
+
+// --------------------------------------------------------
+// Checks that AutoExposure settles a flat gray scene at the
+// key and that it brightens faster than it darkens
+// --------------------------------------------------------
+bool CheckAutoExposure()
+{
+	AutoExposureSettings settings;
+
+	// Bins are an eighth of a stop wide, so the average can be
+	// off by half of that
+	BloomImage gray;
+	gray.width = 64;
+	gray.height = 64;
+	gray.pixels.assign(64 * 64, XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f));
+	AutoExposure adapter(settings);
+	for (int frame = 0; frame < 1000; frame++)
+		adapter.Update(gray, 1.0f / 60.0f);
+	float grayError = fabsf(log2f(adapter.GetExposure() * 0.5f / settings.key));
+
+	int brightenFrames = CountAdaptationFrames(settings, 0.05f, 2.0f);
+	int darkenFrames = CountAdaptationFrames(settings, 2.0f, 0.05f);
+
+	bool ok = grayError < 0.07f && brightenFrames < darkenFrames;
+	printf("Auto exposure: flat gray settles %.3f stops from the key, %d frames to brighten and %d to darken%s\n",
+		grayError,
+		brightenFrames,
+		darkenFrames,
+		ok ? "" : " (MISMATCH)");
+	return ok;
+}
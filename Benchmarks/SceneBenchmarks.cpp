@@ -0,0 +1,643 @@
+#include "Benchmarks.h"
+#include "Transform.h"
+#include "SceneGraph.h"
+#include "EntityStore.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
+#include "LightClusters.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times fetching the world and inverse transpose matrices
+// for 100k transforms that never move and 100k that move
+// every frame, averaged over a few frames
+// --------------------------------------------------------
+void BenchmarkTransforms()
+{
+	const int transformCount = 100000;
+	const int frameCount = 10;
+
+	std::vector<Transform> staticTransforms(transformCount);
+	std::vector<Transform> movingTransforms(transformCount);
+	for (int i = 0; i < transformCount; i++)
+	{
+		staticTransforms[i].SetPosition((float)i, 0, 0);
+		movingTransforms[i].SetPosition((float)i, 0, 0);
+	}
+
+	// Keeps the results alive so the work can't be skipped
+	float checksum = 0;
+	double staticSeconds = 0, movingSeconds = 0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		double startTime = GetTime();
+		for (int i = 0; i < transformCount; i++)
+		{
+			checksum += staticTransforms[i].GetWorldMatrix()._41;
+			checksum += staticTransforms[i].GetWorldInverseTransposeMatrix()._14;
+		}
+		double staticTime = GetTime();
+
+		for (int i = 0; i < transformCount; i++)
+		{
+			movingTransforms[i].Rotate(0.01f, 0, 0);
+			checksum += movingTransforms[i].GetWorldMatrix()._41;
+			checksum += movingTransforms[i].GetWorldInverseTransposeMatrix()._14;
+		}
+		double movingTime = GetTime();
+
+		staticSeconds += staticTime - startTime;
+		movingSeconds += movingTime - staticTime;
+	}
+
+	printf("Transforms: %d static in %.3f ms/frame, %d moving in %.3f ms/frame (checksum %g)\n",
+		transformCount, staticSeconds * 1000.0 / frameCount,
+		transformCount, movingSeconds * 1000.0 / frameCount,
+		checksum);
+}
+
+// --------------------------------------------------------
+// Times one frame of hierarchy updates for 100k-node deep
+// (a single chain) and wide (one root, all else children)
+// hierarchies, with the root moving every frame.  Compares
+// pulling each Transform's matrices through its parent
+// pointers against SceneGraph's single batched pass.
+// --------------------------------------------------------
+void BenchmarkHierarchies()
+{
+	const int nodeCount = 100000;
+	const int frameCount = 10;
+	const char* shapes[2] = { "deep", "wide" };
+
+	for (int shape = 0; shape < 2; shape++)
+	{
+		bool deep = shape == 0;
+
+		// Constructed in place, so the parent pointers stay valid
+		std::vector<Transform> transforms(nodeCount);
+		SceneGraph sceneGraph;
+		sceneGraph.Reserve(nodeCount);
+		sceneGraph.AddNode();
+		for (int i = 1; i < nodeCount; i++)
+		{
+			int parent = deep ? i - 1 : 0;
+			transforms[i].SetParent(&transforms[parent]);
+			transforms[i].SetPosition(0, 0, 1);
+			sceneGraph.SetPosition(sceneGraph.AddNode(parent), XMFLOAT3(0, 0, 1));
+		}
+
+		float checksum = 0;
+		double transformSeconds = 0, sceneGraphSeconds = 0;
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			double startTime = GetTime();
+
+			transforms[0].Rotate(0, 0.01f, 0);
+			for (int i = 0; i < nodeCount; i++)
+				checksum += transforms[i].GetWorldMatrix()._41;
+			double transformTime = GetTime();
+
+			sceneGraph.SetRotation(0, XMFLOAT3(0, 0.01f * (frame + 1), 0));
+			sceneGraph.UpdateWorldMatrices();
+			for (int i = 0; i < nodeCount; i++)
+				checksum += sceneGraph.GetWorldMatrix(i)._41;
+			double sceneGraphTime = GetTime();
+
+			transformSeconds += transformTime - startTime;
+			sceneGraphSeconds += sceneGraphTime - transformTime;
+		}
+
+		printf("Hierarchy: %d nodes %s - Transform %.3f ms/frame, SceneGraph %.3f ms/frame (checksum %g)\n",
+			nodeCount, shapes[shape],
+			transformSeconds * 1000.0 / frameCount,
+			sceneGraphSeconds * 1000.0 / frameCount,
+			checksum);
+	}
+}
+
+// The entity layout EntityStore replaced
+struct SharedPtrEntity
+{
+	Transform transform;
+	Mesh* mesh;
+	std::shared_ptr<Material> material;
+};
+
+// --------------------------------------------------------
+// Times one headless frame (update every entity's rotation
+// and matrices, then build the draw list) for 1M entities,
+// stored the old way - one shared_ptr per entity, iterated
+// by value - and in an EntityStore
+// --------------------------------------------------------
+void BenchmarkEntityStorage()
+{
+	const int entityCount = 1000000;
+
+	// Stand-ins that are never dereferenced.  The material is
+	// still shared, so copying its pointer costs what it did.
+	static char states[2];
+	Mesh* mesh = reinterpret_cast<Mesh*>(&states[0]);
+	std::shared_ptr<Material> material(reinterpret_cast<Material*>(&states[1]), [](Material*) {});
+
+	std::vector<std::shared_ptr<SharedPtrEntity>> sharedEntities;
+	EntityStore store;
+	store.Reserve(entityCount);
+	for (int i = 0; i < entityCount; i++)
+	{
+		XMFLOAT3 position((float)(i % 1000), 0, (float)(i / 1000));
+
+		std::shared_ptr<SharedPtrEntity> entity = std::make_shared<SharedPtrEntity>();
+		entity->transform.SetPosition(position.x, position.y, position.z);
+		entity->mesh = mesh;
+		entity->material = material;
+		sharedEntities.push_back(entity);
+
+		store.Create(mesh, material.get(), position);
+	}
+
+	std::vector<DrawItem> drawList;
+	drawList.reserve(entityCount);
+	float checksum = 0;
+
+	// The old layout
+	double startTime = GetTime();
+	for (std::shared_ptr<SharedPtrEntity> entity : sharedEntities)
+		entity->transform.Rotate(0.01f, 0, 0);
+
+	drawList.clear();
+	unsigned int index = 0;
+	for (std::shared_ptr<SharedPtrEntity> entity : sharedEntities)
+	{
+		checksum += entity->transform.GetWorldMatrix()._41;
+		checksum += entity->transform.GetWorldInverseTransposeMatrix()._14;
+		DrawItem item = { entity->mesh, entity->material.get(), index++ };
+		drawList.push_back(item);
+	}
+	double sharedTime = GetTime();
+
+	// Dense arrays
+	for (unsigned int i = 0; i < store.GetCount(); i++)
+		store.Rotate(i, 0.01f, 0, 0);
+
+	store.UpdateWorldMatrices();
+	store.BuildDrawList(drawList);
+	for (unsigned int i = 0; i < drawList.size(); i++)
+	{
+		checksum += store.GetWorldMatrix(drawList[i].entityIndex)._41;
+		checksum += store.GetWorldInverseTransposeMatrix(drawList[i].entityIndex)._14;
+	}
+	double storeTime = GetTime();
+
+	printf("Entities: %d updated and listed - shared_ptr %.2f ms, EntityStore %.2f ms (checksum %g)\n",
+		entityCount,
+		(sharedTime - startTime) * 1000.0,
+		(storeTime - sharedTime) * 1000.0,
+		checksum);
+}
+
+// --------------------------------------------------------
+// The view and projection of the game's starting camera, at
+// (0, 0, -1) looking down +Z, built here so the benchmarks
+// don't need Camera and its input handling
+// --------------------------------------------------------
+static void GetStartingCamera(XMFLOAT4X4& view, XMFLOAT4X4& projection)
+{
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(
+		XMVectorSet(0.0f, 0.0f, -1.0f, 1.0f),
+		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 0.01f, 100.0f));
+}
+
+// --------------------------------------------------------
+// Culls 1M randomly placed spheres against the frustum of
+// the game's starting camera with both the SSE and scalar
+// paths, checks they agree and reports entities/ms for each
+// --------------------------------------------------------
+bool BenchmarkFrustumCulling()
+{
+	const unsigned int sphereCount = 1000000;
+
+	std::vector<float> centerX(sphereCount), centerY(sphereCount), centerZ(sphereCount), radius(sphereCount);
+	srand(12345);
+	for (unsigned int i = 0; i < sphereCount; i++)
+	{
+		centerX[i] = (rand() / (float)RAND_MAX - 0.5f) * 200.0f;
+		centerY[i] = (rand() / (float)RAND_MAX - 0.5f) * 200.0f;
+		centerZ[i] = (rand() / (float)RAND_MAX - 0.5f) * 200.0f;
+		radius[i] = rand() / (float)RAND_MAX * 5.0f;
+	}
+
+	XMFLOAT4X4 view, projection, viewProjection;
+	GetStartingCamera(view, projection);
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+	XMFLOAT4 planes[6];
+	Frustum::ExtractPlanes(viewProjection, planes);
+
+	std::vector<unsigned int> visible(sphereCount), visibleScalar(sphereCount);
+
+	double startTime = GetTime();
+	unsigned int visibleCount = Frustum::CullSpheres(&centerX[0], &centerY[0], &centerZ[0], &radius[0], sphereCount, planes, &visible[0]);
+	double simdTime = GetTime();
+	unsigned int visibleCountScalar = Frustum::CullSpheresScalar(&centerX[0], &centerY[0], &centerZ[0], &radius[0], sphereCount, planes, &visibleScalar[0]);
+	double scalarTime = GetTime();
+
+	bool match = visibleCount == visibleCountScalar &&
+		std::equal(visible.begin(), visible.begin() + visibleCount, visibleScalar.begin());
+
+	double simdMs = (simdTime - startTime) * 1000.0;
+	double scalarMs = (scalarTime - simdTime) * 1000.0;
+	printf("Culling: %u of %u spheres visible - SSE %.0f entities/ms, scalar %.0f entities/ms%s\n",
+		visibleCount, sphereCount,
+		simdMs > 0 ? sphereCount / simdMs : 0.0,
+		scalarMs > 0 ? sphereCount / scalarMs : 0.0,
+		match ? "" : " (MISMATCH)");
+	return match;
+}
+
+// --------------------------------------------------------
+// Queues 100k draws spread over 4 shader pairs, 32 materials
+// and 16 meshes, and counts the state binds and (instanced)
+// draws a recording command list receives before and after
+// sorting.  Drawing each entity on its own (the old way)
+// binds shaders, material and mesh for every draw.  Also
+// checks that transparent draws come out back to front,
+// whatever their state, and that opaque and transparent
+// draws with the same state never share a run.
+// --------------------------------------------------------
+bool BenchmarkRenderQueue()
+{
+	const unsigned int drawCount = 100000;
+	const int shaderCount = 4;
+	const int materialCount = 32;
+	const int meshCount = 16;
+
+	// Stand-in addresses: the recording list never dereferences them
+	static char states[2 * shaderCount + materialCount + meshCount];
+	char* vertexShaders = states;
+	char* pixelShaders = vertexShaders + shaderCount;
+	char* materials = pixelShaders + shaderCount;
+	char* meshes = materials + materialCount;
+
+	RenderQueue queue;
+	queue.Reserve(drawCount);
+	srand(12345);
+	for (unsigned int i = 0; i < drawCount; i++)
+	{
+		int material = rand() % materialCount;
+		int shader = material % shaderCount;
+		int mesh = rand() % meshCount;
+		RenderSortIDs sortIDs = { (unsigned int)shader, (unsigned int)shader, (unsigned int)material, (unsigned int)mesh };
+		queue.Add(
+			RENDER_PASS_OPAQUE,
+			reinterpret_cast<SimpleVertexShader*>(vertexShaders + shader),
+			reinterpret_cast<SimplePixelShader*>(pixelShaders + shader),
+			reinterpret_cast<Material*>(materials + material),
+			reinterpret_cast<Mesh*>(meshes + mesh),
+			sortIDs,
+			rand() / (float)RAND_MAX * 100.0f,
+			i);
+	}
+
+	RecordingCommandList recording;
+	queue.Submit(recording);
+	unsigned int unsortedBinds = recording.GetBindCount();
+
+	double startTime = GetTime();
+	queue.Sort();
+	double endTime = GetTime();
+
+	recording.Clear();
+	queue.Submit(recording);
+
+	printf("Render queue: %u entities in %u draws - %u binds per entity, %u unsorted, %u sorted (%u redundant), radix sort %.3f ms\n",
+		recording.GetInstanceCount(),
+		recording.GetDrawCount(),
+		drawCount * 3,
+		unsortedBinds,
+		recording.GetBindCount(),
+		recording.GetRedundantBindCount(),
+		(endTime - startTime) * 1000.0);
+
+	// Transparent draws over the same materials, where each
+	// draw's first entity index looks up its depth
+	std::vector<float> depths(1000);
+	queue.Clear();
+	for (unsigned int i = 0; i < depths.size(); i++)
+	{
+		int material = rand() % materialCount;
+		int shader = material % shaderCount;
+		depths[i] = rand() / (float)RAND_MAX * 100.0f;
+		RenderSortIDs sortIDs = { (unsigned int)shader, (unsigned int)shader, (unsigned int)material, 0 };
+		queue.Add(
+			RENDER_PASS_TRANSPARENT,
+			reinterpret_cast<SimpleVertexShader*>(vertexShaders + shader),
+			reinterpret_cast<SimplePixelShader*>(pixelShaders + shader),
+			reinterpret_cast<Material*>(materials + material),
+			reinterpret_cast<Mesh*>(meshes),
+			sortIDs,
+			depths[i],
+			i);
+	}
+	queue.Sort();
+
+	recording.Clear();
+	queue.Submit(recording);
+
+	// Depth only keeps the top 16 bits of the float, so
+	// nearby draws may tie
+	float previousDepth = FLT_MAX;
+	unsigned int outOfOrder = 0;
+	const std::vector<RenderCommand>& commands = recording.GetCommands();
+	for (unsigned int c = 0; c < commands.size(); c++)
+	{
+		if (commands[c].type != RENDER_COMMAND_DRAW)
+			continue;
+
+		float depth = depths[commands[c].entityIndex];
+		if (depth > previousDepth * 1.01f)
+			outOfOrder++;
+		previousDepth = depth;
+	}
+
+	printf("Render queue: %u transparent draws back to front, %u out of order%s\n",
+		(unsigned int)depths.size(),
+		outOfOrder,
+		outOfOrder == 0 ? "" : " (MISMATCH)");
+
+	// Identical state in both passes, interleaved, so only the
+	// pass can split them: one opaque run, then one transparent
+	// run, each after its SetPass()
+	const unsigned int mixedCount = 100;
+	queue.Clear();
+	for (unsigned int i = 0; i < mixedCount; i++)
+	{
+		RenderSortIDs sortIDs = { 0, 0, 0, 0 };
+		queue.Add(
+			i % 2 == 0 ? RENDER_PASS_OPAQUE : RENDER_PASS_TRANSPARENT,
+			reinterpret_cast<SimpleVertexShader*>(vertexShaders),
+			reinterpret_cast<SimplePixelShader*>(pixelShaders),
+			reinterpret_cast<Material*>(materials),
+			reinterpret_cast<Mesh*>(meshes),
+			sortIDs,
+			1.0f,
+			i);
+	}
+	queue.Sort();
+
+	recording.Clear();
+	queue.Submit(recording);
+
+	unsigned int passChanges = 0;
+	unsigned int wrongPassDraws = 0;
+	RenderPass pass = RENDER_PASS_OPAQUE;
+	for (unsigned int c = 0; c < commands.size(); c++)
+	{
+		if (commands[c].type == RENDER_COMMAND_SET_PASS)
+		{
+			pass = commands[c].pass;
+			passChanges++;
+		}
+		else if (commands[c].type == RENDER_COMMAND_DRAW)
+		{
+			RenderPass expected = commands[c].entityIndex % 2 == 0 ? RENDER_PASS_OPAQUE : RENDER_PASS_TRANSPARENT;
+			if (pass != expected || commands[c].count != mixedCount / 2)
+				wrongPassDraws++;
+		}
+	}
+
+	bool passesSplit = recording.GetDrawCount() == 2 && passChanges == 2 && wrongPassDraws == 0;
+	printf("Render queue: %u draws with shared state in both passes - %u runs, %u pass changes%s\n",
+		mixedCount,
+		recording.GetDrawCount(),
+		passChanges,
+		passesSplit ? "" : " (MISMATCH)");
+	return outOfOrder == 0 && passesSplit;
+}
+
+// --------------------------------------------------------
+// Packs every third of 10k entities as instance data, like
+// one instanced draw would, and checks each entry against
+// the store's own matrices
+// --------------------------------------------------------
+bool CheckInstancePacking()
+{
+	const unsigned int entityCount = 10000;
+
+	EntityStore store;
+	store.Reserve(entityCount);
+	srand(12345);
+	for (unsigned int i = 0; i < entityCount; i++)
+	{
+		unsigned int index = store.GetIndex(store.Create(0, 0, XMFLOAT3((float)rand(), (float)rand(), (float)rand())));
+		store.SetRotation(index, XMFLOAT3(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX));
+		store.SetScale(index, XMFLOAT3(1.0f + rand() % 4, 1.0f + rand() % 4, 1.0f + rand() % 4));
+	}
+	store.UpdateWorldMatrices();
+
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < entityCount; i += 3)
+		indices.push_back(i);
+
+	std::vector<InstanceData> instances(indices.size());
+	store.GatherInstances(&indices[0], (unsigned int)indices.size(), &instances[0]);
+
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < indices.size(); i++)
+	{
+		if (memcmp(&instances[i].worldMatrix, &store.GetWorldMatrix(indices[i]), sizeof(XMFLOAT4X4)) != 0 ||
+			memcmp(&instances[i].worldInvTranspose, &store.GetWorldInverseTransposeMatrix(indices[i]), sizeof(XMFLOAT4X4)) != 0)
+			mismatches++;
+	}
+
+	printf("Instancing: packed %u instances (%u bytes each)%s\n",
+		(unsigned int)instances.size(), (unsigned int)sizeof(InstanceData),
+		mismatches == 0 ? "" : " (MISMATCH)");
+	return mismatches == 0;
+}
+
+// --------------------------------------------------------
+// Largest difference between two matrices' elements
+// --------------------------------------------------------
+static float MaxMatrixDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+{
+	float maxDifference = 0;
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			maxDifference = fmaxf(maxDifference, fabsf(a.m[r][c] - b.m[r][c]));
+	return maxDifference;
+}
+
+// --------------------------------------------------------
+// Builds the same root -> middle -> leaf chain with Transforms
+// and in an EntityStore, with every child stored before its
+// parent, and checks the world matrices match after moving
+// the root and after destroying entities (which moves the
+// leaf ahead of its parent again, then orphans it)
+// --------------------------------------------------------
+bool CheckEntityParenting()
+{
+	Transform transforms[3];
+	transforms[0].SetPosition(1, 2, 3);
+	transforms[0].SetRotation(0.3f, 0.2f, 0.1f);
+	transforms[0].SetScale(2, 2, 2);
+	transforms[1].SetPosition(0, 1, 0);
+	transforms[1].SetRotation(0, 0.5f, 0);
+	transforms[1].SetScale(1, 3, 1);
+	transforms[2].SetPosition(0, 0, 4);
+	transforms[1].SetParent(&transforms[0]);
+	transforms[2].SetParent(&transforms[1]);
+
+	// Created leaf first, after a filler that gets destroyed
+	EntityStore store;
+	EntityID filler = store.Create(0, 0, XMFLOAT3(0, 0, 0));
+	EntityID ids[3];
+	for (int i = 2; i >= 0; i--)
+	{
+		XMFLOAT3 position = transforms[i].GetPosition();
+		ids[i] = store.Create(0, 0, position);
+	}
+	store.SetRotation(store.GetIndex(ids[0]), XMFLOAT3(0.3f, 0.2f, 0.1f));
+	store.SetScale(store.GetIndex(ids[0]), XMFLOAT3(2, 2, 2));
+	store.SetRotation(store.GetIndex(ids[1]), XMFLOAT3(0, 0.5f, 0));
+	store.SetScale(store.GetIndex(ids[1]), XMFLOAT3(1, 3, 1));
+	store.SetParent(store.GetIndex(ids[1]), store.GetIndex(ids[0]));
+	store.SetParent(store.GetIndex(ids[2]), store.GetIndex(ids[1]));
+
+	// Would make a cycle, so it must be ignored
+	store.SetParent(store.GetIndex(ids[0]), store.GetIndex(ids[2]));
+
+	float maxDifference = 0;
+	for (int step = 0; step < 3; step++)
+	{
+		if (step == 1)
+		{
+			store.Destroy(filler);
+			transforms[0].SetPosition(-5, 0, 1);
+			store.SetPosition(store.GetIndex(ids[0]), XMFLOAT3(-5, 0, 1));
+		}
+		else if (step == 2)
+		{
+			transforms[2].SetParent(0);
+			store.Destroy(ids[1]);
+		}
+
+		store.UpdateWorldMatrices();
+		for (int i = 0; i < 3; i++)
+		{
+			if (step == 2 && i == 1)
+				continue;
+
+			maxDifference = fmaxf(maxDifference, MaxMatrixDifference(transforms[i].GetWorldMatrix(), store.GetWorldMatrix(store.GetIndex(ids[i]))));
+			maxDifference = fmaxf(maxDifference, MaxMatrixDifference(transforms[i].GetWorldInverseTransposeMatrix(), store.GetWorldInverseTransposeMatrix(store.GetIndex(ids[i]))));
+		}
+	}
+
+	bool match = maxDifference < 0.0001f && store.GetParent(store.GetIndex(ids[2])) == ENTITY_STORE_INVALID_INDEX;
+	printf("Entity parenting: max difference from Transform %g%s\n",
+		maxDifference,
+		match ? "" : " (MISMATCH)");
+	return match;
+}
+
+// --------------------------------------------------------
+// Bins 10k point and spot lights (and a few directional
+// ones) in front of the game's starting camera, checks the
+// clusters match the brute force ones, and checks that
+// every light in range of a sample of points is in that
+// point's cluster
+// --------------------------------------------------------
+bool BenchmarkLightClusters()
+{
+	const unsigned int lightCount = 10000;
+	const int frameCount = 10;
+	const int sampleCount = 2000;
+
+	std::vector<Light> sceneLights(lightCount);
+	srand(12345);
+	for (unsigned int i = 0; i < lightCount; i++)
+	{
+		Light& light = sceneLights[i];
+		light = {};
+		light.Type = i % 1000 == 0 ? LIGHT_TYPE_DIRECTIONAL : (i % 3 == 0 ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT);
+		light.Direction = XMFLOAT3(0, 0, 1);
+		light.Position = XMFLOAT3(
+			(rand() / (float)RAND_MAX - 0.5f) * 100.0f,
+			(rand() / (float)RAND_MAX - 0.5f) * 60.0f,
+			rand() / (float)RAND_MAX * 100.0f);
+		light.Range = 0.5f + rand() / (float)RAND_MAX * 4.5f;
+	}
+
+	XMFLOAT4X4 view, projection;
+	GetStartingCamera(view, projection);
+
+	LightClusters clusters, bruteForce;
+
+	double startTime = GetTime();
+	for (int frame = 0; frame < frameCount; frame++)
+		clusters.Build(view, projection, &sceneLights[0], lightCount);
+	double builtTime = GetTime();
+	bruteForce.BuildBruteForce(view, projection, &sceneLights[0], lightCount);
+	double bruteForceTime = GetTime();
+
+	bool match = clusters.GetLightIndices() == bruteForce.GetLightIndices();
+	for (unsigned int c = 0; c < LightClusters::ClusterCount; c++)
+	{
+		match = match &&
+			clusters.GetClusters()[c].offset == bruteForce.GetClusters()[c].offset &&
+			clusters.GetClusters()[c].count == bruteForce.GetClusters()[c].count;
+	}
+
+	// Random view space points inside the frustum, found a
+	// cluster the way the pixel shader would
+	unsigned int inRange = 0, missing = 0;
+	for (int s = 0; s < sampleCount; s++)
+	{
+		float depth = 0.1f + rand() / (float)RAND_MAX * 99.9f;
+		XMFLOAT3 point(
+			(rand() / (float)RAND_MAX * 2.0f - 1.0f) * depth / projection._11,
+			(rand() / (float)RAND_MAX * 2.0f - 1.0f) * depth / projection._22,
+			depth);
+
+		const LightCluster& cluster = clusters.GetClusters()[clusters.GetClusterIndex(point)];
+		const unsigned int* begin = &clusters.GetLightIndices()[0] + cluster.offset;
+		const unsigned int* end = begin + cluster.count;
+
+		for (unsigned int l = 0; l < lightCount; l++)
+		{
+			const XMFLOAT3& p = sceneLights[l].Position;
+			float x = p.x * view._11 + p.y * view._21 + p.z * view._31 + view._41 - point.x;
+			float y = p.x * view._12 + p.y * view._22 + p.z * view._32 + view._42 - point.y;
+			float z = p.x * view._13 + p.y * view._23 + p.z * view._33 + view._43 - point.z;
+			if (sceneLights[l].Type == LIGHT_TYPE_DIRECTIONAL || x * x + y * y + z * z < sceneLights[l].Range * sceneLights[l].Range)
+			{
+				inRange++;
+				if (!std::binary_search(begin, end, l))
+					missing++;
+			}
+		}
+	}
+
+	double buildMs = (builtTime - startTime) * 1000.0 / frameCount;
+	double bruteForceMs = (bruteForceTime - builtTime) * 1000.0;
+	printf("Light clusters: %u lights, %.1f per cluster (of %u clusters) - build %.3f ms, brute force %.3f ms%s, %u of %u lights in range missing%s\n",
+		lightCount,
+		(double)clusters.GetLightIndices().size() / LightClusters::ClusterCount,
+		LightClusters::ClusterCount,
+		buildMs,
+		bruteForceMs,
+		match ? "" : " (MISMATCH)",
+		missing,
+		inRange,
+		missing == 0 ? "" : " (MISSING LIGHTS)");
+	return match && missing == 0;
+}
@@ -0,0 +1,158 @@
+#include "Benchmarks.h"
+#include "LayoutOnlyShader.h"
+#include "Lights.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace DirectX;
+
+// PixelShader.hlsl and VertexShader.hlsl with everything in one
+// ExternalData buffer, as they were before the split
+static const unsigned int singlePixelBufferSizes[] = { 8256 };
+static const LayoutVariable singlePixelLayout[] = {
+	{ "lights", 0, 0, 8192 }, { "lightCount", 0, 8192, 4 }, { "ambient", 0, 8196, 12 }, { "cameraPosition", 0, 8208, 12 },
+	{ "colorTint", 0, 8224, 16 }, { "uvScale", 0, 8240, 8 }, { "uvOffset", 0, 8248, 8 } };
+static const unsigned int singleVertexBufferSizes[] = { 256 };
+static const LayoutVariable singleVertexLayout[] = {
+	{ "worldMatrix", 0, 0, 64 }, { "viewMatrix", 0, 64, 64 }, { "projectionMatrix", 0, 128, 64 }, { "worldInvTranspose", 0, 192, 64 } };
+
+// The PerFrame, PerMaterial and PerObject split (before the
+// lights moved to a structured buffer)
+static const unsigned int splitPixelBufferSizes[] = { 8224, 32 };
+static const LayoutVariable splitPixelLayout[] = {
+	{ "lights", 0, 0, 8192 }, { "lightCount", 0, 8192, 4 }, { "ambient", 0, 8196, 12 }, { "cameraPosition", 0, 8208, 12 },
+	{ "colorTint", 1, 0, 16 }, { "uvScale", 1, 16, 8 }, { "uvOffset", 1, 24, 8 } };
+static const unsigned int splitVertexBufferSizes[] = { 128, 128 };
+static const LayoutVariable splitVertexLayout[] = {
+	{ "viewMatrix", 0, 0, 64 }, { "projectionMatrix", 0, 64, 64 }, { "worldMatrix", 1, 0, 64 }, { "worldInvTranspose", 1, 64, 64 } };
+
+// --------------------------------------------------------
+// Times 1M variable sets by name and through pre-resolved
+// handles, cycling through some of the pixel shader's
+// variables, and checks both paths wrote the same data
+// --------------------------------------------------------
+bool BenchmarkShaderSetters()
+{
+	const int setCount = 1000000;
+
+	LayoutOnlyShader byName(splitPixelBufferSizes, 2, splitPixelLayout, 7);
+	LayoutOnlyShader byHandle(splitPixelBufferSizes, 2, splitPixelLayout, 7);
+	SimpleShaderHandle ambient = byHandle.GetHandle("ambient");
+	SimpleShaderHandle cameraPosition = byHandle.GetHandle("cameraPosition");
+	SimpleShaderHandle colorTint = byHandle.GetHandle("colorTint");
+	SimpleShaderHandle uvScale = byHandle.GetHandle("uvScale");
+
+	double startTime = GetTime();
+	for (int i = 0; i < setCount; i += 4)
+	{
+		float f = (float)i;
+		byName.SetFloat3("ambient", XMFLOAT3(f, f, f));
+		byName.SetFloat3("cameraPosition", XMFLOAT3(f, 0, f));
+		byName.SetFloat4("colorTint", XMFLOAT4(f, f, f, 1));
+		byName.SetFloat2("uvScale", XMFLOAT2(f, 1));
+	}
+	double nameTime = GetTime();
+
+	for (int i = 0; i < setCount; i += 4)
+	{
+		float f = (float)i;
+		byHandle.SetFloat3(ambient, XMFLOAT3(f, f, f));
+		byHandle.SetFloat3(cameraPosition, XMFLOAT3(f, 0, f));
+		byHandle.SetFloat4(colorTint, XMFLOAT4(f, f, f, 1));
+		byHandle.SetFloat2(uvScale, XMFLOAT2(f, 1));
+	}
+	double handleTime = GetTime();
+
+	bool match = true;
+	for (unsigned int b = 0; b < byName.GetBufferCount(); b++)
+		match = match && memcmp(byName.GetBufferInfo(b)->LocalDataBuffer, byHandle.GetBufferInfo(b)->LocalDataBuffer, byName.GetBufferSize(b)) == 0;
+
+	double nameNs = (nameTime - startTime) * 1e9 / setCount;
+	double handleNs = (handleTime - nameTime) * 1e9 / setCount;
+	printf("Shader setters: %d sets - by name %.1f ns/set, by handle %.1f ns/set%s\n",
+		setCount, nameNs, handleNs, match ? "" : " (MISMATCH)");
+	return match;
+}
+
+// --------------------------------------------------------
+// Replays one frame of DeviceCommandList's traffic - frame
+// data, then 100 moving entities split between two
+// materials - and returns the bytes uploaded
+//
+// copyEveryDraw - Upload whole buffers for every draw, the
+//                 way CopyAllBufferData used to
+// --------------------------------------------------------
+static unsigned int ReplayConstantBufferFrame(LayoutOnlyShader& vs, LayoutOnlyShader& ps, int frame, bool copyEveryDraw)
+{
+	const int drawCount = 100;
+
+	std::vector<Light> sceneLights(128);
+	for (unsigned int i = 0; i < sceneLights.size(); i++)
+		sceneLights[i].Range = (float)i;
+
+	vs.uploadedBytes = 0;
+	ps.uploadedBytes = 0;
+
+	// The camera and entities move every frame; lights don't
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixTranslation(0, 0, (float)frame));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f));
+	vs.SetMatrix4x4("viewMatrix", view);
+	vs.SetMatrix4x4("projectionMatrix", projection);
+	ps.SetData("lights", &sceneLights[0], sizeof(Light) * (unsigned int)sceneLights.size());
+	ps.SetInt("lightCount", (int)sceneLights.size());
+	ps.SetFloat3("cameraPosition", XMFLOAT3(0, 0, (float)frame));
+
+	for (int i = 0; i < drawCount; i++)
+	{
+		// The queue sorts by material, so it changes once
+		if (i == 0 || i == drawCount / 2)
+			ps.SetFloat4("colorTint", i == 0 ? XMFLOAT4(1, 1, 1, 1) : XMFLOAT4(1, 0, 0, 1));
+
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixTranslation((float)i, (float)frame, 0));
+		vs.SetMatrix4x4("worldMatrix", world);
+		vs.SetMatrix4x4("worldInvTranspose", world);
+
+		if (copyEveryDraw)
+		{
+			for (unsigned int b = 0; b < vs.GetBufferCount(); b++) vs.CopyBufferData(b);
+			for (unsigned int b = 0; b < ps.GetBufferCount(); b++) ps.CopyBufferData(b);
+		}
+		else
+		{
+			vs.CopyAllBufferData();
+			ps.CopyAllBufferData();
+		}
+	}
+
+	return vs.uploadedBytes + ps.uploadedBytes;
+}
+
+// --------------------------------------------------------
+// Compares constant buffer upload bytes per frame (after the
+// first) across the old single-buffer shaders copied every
+// draw, the same with dirty tracking, and the shaders split
+// into per-frame, per-material and per-object buffers
+// --------------------------------------------------------
+void BenchmarkConstantBufferUploads()
+{
+	LayoutOnlyShader singleVS(singleVertexBufferSizes, 1, singleVertexLayout, 4);
+	LayoutOnlyShader singlePS(singlePixelBufferSizes, 1, singlePixelLayout, 7);
+	LayoutOnlyShader dirtySingleVS(singleVertexBufferSizes, 1, singleVertexLayout, 4);
+	LayoutOnlyShader dirtySinglePS(singlePixelBufferSizes, 1, singlePixelLayout, 7);
+	LayoutOnlyShader splitVS(splitVertexBufferSizes, 2, splitVertexLayout, 4);
+	LayoutOnlyShader splitPS(splitPixelBufferSizes, 2, splitPixelLayout, 7);
+
+	unsigned int everyDrawBytes = 0, dirtyBytes = 0, splitBytes = 0;
+	for (int frame = 0; frame < 3; frame++)
+	{
+		everyDrawBytes = ReplayConstantBufferFrame(singleVS, singlePS, frame, true);
+		dirtyBytes = ReplayConstantBufferFrame(dirtySingleVS, dirtySinglePS, frame, false);
+		splitBytes = ReplayConstantBufferFrame(splitVS, splitPS, frame, false);
+	}
+
+	printf("Constant buffers: bytes/frame - single buffer every draw %u, with dirty tracking %u, split by frequency %u (%.1fx less)\n",
+		everyDrawBytes, dirtyBytes, splitBytes,
+		splitBytes > 0 ? (double)everyDrawBytes / splitBytes : 0.0);
+}
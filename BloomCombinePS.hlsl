@@ -1,9 +1,14 @@
+#define BLOOM_MAX_LEVELS	5
+
+// Must match Tonemapper in BloomFilter.h
+#define TONEMAPPER_REINHARD	0
+#define TONEMAPPER_ACES		1
+
 cbuffer externalData : register(b0) {
-	float intensityLevel0;
-	float intensityLevel1;
-	float intensityLevel2;
-	float intensityLevel3;
-	float intensityLevel4;
+	// One per level, in x (array elements take 16 bytes)
+	float4 intensities[BLOOM_MAX_LEVELS];
+	float exposure;		// On top of the auto exposure
+	int tonemapper;
 }
 
 struct VertexToPixel {
@@ -17,16 +22,37 @@ Texture2D bloomedPixels1	: register(t2);
 Texture2D bloomedPixels2	: register(t3);
 Texture2D bloomedPixels3	: register(t4);
 Texture2D bloomedPixels4	: register(t5);
+StructuredBuffer<float> exposureState	: register(t6);	// The auto exposure first (see AutoExposureCS)
 SamplerState samplerOptions	: register(s0);
 
+float3 Tonemap(float3 color)
+{
+	if (tonemapper == TONEMAPPER_ACES)
+		return saturate((color * (2.51f * color + 0.03f)) / (color * (2.43f * color + 0.59f) + 0.14f));
+	return saturate(color / (1.0f + color));
+}
+
+float3 EncodeSRGB(float3 color)
+{
+	return color <= 0.0031308f ? color * 12.92f : 1.055f * pow(color, 1.0f / 2.4f) - 0.055f;
+}
+
+// --------------------------------------------------------
+// Adds the bloom levels to the scene, then exposes,
+// tonemaps and sRGB encodes the result straight into the
+// back buffer, all in one pass (see BloomFilter::Combine()
+// and BloomFilter::Resolve() for the CPU reference)
+//
+// Levels that weren't drawn are unbound, and sample as black.
+// --------------------------------------------------------
 float4 main(VertexToPixel input) : SV_TARGET
 {
-	float4 totalColor = originalPixels.Sample(samplerOptions, input.uv);
-	totalColor += bloomedPixels0.Sample(samplerOptions, input.uv) * intensityLevel0;
-	totalColor += bloomedPixels1.Sample(samplerOptions, input.uv) * intensityLevel1;
-	totalColor += bloomedPixels2.Sample(samplerOptions, input.uv) * intensityLevel2;
-	totalColor += bloomedPixels3.Sample(samplerOptions, input.uv) * intensityLevel3;
-	totalColor += bloomedPixels4.Sample(samplerOptions, input.uv) * intensityLevel4;
-
-	return totalColor;
+	float3 totalColor = originalPixels.Sample(samplerOptions, input.uv).rgb;
+	totalColor += bloomedPixels0.Sample(samplerOptions, input.uv).rgb * intensities[0].x;
+	totalColor += bloomedPixels1.Sample(samplerOptions, input.uv).rgb * intensities[1].x;
+	totalColor += bloomedPixels2.Sample(samplerOptions, input.uv).rgb * intensities[2].x;
+	totalColor += bloomedPixels3.Sample(samplerOptions, input.uv).rgb * intensities[3].x;
+	totalColor += bloomedPixels4.Sample(samplerOptions, input.uv).rgb * intensities[4].x;
+
+	return float4(EncodeSRGB(Tonemap(max(totalColor * exposure * exposureState[0], 0))), 1);
 }
\ No newline at end of file
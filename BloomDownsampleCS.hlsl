@@ -0,0 +1,90 @@
+// Largest blur radius, which sizes the groupshared tiles.
+// Must match BloomFilter::MaxRadius.
+#define BLOOM_MAX_RADIUS	14
+#define BLOOM_TILE_SIZE		16
+#define BLOOM_APRON_SIZE	(BLOOM_TILE_SIZE + 2 * BLOOM_MAX_RADIUS)
+#define BLOOM_THREAD_COUNT	(BLOOM_TILE_SIZE * BLOOM_TILE_SIZE)
+
+cbuffer externalData : register(b0) {
+	float2 sourceTexelSize;
+	uint2 targetSize;
+	float threshold;	// Zero after the first level, and divided by the auto exposure
+	int radius;
+	int sourceStep;		// 2 to halve the source, 4 to quarter it
+
+	// One weight per texel, center first (only x is used)
+	float4 weights[BLOOM_MAX_RADIUS + 1];
+}
+
+Texture2D source			: register(t0);
+StructuredBuffer<float> exposureState	: register(t1);	// The auto exposure first (see AutoExposureCS)
+SamplerState samplerOptions	: register(s0);
+RWTexture2D<float4> target	: register(u0);
+
+// The tile's downsampled texels, plus the blur radius on
+// every side, and the same rows blurred horizontally
+groupshared float3 downsampled[BLOOM_APRON_SIZE][BLOOM_APRON_SIZE];
+groupshared float3 blurredRows[BLOOM_APRON_SIZE][BLOOM_TILE_SIZE];
+
+// --------------------------------------------------------
+// Halves (or quarters) the source and blurs it into one tile
+// of the next bloom level, replacing a bloom extract (or
+// downsample) and two single direction blur passes
+//
+// - Every source texel is read once per tile, with one
+//   bilinear sample per 2x2 block, instead of 15 samples
+//   per pixel per direction
+// - Texels past the edge are clamped, like the sampler
+// --------------------------------------------------------
+[numthreads(BLOOM_TILE_SIZE, BLOOM_TILE_SIZE, 1)]
+void main(uint3 groupID : SV_GroupID, uint3 threadID : SV_GroupThreadID, uint threadIndex : SV_GroupIndex)
+{
+	int2 apronOrigin = int2(groupID.xy * BLOOM_TILE_SIZE) - BLOOM_MAX_RADIUS;
+
+	float sceneThreshold = threshold / exposureState[0];
+
+	uint i;
+	for (i = threadIndex; i < BLOOM_APRON_SIZE * BLOOM_APRON_SIZE; i += BLOOM_THREAD_COUNT)
+	{
+		uint2 local = uint2(i % BLOOM_APRON_SIZE, i / BLOOM_APRON_SIZE);
+		int2 texel = clamp(apronOrigin + int2(local), 0, int2(targetSize) - 1);
+
+		float2 uv = (texel + 0.5f) * sourceStep * sourceTexelSize;
+		float3 color;
+		if (sourceStep == 2)
+			color = source.SampleLevel(samplerOptions, uv, 0).rgb;
+		else
+		{
+			// Four 2x2 averages make a 4x4 one
+			color = (
+				source.SampleLevel(samplerOptions, uv + float2(-1, -1) * sourceTexelSize, 0).rgb +
+				source.SampleLevel(samplerOptions, uv + float2(1, -1) * sourceTexelSize, 0).rgb +
+				source.SampleLevel(samplerOptions, uv + float2(-1, 1) * sourceTexelSize, 0).rgb +
+				source.SampleLevel(samplerOptions, uv + float2(1, 1) * sourceTexelSize, 0).rgb) * 0.25f;
+		}
+		downsampled[local.y][local.x] = max(color - sceneThreshold, 0);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// Every row of the apron, but only the tile's columns
+	for (i = threadIndex; i < BLOOM_APRON_SIZE * BLOOM_TILE_SIZE; i += BLOOM_THREAD_COUNT)
+	{
+		uint2 local = uint2(i % BLOOM_TILE_SIZE, i / BLOOM_TILE_SIZE);
+		uint center = local.x + BLOOM_MAX_RADIUS;
+
+		float3 total = downsampled[local.y][center] * weights[0].x;
+		for (int r = 1; r <= radius; r++)
+			total += (downsampled[local.y][center - r] + downsampled[local.y][center + r]) * weights[r].x;
+		blurredRows[local.y][local.x] = total;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	uint centerRow = threadID.y + BLOOM_MAX_RADIUS;
+	float3 total = blurredRows[centerRow][threadID.x] * weights[0].x;
+	for (int r = 1; r <= radius; r++)
+		total += (blurredRows[centerRow - r][threadID.x] + blurredRows[centerRow + r][threadID.x]) * weights[r].x;
+
+	uint2 texel = groupID.xy * BLOOM_TILE_SIZE + threadID.xy;
+	if (all(texel < targetSize))
+		target[texel] = float4(total, 1);
+}
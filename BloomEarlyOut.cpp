@@ -0,0 +1,59 @@
+#include "BloomEarlyOut.h"
+#include <math.h>
+
+BloomEarlyOut::BloomEarlyOut()
+{
+	this->hasResult = false;
+	this->maxValue = 0.0f;
+	this->resultAge = 0;
+}
+
+void BloomEarlyOut::BeginFrame()
+{
+	this->resultAge++;
+}
+
+// --------------------------------------------------------
+// Takes the brightest channel SceneMaxCS found, read back
+// ResultLatency frames after it was written
+// --------------------------------------------------------
+void BloomEarlyOut::SetResult(float maxValue)
+{
+	this->hasResult = true;
+	this->maxValue = maxValue;
+	this->resultAge = ResultLatency;
+}
+
+// --------------------------------------------------------
+// Goes back to running bloom until the next result, such as
+// when results were missed and the pending ones are stale
+// --------------------------------------------------------
+void BloomEarlyOut::ForgetResult()
+{
+	this->hasResult = false;
+}
+
+bool BloomEarlyOut::IsBloomNeeded(float threshold)
+{
+	if (!this->hasResult || this->resultAge > MaxResultAge)
+		return true;
+
+	return this->maxValue > threshold;
+}
+
+// --------------------------------------------------------
+// The brightest red, green or blue value of any texel, never
+// below zero (NaNs are skipped, as HLSL's max() does), times
+// the exposure.  Like SceneMaxCS, it scales the maximum
+// rather than each texel, which rounds to the same result.
+// --------------------------------------------------------
+float BloomEarlyOut::FindMaxValue(const BloomImage& image, float exposure)
+{
+	float maxValue = 0.0f;
+	for (size_t i = 0; i < image.pixels.size(); i++)
+	{
+		const DirectX::XMFLOAT4& pixel = image.pixels[i];
+		maxValue = fmaxf(maxValue, fmaxf(pixel.x, fmaxf(pixel.y, pixel.z)));
+	}
+	return maxValue * exposure;
+}
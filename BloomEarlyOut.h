@@ -0,0 +1,47 @@
+#pragma once
+
+#include "BloomFilter.h"
+
+// --------------------------------------------------------
+// Decides whether a frame needs the bloom chain at all
+//
+// The extract subtracts the threshold from every exposed
+// channel and clamps at zero, so if no channel of any scene
+// texel times the exposure is above it, every level is black
+// and bloom adds nothing.  SceneMaxCS finds that brightest
+// exposed channel on the GPU.
+// Reading it back right away would stall, so each result is
+// copied to a staging buffer and read ResultLatency frames
+// later instead.
+//
+// - Until a result arrives, or if they stop arriving, bloom
+//   runs, so skipping can only ever be ResultLatency frames
+//   late to bloom something that just got bright
+// - FindMaxValue() is the CPU reference of SceneMaxCS, given
+//   the exposure SceneMaxCS reads from exposureState[0]
+//
+// Needs no Direct3D device at all.
+// --------------------------------------------------------
+class BloomEarlyOut {
+public:
+	// Frames between a result being written and read (one
+	// staging buffer more than this is needed)
+	static const unsigned int ResultLatency = 2;
+
+	// Results older than this are ignored
+	static const unsigned int MaxResultAge = ResultLatency + 2;
+
+	BloomEarlyOut();
+
+	void BeginFrame();
+	void SetResult(float maxValue);
+	void ForgetResult();
+	bool IsBloomNeeded(float threshold);
+
+	static float FindMaxValue(const BloomImage& image, float exposure);
+
+private:
+	bool hasResult;
+	float maxValue;
+	unsigned int resultAge;
+};
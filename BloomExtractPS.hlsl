@@ -1,18 +1,34 @@
 cbuffer externalData : register(b0) {
 	float bloomThreshold;
+	int sourceStep;			// 2 for a half size target, 4 for a quarter size one
+	float2 sourceTexelSize;
 }
 
 struct VertexToPixel {
 	float4 position			: SV_POSITION;
-	float uv				: TEXCOORD0;
+	float2 uv				: TEXCOORD0;
 };
 
 Texture2D pixels			: register(t0);
+StructuredBuffer<float> exposureState	: register(t1);	// The auto exposure first (see AutoExposureCS)
 SamplerState samplerOptions	: register(s0);
 
 float4 main(VertexToPixel input) : SV_TARGET
 {
-	float4 pixelColor = pixels.Sample(samplerOptions, input.uv);
+	// One bilinear sample averages the 2x2 block under a half
+	// size pixel; a quarter size one needs four of them
+	float4 pixelColor;
+	if (sourceStep == 2)
+		pixelColor = pixels.Sample(samplerOptions, input.uv);
+	else
+	{
+		pixelColor = (
+			pixels.Sample(samplerOptions, input.uv + float2(-1, -1) * sourceTexelSize) +
+			pixels.Sample(samplerOptions, input.uv + float2(1, -1) * sourceTexelSize) +
+			pixels.Sample(samplerOptions, input.uv + float2(-1, 1) * sourceTexelSize) +
+			pixels.Sample(samplerOptions, input.uv + float2(1, 1) * sourceTexelSize)) * 0.25f;
+	}
 
-	return max(pixelColor - bloomThreshold, 0);
+	// The threshold is for the exposed scene
+	return max(pixelColor - bloomThreshold / exposureState[0], 0);
 }
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "BloomFilter.h"
+#include <math.h>
+
+using namespace DirectX;
+
+static const BloomTier tiers[BLOOM_QUALITY_COUNT] =
+{
+	{ "high", DXGI_FORMAT_R16G16B16A16_FLOAT, 2, 1.0f },
+	{ "medium", DXGI_FORMAT_R11G11B10_FLOAT, 2, 1.0f },
+	{ "low", DXGI_FORMAT_R11G11B10_FLOAT, 4, 0.5f },
+};
+
+static int ClampIndex(int index, int count)
+{
+	return index < 0 ? 0 : (index >= count ? count - 1 : index);
+}
+
+// --------------------------------------------------------
+// Rounds to the nearest float with this many mantissa bits
+// (past the implicit leading one), clamped to a format's
+// largest value.  Ignores denormals, which bloom can't see.
+// --------------------------------------------------------
+static float RoundMantissa(float value, int mantissaBits, float largest)
+{
+	if (value == 0.0f)
+		return 0.0f;
+
+	int exponent;
+	float mantissa = frexpf(value, &exponent);
+	float scale = (float)(1 << (mantissaBits + 1));
+	float rounded = ldexpf(roundf(mantissa * scale) / scale, exponent);
+	return rounded > largest ? largest : (rounded < -largest ? -largest : rounded);
+}
+
+const BloomTier& BloomFilter::GetTier(BloomQuality quality)
+{
+	return tiers[quality];
+}
+
+// --------------------------------------------------------
+// Width or height of a level step times smaller than its
+// source, never less than 1 so a tiny viewport still gets
+// texels to sample
+// --------------------------------------------------------
+unsigned int BloomFilter::LevelSize(unsigned int sourceSize, unsigned int step)
+{
+	unsigned int size = sourceSize / step;
+	return size > 0 ? size : 1;
+}
+
+// --------------------------------------------------------
+// Shrinks the source and blurs it horizontally, then
+// vertically, the way one BloomDownsampleCS dispatch does
+//
+// step      - 2 to halve the source, 4 to quarter it
+// threshold - Subtracted from every downsampled texel (zero
+//             after the first level)
+// --------------------------------------------------------
+void BloomFilter::DownsampleBlur(const BloomImage& source, unsigned int step, float threshold, const float* weights, int radius, BloomImage& target)
+{
+	int width = (int)LevelSize(source.width, step);
+	int height = (int)LevelSize(source.height, step);
+	if (radius > MaxRadius)
+		radius = MaxRadius;
+
+	// Sampling between the four texels of each 2x2 block
+	// averages them, and averaging four of those samples
+	// averages a 4x4 block
+	float du = 1.0f / source.width;
+	float dv = 1.0f / source.height;
+	std::vector<XMFLOAT4> downsampled(width * height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float u = (x + 0.5f) * step * du;
+			float v = (y + 0.5f) * step * dv;
+			XMFLOAT4 color;
+			if (step == 2)
+				color = SampleBilinear(source, u, v);
+			else
+			{
+				XMFLOAT4 a = SampleBilinear(source, u - du, v - dv);
+				XMFLOAT4 b = SampleBilinear(source, u + du, v - dv);
+				XMFLOAT4 c = SampleBilinear(source, u - du, v + dv);
+				XMFLOAT4 d = SampleBilinear(source, u + du, v + dv);
+				color = XMFLOAT4(
+					(a.x + b.x + c.x + d.x) * 0.25f,
+					(a.y + b.y + c.y + d.y) * 0.25f,
+					(a.z + b.z + c.z + d.z) * 0.25f,
+					1.0f);
+			}
+			downsampled[y * width + x] = XMFLOAT4(
+				fmaxf(color.x - threshold, 0.0f),
+				fmaxf(color.y - threshold, 0.0f),
+				fmaxf(color.z - threshold, 0.0f),
+				1.0f);
+		}
+	}
+
+	std::vector<XMFLOAT4> blurredRows(width * height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const XMFLOAT4& center = downsampled[y * width + x];
+			XMFLOAT4 total(center.x * weights[0], center.y * weights[0], center.z * weights[0], 1.0f);
+			for (int r = 1; r <= radius; r++)
+			{
+				const XMFLOAT4& left = downsampled[y * width + ClampIndex(x - r, width)];
+				const XMFLOAT4& right = downsampled[y * width + ClampIndex(x + r, width)];
+				total.x += (left.x + right.x) * weights[r];
+				total.y += (left.y + right.y) * weights[r];
+				total.z += (left.z + right.z) * weights[r];
+			}
+			blurredRows[y * width + x] = total;
+		}
+	}
+
+	target.width = width;
+	target.height = height;
+	target.pixels.resize(width * height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const XMFLOAT4& center = blurredRows[y * width + x];
+			XMFLOAT4 total(center.x * weights[0], center.y * weights[0], center.z * weights[0], 1.0f);
+			for (int r = 1; r <= radius; r++)
+			{
+				const XMFLOAT4& up = blurredRows[ClampIndex(y - r, height) * width + x];
+				const XMFLOAT4& down = blurredRows[ClampIndex(y + r, height) * width + x];
+				total.x += (up.x + down.x) * weights[r];
+				total.y += (up.y + down.y) * weights[r];
+				total.z += (up.z + down.z) * weights[r];
+			}
+			target.pixels[y * width + x] = total;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Adds each bloom level, upsampled to the original's size,
+// to the original
+// --------------------------------------------------------
+void BloomFilter::Combine(const BloomImage& original, const BloomImage* levels, const float* intensities, int levelCount, BloomImage& result)
+{
+	result.width = original.width;
+	result.height = original.height;
+	result.pixels = original.pixels;
+
+	for (unsigned int y = 0; y < original.height; y++)
+	{
+		for (unsigned int x = 0; x < original.width; x++)
+		{
+			float u = (x + 0.5f) / original.width;
+			float v = (y + 0.5f) / original.height;
+
+			XMFLOAT4& total = result.pixels[y * original.width + x];
+			for (int i = 0; i < levelCount; i++)
+			{
+				XMFLOAT4 bloom = SampleBilinear(levels[i], u, v);
+				total.x += bloom.x * intensities[i];
+				total.y += bloom.y * intensities[i];
+				total.z += bloom.z * intensities[i];
+				total.w += bloom.w * intensities[i];
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Scales every texel by the exposure, tonemaps and encodes
+// it, and rounds it to 8 bits per channel the way a UNORM
+// render target does (alpha is always opaque)
+// --------------------------------------------------------
+void BloomFilter::Resolve(const BloomImage& image, float exposure, Tonemapper tonemapper, std::vector<unsigned char>& rgba)
+{
+	rgba.resize(image.pixels.size() * 4);
+	for (size_t i = 0; i < image.pixels.size(); i++)
+	{
+		const float* pixel = &image.pixels[i].x;
+		for (int c = 0; c < 3; c++)
+		{
+			float value = EncodeSRGB(Tonemap(fmaxf(pixel[c] * exposure, 0.0f), tonemapper));
+			rgba[i * 4 + c] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+		rgba[i * 4 + 3] = 255;
+	}
+}
+
+// --------------------------------------------------------
+// Maps a non-negative HDR value into [0, 1]
+// --------------------------------------------------------
+float BloomFilter::Tonemap(float value, Tonemapper tonemapper)
+{
+	float mapped;
+	if (tonemapper == TONEMAPPER_ACES)
+		mapped = (value * (2.51f * value + 0.03f)) / (value * (2.43f * value + 0.59f) + 0.14f);
+	else
+		mapped = value / (1.0f + value);
+
+	return fminf(fmaxf(mapped, 0.0f), 1.0f);
+}
+
+// --------------------------------------------------------
+// The exact sRGB curve, rather than a 2.2 gamma
+// --------------------------------------------------------
+float BloomFilter::EncodeSRGB(float value)
+{
+	if (value <= 0.0031308f)
+		return value * 12.92f;
+	return 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// --------------------------------------------------------
+// Rounds every texel's color to the precision of a level
+// format: 10 mantissa bits for half floats, and 6, 6 and 5
+// (and no sign) for R11G11B10
+// --------------------------------------------------------
+void BloomFilter::Quantize(BloomImage& image, DXGI_FORMAT format)
+{
+	for (size_t i = 0; i < image.pixels.size(); i++)
+	{
+		XMFLOAT4& pixel = image.pixels[i];
+		if (format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+		{
+			pixel.x = RoundMantissa(pixel.x, 10, 65504.0f);
+			pixel.y = RoundMantissa(pixel.y, 10, 65504.0f);
+			pixel.z = RoundMantissa(pixel.z, 10, 65504.0f);
+		}
+		else if (format == DXGI_FORMAT_R11G11B10_FLOAT)
+		{
+			pixel.x = RoundMantissa(fmaxf(pixel.x, 0.0f), 6, 65024.0f);
+			pixel.y = RoundMantissa(fmaxf(pixel.y, 0.0f), 6, 65024.0f);
+			pixel.z = RoundMantissa(fmaxf(pixel.z, 0.0f), 5, 64512.0f);
+			pixel.w = 1.0f;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Bilinear filtering with clamp addressing, like the
+// post processing sampler
+// --------------------------------------------------------
+XMFLOAT4 BloomFilter::SampleBilinear(const BloomImage& image, float u, float v)
+{
+	float x = u * image.width - 0.5f;
+	float y = v * image.height - 0.5f;
+	float left = floorf(x);
+	float top = floorf(y);
+	float fx = x - left;
+	float fy = y - top;
+
+	int x0 = ClampIndex((int)left, (int)image.width);
+	int x1 = ClampIndex((int)left + 1, (int)image.width);
+	int y0 = ClampIndex((int)top, (int)image.height);
+	int y1 = ClampIndex((int)top + 1, (int)image.height);
+
+	const XMFLOAT4& a = image.pixels[y0 * image.width + x0];
+	const XMFLOAT4& b = image.pixels[y0 * image.width + x1];
+	const XMFLOAT4& c = image.pixels[y1 * image.width + x0];
+	const XMFLOAT4& d = image.pixels[y1 * image.width + x1];
+
+	return XMFLOAT4(
+		(a.x * (1 - fx) + b.x * fx) * (1 - fy) + (c.x * (1 - fx) + d.x * fx) * fy,
+		(a.y * (1 - fx) + b.y * fx) * (1 - fy) + (c.y * (1 - fx) + d.y * fx) * fy,
+		(a.z * (1 - fx) + b.z * fx) * (1 - fy) + (c.z * (1 - fx) + d.z * fx) * fy,
+		(a.w * (1 - fx) + b.w * fx) * (1 - fy) + (c.w * (1 - fx) + d.w * fx) * fy);
+}
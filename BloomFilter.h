@@ -0,0 +1,93 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <dxgiformat.h>
+#include <vector>
+
+// Cheaper bloom, for slower GPUs or higher resolutions
+enum BloomQuality
+{
+	BLOOM_QUALITY_HIGH,		// Half precision floats, from half resolution
+	BLOOM_QUALITY_MEDIUM,	// R11G11B10 floats (half the bytes), from half resolution
+	BLOOM_QUALITY_LOW,		// R11G11B10 floats, from quarter resolution
+	BLOOM_QUALITY_COUNT
+};
+
+// How BloomCombinePS maps HDR colors into the back buffer's
+// range.  Must match TONEMAPPER_* in BloomCombinePS.hlsl.
+enum Tonemapper
+{
+	TONEMAPPER_REINHARD,	// color / (1 + color)
+	TONEMAPPER_ACES			// Narkowicz's fit of the ACES filmic curve
+};
+
+// --------------------------------------------------------
+// How one quality tier builds the bloom levels
+//
+// Starting from quarter resolution, each level is half the
+// size it would otherwise be, so blurs are scaled by
+// sigmaScale to cover the same part of the screen
+// --------------------------------------------------------
+struct BloomTier
+{
+	const char* name;
+	DXGI_FORMAT format;			// Of every level
+	unsigned int firstStep;		// The first level is 1 / firstStep of the scene's size
+	float sigmaScale;
+};
+
+// --------------------------------------------------------
+// A floating point RGBA image, row by row from the top left
+// --------------------------------------------------------
+struct BloomImage
+{
+	unsigned int width;
+	unsigned int height;
+	std::vector<DirectX::XMFLOAT4> pixels;
+};
+
+// --------------------------------------------------------
+// CPU reference of the compute shader bloom chain, texel for
+// texel, so its output can be diffed against the GPU's (or
+// stored as a golden image) on a machine without one
+//
+// - DownsampleBlur() is one dispatch of BloomDownsampleCS:
+//   halve the source with a bilinear sample between each
+//   2x2 block (or quarter it, averaging four of those),
+//   subtract the threshold, then blur separably with a
+//   symmetric kernel, clamping at the edges
+// - Quantize() rounds an image the way storing it in a
+//   level's format would
+// - Combine() and Resolve() are BloomCombinePS: the original
+//   plus every level, each bilinearly upsampled and scaled,
+//   then exposed, tonemapped and sRGB encoded into 8 bit
+//   RGBA like the back buffer, for golden images
+//
+// Every level is at least 1x1, however small the viewport
+// (see LevelSize()).
+//
+// Kernels are one weight per texel, center first, so
+// weights[r] is used at both -r and +r (see GaussianKernel).
+// Needs no Direct3D device at all.
+// --------------------------------------------------------
+class BloomFilter {
+public:
+	// Must match BLOOM_MAX_RADIUS in BloomDownsampleCS.hlsl
+	static const int MaxRadius = 14;
+
+	// Must match BLOOM_MAX_LEVELS in BloomCombinePS.hlsl
+	static const int MaxLevels = 5;
+
+	static const BloomTier& GetTier(BloomQuality quality);
+	static unsigned int LevelSize(unsigned int sourceSize, unsigned int step);
+
+	static void DownsampleBlur(const BloomImage& source, unsigned int step, float threshold, const float* weights, int radius, BloomImage& target);
+	static void Combine(const BloomImage& original, const BloomImage* levels, const float* intensities, int levelCount, BloomImage& result);
+	static void Resolve(const BloomImage& image, float exposure, Tonemapper tonemapper, std::vector<unsigned char>& rgba);
+	static void Quantize(BloomImage& image, DXGI_FORMAT format);
+
+	static float Tonemap(float value, Tonemapper tonemapper);
+	static float EncodeSRGB(float value);
+
+	static DirectX::XMFLOAT4 SampleBilinear(const BloomImage& image, float u, float v);
+};
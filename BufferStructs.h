@@ -7,4 +7,11 @@ struct VertexShaderExternalData {
 	DirectX::XMFLOAT4X4 worldMatrix;
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projectionMatrix;
-};
\ No newline at end of file
+};
+
+// One entry of InstancedVertexShader's per-instance
+// structured buffer; must match InstanceData there
+struct InstanceData {
+	DirectX::XMFLOAT4X4 worldMatrix;
+	DirectX::XMFLOAT4X4 worldInvTranspose;
+};
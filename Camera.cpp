@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include "Frustum.h"
 #include <stdio.h>
 
 Camera::Camera(float aspectRatio, DirectX::XMFLOAT3 position)
@@ -30,6 +31,20 @@ Transform Camera::GetTransform()
 	return this->transform;
 }
 
+// --------------------------------------------------------
+// World-space frustum planes from the current view and
+// projection matrices, in Frustum's order
+// --------------------------------------------------------
+void Camera::GetFrustumPlanes(DirectX::XMFLOAT4 planes[6])
+{
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(
+		DirectX::XMLoadFloat4x4(&this->viewMatrix),
+		DirectX::XMLoadFloat4x4(&this->projectionMatrix)));
+
+	Frustum::ExtractPlanes(viewProjection, planes);
+}
+
 DirectX::XMFLOAT4X4 Camera::GetViewMatrix()
 {
 	return this->viewMatrix;
@@ -14,6 +14,7 @@ public:
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
 	Transform GetTransform();
+	void GetFrustumPlanes(DirectX::XMFLOAT4 planes[6]);
 
 	void UpdateProjectionMatrix(float aspectRatio);
 	void UpdateViewMatrix();
@@ -0,0 +1,250 @@
+#include "DeviceCommandList.h"
+#include "Material.h"
+#include "Mesh.h"
+#include <string.h>
+
+DeviceCommandList::DeviceCommandList(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, EntityStore* entities)
+{
+	this->device = device;
+	this->context = context;
+	this->entities = entities;
+	this->ambientColor = DirectX::XMFLOAT3(0, 0, 0);
+	this->clusterDepthScale = 0.0f;
+	this->clusterDepthBias = 0.0f;
+	this->clusterTileScale = DirectX::XMFLOAT2(0, 0);
+	this->vertexShader = 0;
+	this->pixelShader = 0;
+	this->mesh = 0;
+	this->vertexHandles = 0;
+	this->pixelHandles = 0;
+	this->instanceBuffer.capacity = 0;
+	this->lightBuffer.capacity = 0;
+	this->clusterBuffer.capacity = 0;
+	this->clusterLightIndexBuffer.capacity = 0;
+
+	// Standard "over" blending, and the default depth test
+	// without depth writes
+	D3D11_BLEND_DESC blendDesc = {};
+	blendDesc.RenderTarget[0].BlendEnable = true;
+	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	device->CreateBlendState(&blendDesc, this->alphaBlendState.GetAddressOf());
+
+	D3D11_DEPTH_STENCIL_DESC depthStencilDesc = {};
+	depthStencilDesc.DepthEnable = true;
+	depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+	device->CreateDepthStencilState(&depthStencilDesc, this->depthReadOnlyState.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Sets the data shared by every draw this frame.  Call
+// before submitting a queue to this list, with clusters
+// already built from these lights and the camera.
+// --------------------------------------------------------
+void DeviceCommandList::BeginFrame(std::shared_ptr<Camera> camera, const std::vector<Light>& lights, LightClusters& lightClusters, DirectX::XMFLOAT3 ambientColor)
+{
+	this->camera = camera;
+	this->ambientColor = ambientColor;
+	this->vertexShader = 0;
+	this->pixelShader = 0;
+	this->mesh = 0;
+
+	// Pixel shaders find their tile from SV_POSITION, so
+	// the tiles are sized to the current viewport
+	D3D11_VIEWPORT viewport = {};
+	UINT viewportCount = 1;
+	this->context->RSGetViewports(&viewportCount, &viewport);
+	if (viewportCount > 0 && viewport.Width > 0 && viewport.Height > 0)
+		this->clusterTileScale = DirectX::XMFLOAT2(LightClusters::TilesX / viewport.Width, LightClusters::TilesY / viewport.Height);
+	this->clusterDepthScale = lightClusters.GetDepthScale();
+	this->clusterDepthBias = lightClusters.GetDepthBias();
+
+	// Every shader this frame reads the same lists
+	if (!lights.empty())
+		this->UploadStructuredBuffer(this->lightBuffer, &lights[0], sizeof(Light), (unsigned int)lights.size());
+
+	const std::vector<LightCluster>& clusters = lightClusters.GetClusters();
+	this->UploadStructuredBuffer(this->clusterBuffer, &clusters[0], sizeof(LightCluster), (unsigned int)clusters.size());
+
+	const std::vector<unsigned int>& lightIndices = lightClusters.GetLightIndices();
+	if (!lightIndices.empty())
+		this->UploadStructuredBuffer(this->clusterLightIndexBuffer, &lightIndices[0], sizeof(unsigned int), (unsigned int)lightIndices.size());
+}
+
+// --------------------------------------------------------
+// Puts back the default blend and depth states, in case the
+// queue ended in the transparent pass
+// --------------------------------------------------------
+void DeviceCommandList::EndFrame()
+{
+	this->SetPass(RENDER_PASS_OPAQUE);
+}
+
+void DeviceCommandList::SetPass(RenderPass pass)
+{
+	if (pass == RENDER_PASS_TRANSPARENT)
+	{
+		this->context->OMSetBlendState(this->alphaBlendState.Get(), 0, 0xFFFFFFFF);
+		this->context->OMSetDepthStencilState(this->depthReadOnlyState.Get(), 0);
+		return;
+	}
+
+	this->context->OMSetBlendState(0, 0, 0xFFFFFFFF);
+	this->context->OMSetDepthStencilState(0, 0);
+}
+
+void DeviceCommandList::SetShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+{
+	this->vertexShader = vertexShader;
+	this->pixelShader = pixelShader;
+
+	// Resolve the variables the first time a shader is used
+	std::unordered_map<SimpleVertexShader*, VertexShaderHandles>::iterator vertexIt = this->vertexShaderHandles.find(vertexShader);
+	if (vertexIt == this->vertexShaderHandles.end())
+	{
+		VertexShaderHandles handles;
+		handles.viewMatrix = vertexShader->GetHandle("viewMatrix");
+		handles.projectionMatrix = vertexShader->GetHandle("projectionMatrix");
+		handles.worldMatrix = vertexShader->GetHandle("worldMatrix");
+		handles.worldInvTranspose = vertexShader->GetHandle("worldInvTranspose");
+		vertexIt = this->vertexShaderHandles.insert(std::make_pair(vertexShader, handles)).first;
+	}
+	this->vertexHandles = &vertexIt->second;
+
+	std::unordered_map<SimplePixelShader*, PixelShaderHandles>::iterator pixelIt = this->pixelShaderHandles.find(pixelShader);
+	if (pixelIt == this->pixelShaderHandles.end())
+	{
+		PixelShaderHandles handles;
+		handles.ambient = pixelShader->GetHandle("ambient");
+		handles.cameraPosition = pixelShader->GetHandle("cameraPosition");
+		handles.clusterDepthScale = pixelShader->GetHandle("clusterDepthScale");
+		handles.clusterDepthBias = pixelShader->GetHandle("clusterDepthBias");
+		handles.clusterTileScale = pixelShader->GetHandle("clusterTileScale");
+		handles.colorTint = pixelShader->GetHandle("colorTint");
+		handles.uvScale = pixelShader->GetHandle("uvScale");
+		handles.uvOffset = pixelShader->GetHandle("uvOffset");
+		pixelIt = this->pixelShaderHandles.insert(std::make_pair(pixelShader, handles)).first;
+	}
+	this->pixelHandles = &pixelIt->second;
+
+	vertexShader->SetMatrix4x4(this->vertexHandles->viewMatrix, this->camera->GetViewMatrix());
+	vertexShader->SetMatrix4x4(this->vertexHandles->projectionMatrix, this->camera->GetProjectionMatrix());
+
+	pixelShader->SetShaderResourceView("lights", this->lightBuffer.srv);
+	pixelShader->SetShaderResourceView("lightClusters", this->clusterBuffer.srv);
+	pixelShader->SetShaderResourceView("lightIndices", this->clusterLightIndexBuffer.srv);
+	pixelShader->SetFloat3(this->pixelHandles->ambient, this->ambientColor);
+	pixelShader->SetFloat3(this->pixelHandles->cameraPosition, this->camera->GetTransform().GetPosition());
+	pixelShader->SetFloat(this->pixelHandles->clusterDepthScale, this->clusterDepthScale);
+	pixelShader->SetFloat(this->pixelHandles->clusterDepthBias, this->clusterDepthBias);
+	pixelShader->SetFloat2(this->pixelHandles->clusterTileScale, this->clusterTileScale);
+
+	vertexShader->SetShader();
+	pixelShader->SetShader();
+}
+
+void DeviceCommandList::SetMaterial(Material* material)
+{
+	this->pixelShader->SetFloat4(this->pixelHandles->colorTint, material->GetColorTint());
+	this->pixelShader->SetFloat2(this->pixelHandles->uvScale, material->GetUVScale());
+	this->pixelShader->SetFloat2(this->pixelHandles->uvOffset, material->GetUVOffset());
+
+	material->PrepareMaterial();
+}
+
+void DeviceCommandList::SetMesh(Mesh* mesh)
+{
+	this->mesh = mesh;
+	mesh->SetBuffers();
+}
+
+void DeviceCommandList::Draw(const unsigned int* entityIndices, unsigned int count)
+{
+	// Only uploads if the shaders or material changed it
+	this->pixelShader->CopyAllBufferData();
+
+	if (this->vertexShader->GetPerInstanceCompatible())
+	{
+		this->UploadInstances(entityIndices, count);
+		this->vertexShader->SetShaderResourceView("instances", this->instanceBuffer.srv);
+		this->vertexShader->CopyAllBufferData();
+		this->context->DrawIndexedInstanced(this->mesh->GetIndexCount(), count, 0, 0, 0);
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		this->vertexShader->SetMatrix4x4(this->vertexHandles->worldMatrix, this->entities->GetWorldMatrix(entityIndices[i]));
+		this->vertexShader->SetMatrix4x4(this->vertexHandles->worldInvTranspose, this->entities->GetWorldInverseTransposeMatrix(entityIndices[i]));
+		this->vertexShader->CopyAllBufferData();
+		this->context->DrawIndexed(this->mesh->GetIndexCount(), 0, 0);
+	}
+}
+
+// --------------------------------------------------------
+// Packs the entities' matrices into the instance buffer
+// --------------------------------------------------------
+void DeviceCommandList::UploadInstances(const unsigned int* entityIndices, unsigned int count)
+{
+	if (this->instances.size() < count)
+		this->instances.resize(count);
+	this->entities->GatherInstances(entityIndices, count, &this->instances[0]);
+
+	this->UploadStructuredBuffer(this->instanceBuffer, &this->instances[0], sizeof(InstanceData), count);
+}
+
+// --------------------------------------------------------
+// Copies elements into a dynamic structured buffer,
+// recreating it (and its SRV) first if it's too small
+// --------------------------------------------------------
+void DeviceCommandList::UploadStructuredBuffer(DynamicStructuredBuffer& target, const void* data, unsigned int stride, unsigned int count)
+{
+	if (count == 0)
+		return;
+
+	if (count > target.capacity)
+	{
+		// Room to grow, so a slowly growing scene doesn't
+		// recreate the buffer every frame
+		unsigned int capacity = target.capacity > 0 ? target.capacity : 64;
+		while (capacity < count)
+			capacity *= 2;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = stride * capacity;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = stride;
+
+		target.buffer.Reset();
+		target.srv.Reset();
+		this->device->CreateBuffer(&desc, 0, target.buffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+		this->device->CreateShaderResourceView(target.buffer.Get(), &srvDesc, target.srv.GetAddressOf());
+
+		target.capacity = capacity;
+	}
+
+	// Each upload discards the previous contents, so the driver
+	// hands back fresh memory instead of waiting on the GPU
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	HRESULT hr = this->context->Map(target.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if (FAILED(hr))
+		return;
+
+	memcpy(mapped.pData, data, stride * count);
+	this->context->Unmap(target.buffer.Get(), 0);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include <DirectXMath.h>
+#include "RenderQueue.h"
+#include "EntityStore.h"
+#include "Camera.h"
+#include "Lights.h"
+#include "LightClusters.h"
+#include "SimpleShader.h"
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Issues a RenderQueue's commands to a Direct3D context
+//
+// - The shaders keep per-frame (camera, lights, ambient),
+//   per-material and per-object data in separate constant
+//   buffers, and the shaders' dirty tracking only uploads
+//   the ones that changed - so per-frame data goes up once
+//   per frame and material data once per material
+// - Per-frame data is written into each pair of shaders
+//   when they're set, except the lights: they're uploaded
+//   once per frame into structured buffers every pixel
+//   shader reads, along with the frame's light clusters, so
+//   there's no fixed cap on their number and each pixel only
+//   shades the lights that can reach it
+// - Variables are set through handles, resolved the first
+//   time each shader is seen
+// - With a per-instance vertex shader (one created as
+//   perInstanceCompatible, like InstancedVertexShader), each
+//   run of entities is packed into a structured buffer and
+//   drawn with one DrawIndexedInstanced; otherwise each
+//   entity is drawn on its own with its matrices in the
+//   PerObject buffer
+// - The transparent pass alpha blends and tests against the
+//   opaque depth without writing it.  EndFrame() puts the
+//   default blend and depth states back.
+// --------------------------------------------------------
+class DeviceCommandList : public RenderCommandList {
+public:
+	DeviceCommandList(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, EntityStore* entities);
+
+	void BeginFrame(std::shared_ptr<Camera> camera, const std::vector<Light>& lights, LightClusters& lightClusters, DirectX::XMFLOAT3 ambientColor);
+	void EndFrame();
+
+	void SetPass(RenderPass pass);
+	void SetShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader);
+	void SetMaterial(Material* material);
+	void SetMesh(Mesh* mesh);
+	void Draw(const unsigned int* entityIndices, unsigned int count);
+
+private:
+	// The variables this list sets, in one shader
+	struct VertexShaderHandles
+	{
+		SimpleShaderHandle viewMatrix;
+		SimpleShaderHandle projectionMatrix;
+		SimpleShaderHandle worldMatrix;
+		SimpleShaderHandle worldInvTranspose;
+	};
+
+	struct PixelShaderHandles
+	{
+		SimpleShaderHandle ambient;
+		SimpleShaderHandle cameraPosition;
+		SimpleShaderHandle clusterDepthScale;
+		SimpleShaderHandle clusterDepthBias;
+		SimpleShaderHandle clusterTileScale;
+		SimpleShaderHandle colorTint;
+		SimpleShaderHandle uvScale;
+		SimpleShaderHandle uvOffset;
+	};
+
+	// A structured buffer rewritten with WRITE_DISCARD
+	struct DynamicStructuredBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		unsigned int capacity;
+	};
+
+	void UploadInstances(const unsigned int* entityIndices, unsigned int count);
+	void UploadStructuredBuffer(DynamicStructuredBuffer& target, const void* data, unsigned int stride, unsigned int count);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	EntityStore* entities;
+
+	// The transparent pass's states
+	Microsoft::WRL::ComPtr<ID3D11BlendState> alphaBlendState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthReadOnlyState;
+
+	// This frame's data
+	std::shared_ptr<Camera> camera;
+	DirectX::XMFLOAT3 ambientColor;
+	float clusterDepthScale;
+	float clusterDepthBias;
+	DirectX::XMFLOAT2 clusterTileScale;
+
+	// What's currently set
+	SimpleVertexShader* vertexShader;
+	SimplePixelShader* pixelShader;
+	Mesh* mesh;
+
+	std::unordered_map<SimpleVertexShader*, VertexShaderHandles> vertexShaderHandles;
+	std::unordered_map<SimplePixelShader*, PixelShaderHandles> pixelShaderHandles;
+	const VertexShaderHandles* vertexHandles;
+	const PixelShaderHandles* pixelHandles;
+
+	// Per-instance data, grown to the largest run drawn so far
+	std::vector<InstanceData> instances;
+	DynamicStructuredBuffer instanceBuffer;
+
+	// The frame's lights and light clusters, for PixelShader
+	DynamicStructuredBuffer lightBuffer;
+	DynamicStructuredBuffer clusterBuffer;
+	DynamicStructuredBuffer clusterLightIndexBuffer;
+};
@@ -0,0 +1,44 @@
+#include "DeviceFrameGraph.h"
+
+DeviceFrameGraph::DeviceFrameGraph(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, DeviceRenderTargetPool* targets)
+	: FrameGraph(targets)
+{
+	this->context = context;
+	this->deviceTargets = targets;
+}
+
+Microsoft::WRL::ComPtr<ID3D11RenderTargetView> DeviceFrameGraph::GetRenderTargetView(unsigned int resource)
+{
+	return this->deviceTargets->GetRenderTargetView(this->GetTarget(resource));
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DeviceFrameGraph::GetShaderResourceView(unsigned int resource)
+{
+	return this->deviceTargets->GetShaderResourceView(this->GetTarget(resource));
+}
+
+Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> DeviceFrameGraph::GetUnorderedAccessView(unsigned int resource)
+{
+	return this->deviceTargets->GetUnorderedAccessView(this->GetTarget(resource));
+}
+
+void DeviceFrameGraph::Unbind(const FrameGraphBinding& binding)
+{
+	ID3D11ShaderResourceView* nullSRV = 0;
+	ID3D11UnorderedAccessView* nullUAV = 0;
+	switch (binding.point)
+	{
+	case FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE:
+		this->context->PSSetShaderResources(binding.slot, 1, &nullSRV);
+		break;
+	case FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE:
+		this->context->CSSetShaderResources(binding.slot, 1, &nullSRV);
+		break;
+	case FRAME_GRAPH_BIND_UNORDERED_ACCESS:
+		this->context->CSSetUnorderedAccessViews(binding.slot, 1, &nullUAV, 0);
+		break;
+	case FRAME_GRAPH_BIND_RENDER_TARGETS:
+		this->context->OMSetRenderTargets(0, 0, 0);
+		break;
+	}
+}
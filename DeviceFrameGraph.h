@@ -0,0 +1,27 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "FrameGraph.h"
+#include "DeviceRenderTargetPool.h"
+
+// --------------------------------------------------------
+// A FrameGraph whose passes run on a Direct3D context, with
+// transient targets from a DeviceRenderTargetPool
+// --------------------------------------------------------
+class DeviceFrameGraph : public FrameGraph {
+public:
+	DeviceFrameGraph(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, DeviceRenderTargetPool* targets);
+
+	// Views of a transient resource, for the passes using it
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> GetRenderTargetView(unsigned int resource);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetShaderResourceView(unsigned int resource);
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> GetUnorderedAccessView(unsigned int resource);
+
+protected:
+	void Unbind(const FrameGraphBinding& binding);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	DeviceRenderTargetPool* deviceTargets;
+};
@@ -0,0 +1,59 @@
+#include "DeviceRenderTargetPool.h"
+
+DeviceRenderTargetPool::DeviceRenderTargetPool(Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	this->device = device;
+}
+
+Microsoft::WRL::ComPtr<ID3D11RenderTargetView> DeviceRenderTargetPool::GetRenderTargetView(unsigned int target)
+{
+	return this->views[target].rtv;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DeviceRenderTargetPool::GetShaderResourceView(unsigned int target)
+{
+	return this->views[target].srv;
+}
+
+Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> DeviceRenderTargetPool::GetUnorderedAccessView(unsigned int target)
+{
+	return this->views[target].uav;
+}
+
+void DeviceRenderTargetPool::CreateTarget(unsigned int target, const RenderTargetDesc& desc)
+{
+	if (target >= this->views.size())
+		this->views.resize(target + 1);
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.width;
+	textureDesc.Height = desc.height;
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.Format = desc.format;
+	textureDesc.MipLevels = 1;
+	textureDesc.MiscFlags = 0;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	this->device->CreateTexture2D(&textureDesc, 0, texture.GetAddressOf());
+
+	Views& targetViews = this->views[target];
+	this->device->CreateRenderTargetView(texture.Get(), 0, targetViews.rtv.ReleaseAndGetAddressOf());
+	this->device->CreateShaderResourceView(texture.Get(), 0, targetViews.srv.ReleaseAndGetAddressOf());
+	this->device->CreateUnorderedAccessView(texture.Get(), 0, targetViews.uav.ReleaseAndGetAddressOf());
+}
+
+// --------------------------------------------------------
+// The views hold the only references to the texture
+// --------------------------------------------------------
+void DeviceRenderTargetPool::DestroyTarget(unsigned int target)
+{
+	Views& targetViews = this->views[target];
+	targetViews.rtv.Reset();
+	targetViews.srv.Reset();
+	targetViews.uav.Reset();
+}
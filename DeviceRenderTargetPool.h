@@ -0,0 +1,37 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "RenderTargetPool.h"
+
+// --------------------------------------------------------
+// A RenderTargetPool of Direct3D textures
+//
+// Every target can be rendered to, sampled, and written by
+// a compute shader, so pixel and compute passes can share
+// the same ones.
+// --------------------------------------------------------
+class DeviceRenderTargetPool : public RenderTargetPool {
+public:
+	DeviceRenderTargetPool(Microsoft::WRL::ComPtr<ID3D11Device> device);
+
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> GetRenderTargetView(unsigned int target);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetShaderResourceView(unsigned int target);
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> GetUnorderedAccessView(unsigned int target);
+
+protected:
+	void CreateTarget(unsigned int target, const RenderTargetDesc& desc);
+	void DestroyTarget(unsigned int target);
+
+private:
+	struct Views
+	{
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtv;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::vector<Views> views;
+};
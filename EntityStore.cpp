@@ -0,0 +1,465 @@
+#include "EntityStore.h"
+#include "Transform.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+using namespace DirectX;
+
+// Never alive, so it stands in for "no parent"
+static const EntityID NoParent = { ENTITY_STORE_INVALID_INDEX, 0 };
+
+// --------------------------------------------------------
+// Removes values[index] by moving the last value into it
+// --------------------------------------------------------
+template<typename T>
+static void RemoveSwapLast(std::vector<T>& values, unsigned int index)
+{
+	values[index] = values.back();
+	values.pop_back();
+}
+
+EntityStore::EntityStore()
+{
+	this->anyDirty = false;
+	this->anyParents = false;
+	this->parentsDirty = false;
+	this->orderDirty = false;
+}
+
+EntityStore::~EntityStore()
+{
+}
+
+EntityID EntityStore::Create(Mesh* mesh, Material* material, DirectX::XMFLOAT3 position)
+{
+	unsigned int index = (unsigned int)this->positions.size();
+
+	// Reuse a freed slot when possible
+	EntityID entity;
+	if (!this->freeSlots.empty())
+	{
+		entity.slot = this->freeSlots.back();
+		this->freeSlots.pop_back();
+	}
+	else
+	{
+		entity.slot = (unsigned int)this->slotToIndex.size();
+		this->slotToIndex.push_back(ENTITY_STORE_INVALID_INDEX);
+		this->slotGenerations.push_back(0);
+	}
+	entity.generation = this->slotGenerations[entity.slot];
+
+	this->slotToIndex[entity.slot] = index;
+	this->indexToSlot.push_back(entity.slot);
+
+	this->positions.push_back(position);
+	this->rotations.push_back(XMFLOAT3(0, 0, 0));
+	this->scales.push_back(XMFLOAT3(1, 1, 1));
+	this->dirty.push_back(1);
+	this->worldMatrices.push_back(XMFLOAT4X4());
+	this->worldInverseTransposeMatrices.push_back(XMFLOAT4X4());
+	this->meshes.push_back(mesh);
+	this->materials.push_back(material);
+	this->parents.push_back(NoParent);
+	this->parentIndices.push_back(SCENE_GRAPH_NO_PARENT);
+	this->localSpheres.push_back(XMFLOAT4(0, 0, 0, FLT_MAX));
+	this->sphereCenterX.push_back(0);
+	this->sphereCenterY.push_back(0);
+	this->sphereCenterZ.push_back(0);
+	this->sphereRadius.push_back(FLT_MAX);
+
+	this->anyDirty = true;
+	return entity;
+}
+
+void EntityStore::Destroy(EntityID entity)
+{
+	if (!this->IsAlive(entity))
+		return;
+
+	unsigned int index = this->slotToIndex[entity.slot];
+	unsigned int lastSlot = this->indexToSlot.back();
+
+	// The last entity takes over the removed one's index
+	RemoveSwapLast(this->indexToSlot, index);
+	RemoveSwapLast(this->positions, index);
+	RemoveSwapLast(this->rotations, index);
+	RemoveSwapLast(this->scales, index);
+	RemoveSwapLast(this->dirty, index);
+	RemoveSwapLast(this->worldMatrices, index);
+	RemoveSwapLast(this->worldInverseTransposeMatrices, index);
+	RemoveSwapLast(this->meshes, index);
+	RemoveSwapLast(this->materials, index);
+	RemoveSwapLast(this->parents, index);
+	RemoveSwapLast(this->parentIndices, index);
+	RemoveSwapLast(this->localSpheres, index);
+	RemoveSwapLast(this->sphereCenterX, index);
+	RemoveSwapLast(this->sphereCenterY, index);
+	RemoveSwapLast(this->sphereCenterZ, index);
+	RemoveSwapLast(this->sphereRadius, index);
+	this->slotToIndex[lastSlot] = index;
+
+	this->slotToIndex[entity.slot] = ENTITY_STORE_INVALID_INDEX;
+	this->slotGenerations[entity.slot]++;
+	this->freeSlots.push_back(entity.slot);
+
+	// The moved entity's children, and the removed one's, are
+	// found by the next UpdateWorldMatrices()
+	this->anyDirty = true;
+	if (this->anyParents)
+		this->parentsDirty = true;
+}
+
+bool EntityStore::IsAlive(EntityID entity)
+{
+	return
+		entity.slot < this->slotToIndex.size() &&
+		this->slotGenerations[entity.slot] == entity.generation &&
+		this->slotToIndex[entity.slot] != ENTITY_STORE_INVALID_INDEX;
+}
+
+void EntityStore::Reserve(unsigned int entityCount)
+{
+	this->slotToIndex.reserve(entityCount);
+	this->slotGenerations.reserve(entityCount);
+	this->indexToSlot.reserve(entityCount);
+	this->positions.reserve(entityCount);
+	this->rotations.reserve(entityCount);
+	this->scales.reserve(entityCount);
+	this->dirty.reserve(entityCount);
+	this->worldMatrices.reserve(entityCount);
+	this->worldInverseTransposeMatrices.reserve(entityCount);
+	this->meshes.reserve(entityCount);
+	this->materials.reserve(entityCount);
+	this->parents.reserve(entityCount);
+	this->parentIndices.reserve(entityCount);
+	this->localSpheres.reserve(entityCount);
+	this->sphereCenterX.reserve(entityCount);
+	this->sphereCenterY.reserve(entityCount);
+	this->sphereCenterZ.reserve(entityCount);
+	this->sphereRadius.reserve(entityCount);
+}
+
+unsigned int EntityStore::GetCount()
+{
+	return (unsigned int)this->positions.size();
+}
+
+unsigned int EntityStore::GetIndex(EntityID entity)
+{
+	return this->IsAlive(entity) ? this->slotToIndex[entity.slot] : ENTITY_STORE_INVALID_INDEX;
+}
+
+EntityID EntityStore::GetID(unsigned int index)
+{
+	EntityID entity;
+	entity.slot = this->indexToSlot[index];
+	entity.generation = this->slotGenerations[entity.slot];
+	return entity;
+}
+
+void EntityStore::SetPosition(unsigned int index, DirectX::XMFLOAT3 position)
+{
+	this->positions[index] = position;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+void EntityStore::SetRotation(unsigned int index, DirectX::XMFLOAT3 pitchYawRoll)
+{
+	this->rotations[index] = pitchYawRoll;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+void EntityStore::SetScale(unsigned int index, DirectX::XMFLOAT3 scale)
+{
+	this->scales[index] = scale;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+void EntityStore::Rotate(unsigned int index, float pitch, float yaw, float roll)
+{
+	XMFLOAT3& rotation = this->rotations[index];
+	rotation = XMFLOAT3(rotation.x + pitch, rotation.y + yaw, rotation.z + roll);
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+void EntityStore::SetMesh(unsigned int index, Mesh* mesh)
+{
+	this->meshes[index] = mesh;
+}
+
+void EntityStore::SetMaterial(unsigned int index, Material* material)
+{
+	this->materials[index] = material;
+}
+
+void EntityStore::SetLocalBounds(unsigned int index, const MeshBounds& bounds)
+{
+	this->localSpheres[index] = XMFLOAT4(bounds.center.x, bounds.center.y, bounds.center.z, bounds.radius);
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+// --------------------------------------------------------
+// Makes the entity a child of another, so its position,
+// rotation and scale become relative to that parent, or a
+// root again when parentIndex is ENTITY_STORE_INVALID_INDEX.
+// Requests that would create a cycle are ignored.
+// --------------------------------------------------------
+void EntityStore::SetParent(unsigned int index, unsigned int parentIndex)
+{
+	for (unsigned int ancestor = parentIndex; ancestor != ENTITY_STORE_INVALID_INDEX; ancestor = this->GetParent(ancestor))
+	{
+		if (ancestor == index)
+			return;
+	}
+
+	this->parents[index] = parentIndex == ENTITY_STORE_INVALID_INDEX ? NoParent : this->GetID(parentIndex);
+	this->parentIndices[index] = parentIndex == ENTITY_STORE_INVALID_INDEX ? SCENE_GRAPH_NO_PARENT : parentIndex;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+
+	// Parents must stay ahead of their children
+	if (parentIndex != ENTITY_STORE_INVALID_INDEX)
+	{
+		this->anyParents = true;
+		if (parentIndex > index)
+			this->orderDirty = true;
+	}
+}
+
+DirectX::XMFLOAT3 EntityStore::GetPosition(unsigned int index)
+{
+	return this->positions[index];
+}
+
+DirectX::XMFLOAT3 EntityStore::GetRotation(unsigned int index)
+{
+	return this->rotations[index];
+}
+
+DirectX::XMFLOAT3 EntityStore::GetScale(unsigned int index)
+{
+	return this->scales[index];
+}
+
+Mesh* EntityStore::GetMesh(unsigned int index)
+{
+	return this->meshes[index];
+}
+
+Material* EntityStore::GetMaterial(unsigned int index)
+{
+	return this->materials[index];
+}
+
+// Dense index of the parent, or ENTITY_STORE_INVALID_INDEX
+// for a root (including one whose parent was destroyed)
+unsigned int EntityStore::GetParent(unsigned int index)
+{
+	return this->GetIndex(this->parents[index]);
+}
+
+const DirectX::XMFLOAT4X4& EntityStore::GetWorldMatrix(unsigned int index)
+{
+	return this->worldMatrices[index];
+}
+
+const DirectX::XMFLOAT4X4& EntityStore::GetWorldInverseTransposeMatrix(unsigned int index)
+{
+	return this->worldInverseTransposeMatrices[index];
+}
+
+// --------------------------------------------------------
+// Copies the matrices of the given entities, in order, into
+// per-instance data for one instanced draw.  Only valid after
+// UpdateWorldMatrices().
+// --------------------------------------------------------
+void EntityStore::GatherInstances(const unsigned int* indices, unsigned int count, InstanceData* instances)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		instances[i].worldMatrix = this->worldMatrices[indices[i]];
+		instances[i].worldInvTranspose = this->worldInverseTransposeMatrices[indices[i]];
+	}
+}
+
+// --------------------------------------------------------
+// Rebuilds the matrices and world bounding spheres of every
+// entity that changed since the last call, and of all their
+// descendants, in one pass over the dense arrays
+// --------------------------------------------------------
+void EntityStore::UpdateWorldMatrices()
+{
+	if (this->parentsDirty)
+		this->ResolveParents();
+
+	if (this->orderDirty)
+		this->SortEntities();
+
+	if (!this->anyDirty)
+		return;
+
+	unsigned int count = (unsigned int)this->positions.size();
+	if (count > 0)
+	{
+		SceneGraph::UpdateSortedMatrices(
+			count, &this->parentIndices[0],
+			&this->positions[0], &this->rotations[0], &this->scales[0],
+			&this->dirty[0], &this->worldMatrices[0], &this->worldInverseTransposeMatrices[0]);
+	}
+
+	// The pass leaves every rebuilt entity dirty
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (!this->dirty[i])
+			continue;
+
+		// The sphere follows the center, and grows with the
+		// largest scale along any of the world matrix's axes,
+		// which includes the ancestors' scales
+		XMMATRIX world = XMLoadFloat4x4(&this->worldMatrices[i]);
+		const XMFLOAT4& sphere = this->localSpheres[i];
+		XMFLOAT3 center;
+		XMStoreFloat3(&center, XMVector3TransformCoord(XMVectorSet(sphere.x, sphere.y, sphere.z, 1.0f), world));
+		float maxScaleSq = fmaxf(
+			XMVectorGetX(XMVector3LengthSq(world.r[0])),
+			fmaxf(XMVectorGetX(XMVector3LengthSq(world.r[1])), XMVectorGetX(XMVector3LengthSq(world.r[2]))));
+
+		this->sphereCenterX[i] = center.x;
+		this->sphereCenterY[i] = center.y;
+		this->sphereCenterZ[i] = center.z;
+		this->sphereRadius[i] = sphere.w == FLT_MAX ? FLT_MAX : sphere.w * sqrtf(maxScaleSq);
+	}
+
+	std::fill(this->dirty.begin(), this->dirty.end(), (unsigned char)0);
+	this->anyDirty = false;
+}
+
+// --------------------------------------------------------
+// Refreshes every parent's dense index after Destroy() has
+// moved entities around, making the children of destroyed
+// entities roots again
+// --------------------------------------------------------
+void EntityStore::ResolveParents()
+{
+	unsigned int count = (unsigned int)this->positions.size();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (this->parents[i].slot == ENTITY_STORE_INVALID_INDEX)
+			continue;
+
+		unsigned int parent = this->GetIndex(this->parents[i]);
+		if (parent == ENTITY_STORE_INVALID_INDEX)
+		{
+			// The parent was destroyed
+			this->parents[i] = NoParent;
+			this->parentIndices[i] = SCENE_GRAPH_NO_PARENT;
+			this->dirty[i] = 1;
+			continue;
+		}
+
+		this->parentIndices[i] = parent;
+		if (parent > i)
+			this->orderDirty = true;
+	}
+
+	this->parentsDirty = false;
+}
+
+// --------------------------------------------------------
+// Re-sorts the dense arrays into SceneGraph's depth-first
+// order, so every parent comes before its children
+// --------------------------------------------------------
+void EntityStore::SortEntities()
+{
+	unsigned int count = (unsigned int)this->positions.size();
+
+	std::vector<unsigned int> order;
+	SceneGraph::GetDepthFirstOrder(this->parentIndices, order);
+
+	// Old index -> new index
+	std::vector<unsigned int> newIndex(count);
+	for (unsigned int i = 0; i < count; i++)
+		newIndex[order[i]] = i;
+
+	SceneGraph::Reorder(this->parentIndices, order);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (this->parentIndices[i] != SCENE_GRAPH_NO_PARENT)
+			this->parentIndices[i] = newIndex[this->parentIndices[i]];
+	}
+
+	SceneGraph::Reorder(this->indexToSlot, order);
+	for (unsigned int i = 0; i < count; i++)
+		this->slotToIndex[this->indexToSlot[i]] = i;
+
+	SceneGraph::Reorder(this->positions, order);
+	SceneGraph::Reorder(this->rotations, order);
+	SceneGraph::Reorder(this->scales, order);
+	SceneGraph::Reorder(this->dirty, order);
+	SceneGraph::Reorder(this->worldMatrices, order);
+	SceneGraph::Reorder(this->worldInverseTransposeMatrices, order);
+	SceneGraph::Reorder(this->meshes, order);
+	SceneGraph::Reorder(this->materials, order);
+	SceneGraph::Reorder(this->parents, order);
+	SceneGraph::Reorder(this->localSpheres, order);
+	SceneGraph::Reorder(this->sphereCenterX, order);
+	SceneGraph::Reorder(this->sphereCenterY, order);
+	SceneGraph::Reorder(this->sphereCenterZ, order);
+	SceneGraph::Reorder(this->sphereRadius, order);
+
+	this->orderDirty = false;
+}
+
+// --------------------------------------------------------
+// Replaces the contents of drawList with every entity that
+// has both a mesh and a material, in dense order
+//
+// frustumPlanes - Optional six planes (see Frustum); when
+//                 given, entities whose bounding spheres are
+//                 entirely outside are left out
+// --------------------------------------------------------
+void EntityStore::BuildDrawList(std::vector<DrawItem>& drawList, const DirectX::XMFLOAT4* frustumPlanes)
+{
+	drawList.clear();
+
+	unsigned int count = (unsigned int)this->positions.size();
+	if (count == 0)
+		return;
+
+	// Everything, or only what survives culling
+	this->visibleIndices.resize(count);
+	unsigned int visibleCount = count;
+	if (frustumPlanes)
+	{
+		visibleCount = Frustum::CullSpheres(
+			&this->sphereCenterX[0], &this->sphereCenterY[0], &this->sphereCenterZ[0], &this->sphereRadius[0],
+			count, frustumPlanes, &this->visibleIndices[0]);
+	}
+	else
+	{
+		for (unsigned int i = 0; i < count; i++)
+			this->visibleIndices[i] = i;
+	}
+
+	for (unsigned int v = 0; v < visibleCount; v++)
+	{
+		unsigned int i = this->visibleIndices[v];
+		if (!this->meshes[i] || !this->materials[i])
+			continue;
+
+		DrawItem item;
+		item.mesh = this->meshes[i];
+		item.material = this->materials[i];
+		item.entityIndex = i;
+		drawList.push_back(item);
+	}
+}
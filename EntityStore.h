@@ -0,0 +1,134 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "MeshData.h"
+#include "BufferStructs.h"
+
+#define ENTITY_STORE_INVALID_INDEX 0xFFFFFFFF
+
+class Mesh;
+class Material;
+
+// --------------------------------------------------------
+// Stable handle to an entity.  The generation changes every
+// time a slot is reused, so stale handles are detectable.
+// --------------------------------------------------------
+struct EntityID
+{
+	unsigned int slot;
+	unsigned int generation;
+};
+
+// --------------------------------------------------------
+// One entity to draw, referring to the store's dense arrays
+// --------------------------------------------------------
+struct DrawItem
+{
+	Mesh* mesh;
+	Material* material;
+	unsigned int entityIndex;
+};
+
+// --------------------------------------------------------
+// Structure-of-arrays storage for every entity in the scene
+//
+// - Transforms, meshes and materials live in parallel dense
+//   arrays, so Update and Draw walk contiguous memory with
+//   no reference counting
+// - Destroying an entity moves the last one into its place,
+//   so dense indices can change; EntityIDs never do
+// - Meshes and materials are not owned by the store, and must
+//   outlive the entities that use them
+// - Each entity has a world-space bounding sphere, built from
+//   its mesh's local bounds, so BuildDrawList() can frustum
+//   cull.  Until SetLocalBounds() is called it is never culled
+// - An entity can have a parent, like Transform.  The link is
+//   kept by EntityID, so it survives the parent moving to
+//   another dense index, and destroying the parent makes its
+//   children roots again
+// - The dense arrays are kept with every parent before its
+//   children, so UpdateWorldMatrices() is SceneGraph's single
+//   linear pass.  A SetParent() that breaks that order
+//   re-sorts them on the next UpdateWorldMatrices()
+//
+// Rotation follows Transform's conventions (pitch, yaw, roll
+// in radians).  Needs no Direct3D device at all.
+// --------------------------------------------------------
+class EntityStore {
+public:
+	EntityStore();
+	~EntityStore();
+
+	EntityID Create(Mesh* mesh, Material* material, DirectX::XMFLOAT3 position);
+	void Destroy(EntityID entity);
+	bool IsAlive(EntityID entity);
+	void Reserve(unsigned int entityCount);
+
+	// Dense indices, valid until the next Create(), Destroy(),
+	// or UpdateWorldMatrices() after a SetParent()
+	unsigned int GetCount();
+	unsigned int GetIndex(EntityID entity);
+	EntityID GetID(unsigned int index);
+
+	void SetPosition(unsigned int index, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int index, DirectX::XMFLOAT3 pitchYawRoll);
+	void SetScale(unsigned int index, DirectX::XMFLOAT3 scale);
+	void Rotate(unsigned int index, float pitch, float yaw, float roll);
+	void SetMesh(unsigned int index, Mesh* mesh);
+	void SetMaterial(unsigned int index, Material* material);
+	void SetLocalBounds(unsigned int index, const MeshBounds& bounds);
+	void SetParent(unsigned int index, unsigned int parentIndex);
+
+	DirectX::XMFLOAT3 GetPosition(unsigned int index);
+	DirectX::XMFLOAT3 GetRotation(unsigned int index);
+	DirectX::XMFLOAT3 GetScale(unsigned int index);
+	Mesh* GetMesh(unsigned int index);
+	Material* GetMaterial(unsigned int index);
+	unsigned int GetParent(unsigned int index);
+
+	// Only valid after UpdateWorldMatrices(), and include
+	// every ancestor's transform
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int index);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(unsigned int index);
+	void GatherInstances(const unsigned int* indices, unsigned int count, InstanceData* instances);
+
+	void UpdateWorldMatrices();
+	void BuildDrawList(std::vector<DrawItem>& drawList, const DirectX::XMFLOAT4* frustumPlanes = 0);
+
+private:
+	void ResolveParents();
+	void SortEntities();
+
+	// Slot (from EntityID) <-> dense index
+	std::vector<unsigned int> slotToIndex;
+	std::vector<unsigned int> slotGenerations;
+	std::vector<unsigned int> freeSlots;
+	std::vector<unsigned int> indexToSlot;
+
+	// Per-entity data, by dense index
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> rotations;
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<unsigned char> dirty;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposeMatrices;
+	std::vector<Mesh*> meshes;
+	std::vector<Material*> materials;
+	std::vector<EntityID> parents;
+	std::vector<unsigned int> parentIndices;
+
+	// Bounding spheres: local (center, radius), and world as
+	// separate arrays for the SIMD culling pass
+	std::vector<DirectX::XMFLOAT4> localSpheres;
+	std::vector<float> sphereCenterX;
+	std::vector<float> sphereCenterY;
+	std::vector<float> sphereCenterZ;
+	std::vector<float> sphereRadius;
+	std::vector<unsigned int> visibleIndices;
+
+	bool anyDirty;
+	bool anyParents;
+	bool parentsDirty;
+	bool orderDirty;
+};
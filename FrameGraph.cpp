@@ -0,0 +1,408 @@
+#include "FrameGraph.h"
+
+// Imported resources never share a texture with a pooled one
+static const unsigned int ImportedPhysical = 0x80000000;
+
+FrameGraph::FrameGraph(RenderTargetPool* targets)
+{
+	this->targets = targets;
+}
+
+FrameGraph::~FrameGraph()
+{
+}
+
+// --------------------------------------------------------
+// Forgets the last frame's passes and resources, so the next
+// one can be declared
+// --------------------------------------------------------
+void FrameGraph::Reset()
+{
+	this->resources.clear();
+	this->passes.clear();
+	this->finalUnbinds.clear();
+}
+
+unsigned int FrameGraph::CreateTarget(std::string name, unsigned int width, unsigned int height, DXGI_FORMAT format)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.desc.width = width;
+	resource.desc.height = height;
+	resource.desc.format = format;
+	resource.imported = false;
+	this->resources.push_back(resource);
+	return (unsigned int)this->resources.size() - 1;
+}
+
+unsigned int FrameGraph::ImportTarget(std::string name, unsigned int width, unsigned int height, DXGI_FORMAT format)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.desc.width = width;
+	resource.desc.height = height;
+	resource.desc.format = format;
+	resource.imported = true;
+	this->resources.push_back(resource);
+	return (unsigned int)this->resources.size() - 1;
+}
+
+unsigned int FrameGraph::AddPass(std::string name, std::function<void()> execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.culled = false;
+	this->passes.push_back(pass);
+	return (unsigned int)this->passes.size() - 1;
+}
+
+void FrameGraph::Read(unsigned int pass, unsigned int resource, FrameGraphBindPoint point, unsigned int slot)
+{
+	Access access = { resource, { point, slot }, false, FRAME_GRAPH_WRITE_PRESERVE };
+	this->passes[pass].accesses.push_back(access);
+}
+
+void FrameGraph::Write(unsigned int pass, unsigned int resource, FrameGraphBindPoint point, unsigned int slot, FrameGraphWrite write)
+{
+	Access access = { resource, { point, point == FRAME_GRAPH_BIND_RENDER_TARGETS ? 0 : slot }, true, write };
+	this->passes[pass].accesses.push_back(access);
+}
+
+void FrameGraph::Compile()
+{
+	this->CullPasses();
+	this->AllocateTargets();
+	this->ResolveHazards();
+}
+
+// --------------------------------------------------------
+// Runs every pass that wasn't culled, unbinding whatever
+// would conflict with it first
+// --------------------------------------------------------
+void FrameGraph::Execute()
+{
+	for (size_t p = 0; p < this->passes.size(); p++)
+	{
+		Pass& pass = this->passes[p];
+		if (pass.culled)
+			continue;
+
+		for (size_t u = 0; u < pass.unbinds.size(); u++)
+			this->Unbind(pass.unbinds[u]);
+		if (pass.execute)
+			pass.execute();
+	}
+
+	for (size_t u = 0; u < this->finalUnbinds.size(); u++)
+		this->Unbind(this->finalUnbinds[u]);
+}
+
+unsigned int FrameGraph::GetTarget(unsigned int resource)
+{
+	return this->resources[resource].target;
+}
+
+unsigned int FrameGraph::GetPassCount()
+{
+	return (unsigned int)this->passes.size();
+}
+
+unsigned int FrameGraph::GetCulledPassCount()
+{
+	unsigned int count = 0;
+	for (size_t p = 0; p < this->passes.size(); p++)
+	{
+		if (this->passes[p].culled)
+			count++;
+	}
+	return count;
+}
+
+unsigned int FrameGraph::GetUnbindCount()
+{
+	unsigned int count = (unsigned int)this->finalUnbinds.size();
+	for (size_t p = 0; p < this->passes.size(); p++)
+		count += (unsigned int)this->passes[p].unbinds.size();
+	return count;
+}
+
+const std::string& FrameGraph::GetPassName(unsigned int pass)
+{
+	return this->passes[pass].name;
+}
+
+bool FrameGraph::IsPassCulled(unsigned int pass)
+{
+	return this->passes[pass].culled;
+}
+
+// --------------------------------------------------------
+// A pass drawing over a target (a preserving write) is
+// counted as writing it once; blending's reads aren't counted
+// --------------------------------------------------------
+unsigned long long FrameGraph::GetBytesRead(unsigned int pass)
+{
+	unsigned long long bytes = 0;
+	const Pass& counted = this->passes[pass];
+	for (size_t a = 0; a < counted.accesses.size(); a++)
+	{
+		if (!counted.accesses[a].write)
+			bytes += RenderTargetPool::GetBytes(this->resources[counted.accesses[a].resource].desc);
+	}
+	return bytes;
+}
+
+unsigned long long FrameGraph::GetBytesWritten(unsigned int pass)
+{
+	unsigned long long bytes = 0;
+	const Pass& counted = this->passes[pass];
+	for (size_t a = 0; a < counted.accesses.size(); a++)
+	{
+		if (counted.accesses[a].write)
+			bytes += RenderTargetPool::GetBytes(this->resources[counted.accesses[a].resource].desc);
+	}
+	return bytes;
+}
+
+// --------------------------------------------------------
+// Lists the compiled frame like:
+//
+//   Scene
+//   Bloom level 0 - unbind render targets
+//   Clear back buffer (culled)
+//   End - unbind ps t0
+// --------------------------------------------------------
+std::string FrameGraph::Describe()
+{
+	std::string text;
+	for (size_t p = 0; p < this->passes.size(); p++)
+	{
+		const Pass& pass = this->passes[p];
+		text += pass.name;
+		if (pass.culled)
+			text += " (culled)";
+
+		for (size_t u = 0; u < pass.unbinds.size(); u++)
+		{
+			text += u == 0 ? " - unbind " : ", ";
+			DescribeBinding(pass.unbinds[u], text);
+		}
+		text += "\n";
+	}
+
+	text += "End";
+	for (size_t u = 0; u < this->finalUnbinds.size(); u++)
+	{
+		text += u == 0 ? " - unbind " : ", ";
+		DescribeBinding(this->finalUnbinds[u], text);
+	}
+	text += "\n";
+	return text;
+}
+
+void FrameGraph::Unbind(const FrameGraphBinding& binding)
+{
+}
+
+// --------------------------------------------------------
+// Walks the passes from last to first, keeping track of which
+// resources a later pass still needs.  A pass that writes
+// none of them is culled; one that discards a resource's
+// contents means nothing before it needs that resource.
+// --------------------------------------------------------
+void FrameGraph::CullPasses()
+{
+	std::vector<bool> needed(this->resources.size());
+	for (size_t r = 0; r < this->resources.size(); r++)
+		needed[r] = this->resources[r].imported;
+
+	for (size_t p = this->passes.size(); p-- > 0;)
+	{
+		Pass& pass = this->passes[p];
+		pass.culled = true;
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+		{
+			if (pass.accesses[a].write && needed[pass.accesses[a].resource])
+				pass.culled = false;
+		}
+
+		if (pass.culled)
+			continue;
+
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+		{
+			const Access& access = pass.accesses[a];
+			if (access.write && access.writeType == FRAME_GRAPH_WRITE_DISCARD)
+				needed[access.resource] = false;
+		}
+
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+		{
+			if (!pass.accesses[a].write)
+				needed[pass.accesses[a].resource] = true;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Acquires each transient target right before the first pass
+// using it and releases it right after the last, so a later
+// target of the same size and format can reuse its texture
+// --------------------------------------------------------
+void FrameGraph::AllocateTargets()
+{
+	for (size_t r = 0; r < this->resources.size(); r++)
+	{
+		Resource& resource = this->resources[r];
+		resource.firstPass = -1;
+		resource.lastPass = -1;
+		resource.target = 0;
+		resource.physical = ImportedPhysical + (unsigned int)r;
+	}
+
+	for (size_t p = 0; p < this->passes.size(); p++)
+	{
+		const Pass& pass = this->passes[p];
+		if (pass.culled)
+			continue;
+
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+		{
+			Resource& resource = this->resources[pass.accesses[a].resource];
+			if (resource.firstPass < 0)
+				resource.firstPass = (int)p;
+			resource.lastPass = (int)p;
+		}
+	}
+
+	for (int p = 0; p < (int)this->passes.size(); p++)
+	{
+		for (size_t r = 0; r < this->resources.size(); r++)
+		{
+			Resource& resource = this->resources[r];
+			if (!resource.imported && resource.firstPass == p)
+			{
+				resource.target = this->targets->Acquire(resource.desc.width, resource.desc.height, resource.desc.format);
+				resource.physical = resource.target;
+			}
+		}
+
+		for (size_t r = 0; r < this->resources.size(); r++)
+		{
+			if (!this->resources[r].imported && this->resources[r].lastPass == p)
+				this->targets->Release(this->resources[r].target);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Plays the frame's bindings forward, recording what has to
+// be unbound before each pass: any view of a texture the
+// pass uses that's bound the other way (read vs. written)
+// --------------------------------------------------------
+void FrameGraph::ResolveHazards()
+{
+	std::vector<BoundView> bound;
+	for (size_t p = 0; p < this->passes.size(); p++)
+	{
+		Pass& pass = this->passes[p];
+		pass.unbinds.clear();
+		if (pass.culled)
+			continue;
+
+		// Setting render targets replaces all of the old ones,
+		// and any other view replaces the one in its slot
+		bool setsRenderTargets = false;
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+			setsRenderTargets = setsRenderTargets || pass.accesses[a].binding.point == FRAME_GRAPH_BIND_RENDER_TARGETS;
+
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+			this->UnbindConflicts(pass, pass.accesses[a], setsRenderTargets, bound);
+
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+		{
+			const FrameGraphBinding& binding = pass.accesses[a].binding;
+			for (size_t b = bound.size(); b-- > 0;)
+			{
+				bool replaced = bound[b].binding.point == FRAME_GRAPH_BIND_RENDER_TARGETS ?
+					setsRenderTargets :
+					bound[b].binding.point == binding.point && bound[b].binding.slot == binding.slot;
+				if (replaced)
+					bound.erase(bound.begin() + b);
+			}
+		}
+
+		for (size_t a = 0; a < pass.accesses.size(); a++)
+		{
+			BoundView view = { pass.accesses[a].binding, this->resources[pass.accesses[a].resource].physical };
+			bound.push_back(view);
+		}
+	}
+
+	// Render targets are left to whoever draws next, but
+	// nothing should still be reading or writing a pooled
+	// texture when the next frame hands it out again
+	this->finalUnbinds.clear();
+	for (size_t b = 0; b < bound.size(); b++)
+	{
+		if (bound[b].binding.point != FRAME_GRAPH_BIND_RENDER_TARGETS)
+			this->finalUnbinds.push_back(bound[b].binding);
+	}
+}
+
+// --------------------------------------------------------
+// Unbinds every view of the access's texture that's bound
+// the other way - for reading if it's written, or for writing
+// if it's read.  Render targets the pass is about to replace
+// are left alone.
+// --------------------------------------------------------
+void FrameGraph::UnbindConflicts(Pass& pass, const Access& access, bool setsRenderTargets, std::vector<BoundView>& bound)
+{
+	unsigned int physical = this->resources[access.resource].physical;
+	for (size_t b = 0; b < bound.size();)
+	{
+		const FrameGraphBinding& binding = bound[b].binding;
+		bool boundForWriting = binding.point == FRAME_GRAPH_BIND_UNORDERED_ACCESS || binding.point == FRAME_GRAPH_BIND_RENDER_TARGETS;
+		bool replaced = binding.point == FRAME_GRAPH_BIND_RENDER_TARGETS && setsRenderTargets;
+		if (bound[b].physical != physical || binding.point == access.binding.point || (!access.write && !boundForWriting) || replaced)
+		{
+			b++;
+			continue;
+		}
+
+		pass.unbinds.push_back(binding);
+		if (binding.point != FRAME_GRAPH_BIND_RENDER_TARGETS)
+		{
+			bound.erase(bound.begin() + b);
+			continue;
+		}
+
+		// Render targets can only be unbound all together
+		for (size_t r = bound.size(); r-- > 0;)
+		{
+			if (bound[r].binding.point == FRAME_GRAPH_BIND_RENDER_TARGETS)
+				bound.erase(bound.begin() + r);
+		}
+		b = 0;
+	}
+}
+
+void FrameGraph::DescribeBinding(const FrameGraphBinding& binding, std::string& text)
+{
+	switch (binding.point)
+	{
+	case FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE:
+		text += "ps t" + std::to_string(binding.slot);
+		break;
+	case FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE:
+		text += "cs t" + std::to_string(binding.slot);
+		break;
+	case FRAME_GRAPH_BIND_UNORDERED_ACCESS:
+		text += "cs u" + std::to_string(binding.slot);
+		break;
+	case FRAME_GRAPH_BIND_RENDER_TARGETS:
+		text += "render targets";
+		break;
+	}
+}
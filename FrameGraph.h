@@ -0,0 +1,146 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "RenderTargetPool.h"
+
+// Where a pass binds a resource
+enum FrameGraphBindPoint
+{
+	FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE,		// Read: PSSetShaderResources
+	FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE,	// Read: CSSetShaderResources
+	FRAME_GRAPH_BIND_UNORDERED_ACCESS,			// Write: CSSetUnorderedAccessViews
+	FRAME_GRAPH_BIND_RENDER_TARGETS				// Write: OMSetRenderTargets (slot unused)
+};
+
+// What a write leaves of the resource's previous contents
+enum FrameGraphWrite
+{
+	FRAME_GRAPH_WRITE_DISCARD,	// Every texel is overwritten (clears, fullscreen passes)
+	FRAME_GRAPH_WRITE_PRESERVE	// Drawn over, so earlier writes still matter
+};
+
+// A bind point and slot, for unbinding
+struct FrameGraphBinding
+{
+	FrameGraphBindPoint point;
+	unsigned int slot;
+};
+
+// --------------------------------------------------------
+// Orders, culls and allocates one frame's passes from what
+// each one declares it reads and writes
+//
+// - Targets are either transient (CreateTarget(), allocated
+//   from a RenderTargetPool only for the passes using them)
+//   or imported (ImportTarget(), like the back buffer, and
+//   assumed to be needed after the frame).  Both have a size
+//   and format, for GetBytesRead() and GetBytesWritten().
+// - Compile() walks the passes backwards and culls any that
+//   only write what nothing later needs.  Clears are just
+//   passes that discard their target, so a clear that's
+//   overwritten before anything reads it is culled too.
+// - It then acquires each transient target before its first
+//   pass and releases it after its last, so targets whose
+//   lifetimes don't overlap share a texture
+// - Finally it tracks what every pass leaves bound, and
+//   unbinds exactly the views that would conflict with the
+//   next pass's (an SRV of a texture about to be rendered
+//   to, or a render target about to be sampled), plus every
+//   shader resource left bound at the end of the frame
+//
+// Passes run in the order they were added, and a pass that
+// writes render targets must set them before binding anything
+// to read (so the old ones never need unbinding).  Unbinding
+// is left to a subclass (see DeviceFrameGraph), so compiling
+// needs no Direct3D device at all.
+// --------------------------------------------------------
+class FrameGraph {
+public:
+	FrameGraph(RenderTargetPool* targets);
+	virtual ~FrameGraph();
+
+	void Reset();
+
+	unsigned int CreateTarget(std::string name, unsigned int width, unsigned int height, DXGI_FORMAT format);
+	unsigned int ImportTarget(std::string name, unsigned int width, unsigned int height, DXGI_FORMAT format);
+
+	unsigned int AddPass(std::string name, std::function<void()> execute);
+	void Read(unsigned int pass, unsigned int resource, FrameGraphBindPoint point, unsigned int slot);
+	void Write(unsigned int pass, unsigned int resource, FrameGraphBindPoint point, unsigned int slot, FrameGraphWrite write);
+
+	void Compile();
+	void Execute();
+
+	// After Compile(): the pool target behind a transient
+	// resource, for the passes using it
+	unsigned int GetTarget(unsigned int resource);
+
+	unsigned int GetPassCount();
+	unsigned int GetCulledPassCount();
+	unsigned int GetUnbindCount();
+	const std::string& GetPassName(unsigned int pass);
+	bool IsPassCulled(unsigned int pass);
+
+	// Memory traffic estimates from each pass's declared reads
+	// and writes, assuming every texel crosses the bus once
+	// (the texture cache catching any repeats)
+	unsigned long long GetBytesRead(unsigned int pass);
+	unsigned long long GetBytesWritten(unsigned int pass);
+
+	// The compiled frame, one pass per line with what's
+	// unbound before it, for golden tests
+	std::string Describe();
+
+protected:
+	virtual void Unbind(const FrameGraphBinding& binding);
+
+private:
+	struct Resource
+	{
+		std::string name;
+		RenderTargetDesc desc;
+		bool imported;
+		unsigned int target;
+		unsigned int physical;	// Same for resources sharing a texture
+		int firstPass;
+		int lastPass;
+	};
+
+	struct Access
+	{
+		unsigned int resource;
+		FrameGraphBinding binding;
+		bool write;
+		FrameGraphWrite writeType;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::function<void()> execute;
+		std::vector<Access> accesses;
+		bool culled;
+		std::vector<FrameGraphBinding> unbinds;
+	};
+
+	// A view of a texture bound somewhere right now
+	struct BoundView
+	{
+		FrameGraphBinding binding;
+		unsigned int physical;
+	};
+
+	void CullPasses();
+	void AllocateTargets();
+	void ResolveHazards();
+	void UnbindConflicts(Pass& pass, const Access& access, bool setsRenderTargets, std::vector<BoundView>& bound);
+	static void DescribeBinding(const FrameGraphBinding& binding, std::string& text);
+
+	RenderTargetPool* targets;
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<FrameGraphBinding> finalUnbinds;
+};
@@ -0,0 +1,118 @@
+#include "Frustum.h"
+#include <emmintrin.h>
+#include <math.h>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Extracts the six planes from a (row-vector) view-projection
+// matrix, using Direct3D's 0-1 clip space depth range
+// --------------------------------------------------------
+void Frustum::ExtractPlanes(const DirectX::XMFLOAT4X4& viewProjection, DirectX::XMFLOAT4 planes[6])
+{
+	const XMFLOAT4X4& m = viewProjection;
+
+	// Each clip space coordinate is the point dotted with
+	// one column, so each plane is a sum of two columns
+	planes[0] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41); // Left:   w + x
+	planes[1] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41); // Right:  w - x
+	planes[2] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42); // Bottom: w + y
+	planes[3] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42); // Top:    w - y
+	planes[4] = XMFLOAT4(m._13, m._23, m._33, m._43);                                 // Near:   z
+	planes[5] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43); // Far:    w - z
+
+	// Unit normals, so plane distances are real distances
+	// that can be compared against radii
+	for (int i = 0; i < 6; i++)
+	{
+		float length = sqrtf(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+		planes[i] = XMFLOAT4(planes[i].x / length, planes[i].y / length, planes[i].z / length, planes[i].w / length);
+	}
+}
+
+// --------------------------------------------------------
+// Tests four spheres per iteration, one per SSE lane.
+// Produces exactly the same list as CullSpheresScalar().
+// --------------------------------------------------------
+unsigned int Frustum::CullSpheres(
+	const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+	unsigned int count, const DirectX::XMFLOAT4 planes[6], unsigned int* visible)
+{
+	// Broadcast each plane component once
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(planes[p].x);
+		planeY[p] = _mm_set1_ps(planes[p].y);
+		planeZ[p] = _mm_set1_ps(planes[p].z);
+		planeW[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	unsigned int visibleCount = 0;
+	unsigned int simdCount = count & ~3u;
+	const __m128 zero = _mm_setzero_ps();
+
+	for (unsigned int i = 0; i < simdCount; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&centerX[i]);
+		__m128 y = _mm_loadu_ps(&centerY[i]);
+		__m128 z = _mm_loadu_ps(&centerZ[i]);
+		__m128 r = _mm_loadu_ps(&radius[i]);
+
+		// Inside every plane: distance + radius >= 0
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+		}
+
+		// Append the visible lanes in order
+		int mask = _mm_movemask_ps(inside);
+		if (mask == 0)
+			continue;
+
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (mask & (1 << lane))
+				visible[visibleCount++] = i + lane;
+		}
+	}
+
+	// Leftovers, whose indices come back relative to simdCount
+	unsigned int leftoverCount = CullSpheresScalar(
+		centerX + simdCount, centerY + simdCount, centerZ + simdCount, radius + simdCount,
+		count - simdCount, planes, visible + visibleCount);
+
+	for (unsigned int v = 0; v < leftoverCount; v++)
+		visible[visibleCount++] += simdCount;
+
+	return visibleCount;
+}
+
+// --------------------------------------------------------
+// Scalar reference version of CullSpheres()
+// --------------------------------------------------------
+unsigned int Frustum::CullSpheresScalar(
+	const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+	unsigned int count, const DirectX::XMFLOAT4 planes[6], unsigned int* visible)
+{
+	unsigned int visibleCount = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6; p++)
+		{
+			float distance =
+				(planes[p].x * centerX[i] + planes[p].y * centerY[i]) +
+				(planes[p].z * centerZ[i] + planes[p].w);
+			inside = inside && distance + radius[i] >= 0;
+		}
+
+		if (inside)
+			visible[visibleCount++] = i;
+	}
+	return visibleCount;
+}
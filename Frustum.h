@@ -0,0 +1,28 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// View frustum helpers for CPU culling
+//
+// Planes are (a, b, c, d) with unit-length normals pointing
+// into the frustum, so a point p is inside a plane when
+// a*p.x + b*p.y + c*p.z + d >= 0.  Order: left, right,
+// bottom, top, near, far.
+//
+// Bounding spheres are passed as separate center x/y/z and
+// radius arrays (structure-of-arrays), and the indices of
+// those that touch the frustum are written to visible.
+// --------------------------------------------------------
+class Frustum {
+public:
+	static void ExtractPlanes(const DirectX::XMFLOAT4X4& viewProjection, DirectX::XMFLOAT4 planes[6]);
+
+	static unsigned int CullSpheres(
+		const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+		unsigned int count, const DirectX::XMFLOAT4 planes[6], unsigned int* visible);
+
+	static unsigned int CullSpheresScalar(
+		const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+		unsigned int count, const DirectX::XMFLOAT4 planes[6], unsigned int* visible);
+};
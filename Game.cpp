@@ -1,14 +1,685 @@
 #include "Game.h"
 #include "Vertex.h"
 #include "Input.h"
+#include "Frustum.h"
+#include <algorithm>
 
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
+#include <DirectXPackedVector.h>
 
 // For the DirectX Math library
 using namespace DirectX;
 
+// --------------------------------------------------------
+// The register a shader reads a texture from, for declaring
+// a pass's reads to the frame graph
+// --------------------------------------------------------
+static unsigned int ShaderResourceSlot(std::shared_ptr<ISimpleShader> shader, std::string name)
+{
+	const SimpleSRV* srv = shader->GetShaderResourceViewInfo(name);
+	return srv ? srv->BindIndex : 0;
+}
+
+// --------------------------------------------------------
+// Downsamples source to 1 / sourceStep of its size (2 or 4)
+// and blurs it into target with one BloomDownsampleCS
+// dispatch.  Both stay bound, so target has to be unbound
+// before it's read.
+//
+// exposure  - AutoExposureCS's state, which the threshold is
+//             divided by
+// threshold - Subtracted before blurring (only the first
+//             level should have one)
+// weights   - One per texel, center first (see BloomFilter)
+// --------------------------------------------------------
+static void DispatchBloomLevel(
+	std::shared_ptr<SimpleComputeShader> shader,
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> source,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> exposure,
+	unsigned int sourceWidth,
+	unsigned int sourceHeight,
+	unsigned int sourceStep,
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> target,
+	float threshold,
+	const float* weights,
+	int radius)
+{
+	unsigned int targetSize[2] = { BloomFilter::LevelSize(sourceWidth, sourceStep), BloomFilter::LevelSize(sourceHeight, sourceStep) };
+	if (radius > BloomFilter::MaxRadius)
+		radius = BloomFilter::MaxRadius;
+
+	// Array elements in a cbuffer take 16 bytes each
+	XMFLOAT4 packedWeights[BloomFilter::MaxRadius + 1] = {};
+	for (int r = 0; r <= radius; r++)
+		packedWeights[r].x = weights[r];
+
+	shader->SetShader();
+	shader->SetSamplerState("samplerOptions", sampler);
+	shader->SetShaderResourceView("source", source);
+	shader->SetShaderResourceView("exposureState", exposure);
+	shader->SetUnorderedAccessView("target", target);
+	shader->SetFloat2("sourceTexelSize", XMFLOAT2(1.0f / sourceWidth, 1.0f / sourceHeight));
+	shader->SetData("targetSize", targetSize, sizeof(targetSize));
+	shader->SetFloat("threshold", threshold);
+	shader->SetInt("radius", radius);
+	shader->SetInt("sourceStep", sourceStep);
+	shader->SetData("weights", packedWeights, sizeof(packedWeights));
+	shader->CopyAllBufferData();
+	shader->DispatchByThreads(targetSize[0], targetSize[1], 1);
+}
+
+#if defined(DEBUG) || defined(_DEBUG)
+// --------------------------------------------------------
+// Runs the compute shader bloom chain over a synthetic HDR
+// image and diffs every level it produces against
+// BloomFilter's CPU reference
+// --------------------------------------------------------
+static void CheckComputeBloom(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<SimpleComputeShader> shader,
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> exposure)
+{
+	const unsigned int width = 320;
+	const unsigned int height = 180;
+	const int levelCount = 5;
+	const float threshold = 0.75f;
+	GaussianKernel kernel(7.5f);
+
+	// Dim noise with a few bright spots, rounded to half
+	// precision first so both sides start from the same image
+	BloomImage source;
+	source.width = width;
+	source.height = height;
+	source.pixels.resize(width * height);
+	std::vector<PackedVector::HALF> sourceHalves(width * height * 4);
+	srand(12345);
+	for (unsigned int i = 0; i < width * height; i++)
+	{
+		float brightness = rand() % 200 == 0 ? 20.0f : 1.0f;
+		float* pixel = &source.pixels[i].x;
+		for (int c = 0; c < 4; c++)
+		{
+			float value = c == 3 ? 1.0f : brightness * rand() / (float)RAND_MAX;
+			sourceHalves[i * 4 + c] = PackedVector::XMConvertFloatToHalf(value);
+			pixel[c] = PackedVector::XMConvertHalfToFloat(sourceHalves[i * 4 + c]);
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = &sourceHalves[0];
+	initialData.SysMemPitch = width * sizeof(PackedVector::HALF) * 4;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> sourceTexture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sourceSRV;
+	device->CreateTexture2D(&textureDesc, &initialData, sourceTexture.GetAddressOf());
+	device->CreateShaderResourceView(sourceTexture.Get(), 0, sourceSRV.GetAddressOf());
+
+	BloomImage reference[levelCount];
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> levelTextures[levelCount];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> levelSRVs[levelCount];
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> levelUAVs[levelCount];
+
+	const BloomImage* levelSource = &source;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> levelSourceSRV = sourceSRV;
+	for (int i = 0; i < levelCount; i++)
+	{
+		float levelThreshold = i == 0 ? threshold : 0.0f;
+		BloomFilter::DownsampleBlur(*levelSource, 2, levelThreshold, kernel.GetWeights(), kernel.GetRadius(), reference[i]);
+
+		textureDesc.Width = reference[i].width;
+		textureDesc.Height = reference[i].height;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+		device->CreateTexture2D(&textureDesc, 0, levelTextures[i].GetAddressOf());
+		device->CreateShaderResourceView(levelTextures[i].Get(), 0, levelSRVs[i].GetAddressOf());
+		device->CreateUnorderedAccessView(levelTextures[i].Get(), 0, levelUAVs[i].GetAddressOf());
+
+		DispatchBloomLevel(shader, sampler, levelSourceSRV, exposure, levelSource->width, levelSource->height, 2, levelUAVs[i],
+			levelThreshold, kernel.GetWeights(), kernel.GetRadius());
+		shader->SetUnorderedAccessView("target", 0);
+		shader->SetShaderResourceView("source", 0);
+
+		levelSource = &reference[i];
+		levelSourceSRV = levelSRVs[i];
+	}
+
+	// Errors are relative for bright texels, since half floats
+	// only keep about three significant digits
+	float maxError = 0.0f;
+	for (int i = 0; i < levelCount; i++)
+	{
+		D3D11_TEXTURE2D_DESC stagingDesc = {};
+		levelTextures[i]->GetDesc(&stagingDesc);
+		stagingDesc.BindFlags = 0;
+		stagingDesc.Usage = D3D11_USAGE_STAGING;
+		stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> staging;
+		device->CreateTexture2D(&stagingDesc, 0, staging.GetAddressOf());
+		context->CopyResource(staging.Get(), levelTextures[i].Get());
+
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+		for (unsigned int y = 0; y < stagingDesc.Height; y++)
+		{
+			const PackedVector::HALF* row = (const PackedVector::HALF*)((const char*)mapped.pData + y * mapped.RowPitch);
+			for (unsigned int x = 0; x < stagingDesc.Width; x++)
+			{
+				const float* expected = &reference[i].pixels[y * stagingDesc.Width + x].x;
+				for (int c = 0; c < 3; c++)
+				{
+					float actual = PackedVector::XMConvertHalfToFloat(row[x * 4 + c]);
+					float error = fabsf(actual - expected[c]) / fmaxf(1.0f, fabsf(expected[c]));
+					maxError = fmaxf(maxError, error);
+				}
+			}
+		}
+		context->Unmap(staging.Get(), 0);
+	}
+
+	printf("Compute bloom: %d levels of %ux%u in %d passes (pixel shaders: %d), max error against the CPU reference %.5f%s\n",
+		levelCount, width, height,
+		levelCount + 1,
+		levelCount * 2 + 2,
+		maxError,
+		maxError < 0.01f ? "" : " (MISMATCH)");
+}
+
+// --------------------------------------------------------
+// Checks SceneMaxCS against BloomEarlyOut::FindMaxValue() for
+// a scene just under the threshold and one with a single
+// bright texel, each at an exposure of one and of 2.5
+// --------------------------------------------------------
+static void CheckBloomEarlyOut(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<SimpleComputeShader> shader)
+{
+	// Odd sizes, so the last groups are partly outside
+	const unsigned int width = 333;
+	const unsigned int height = 187;
+
+	// Exposure states as AutoExposureCS leaves them (only the
+	// exposure itself matters here)
+	const float exposures[2] = { 1.0f, 2.5f };
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> exposureSRVs[2];
+	for (int e = 0; e < 2; e++)
+	{
+		float exposureState[2] = { exposures[e], 0.0f };
+		D3D11_SUBRESOURCE_DATA exposureData = {};
+		exposureData.pSysMem = exposureState;
+
+		D3D11_BUFFER_DESC exposureDesc = {};
+		exposureDesc.ByteWidth = sizeof(exposureState);
+		exposureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		exposureDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		exposureDesc.StructureByteStride = sizeof(float);
+		exposureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> exposureBuffer;
+		device->CreateBuffer(&exposureDesc, &exposureData, exposureBuffer.GetAddressOf());
+		device->CreateShaderResourceView(exposureBuffer.Get(), 0, exposureSRVs[e].GetAddressOf());
+	}
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(unsigned int);
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> resultBuffer;
+	device->CreateBuffer(&bufferDesc, 0, resultBuffer.GetAddressOf());
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = 1;
+	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> resultUAV;
+	device->CreateUnorderedAccessView(resultBuffer.Get(), &uavDesc, resultUAV.GetAddressOf());
+
+	bufferDesc.BindFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> stagingBuffer;
+	device->CreateBuffer(&bufferDesc, 0, stagingBuffer.GetAddressOf());
+
+	bool reductionMatches = true;
+	srand(54321);
+	for (int bright = 0; bright < 2; bright++)
+	{
+		BloomImage scene;
+		scene.width = width;
+		scene.height = height;
+		scene.pixels.resize(width * height);
+		std::vector<PackedVector::HALF> halves(width * height * 4);
+		for (unsigned int i = 0; i < width * height; i++)
+		{
+			float* pixel = &scene.pixels[i].x;
+			for (int c = 0; c < 4; c++)
+			{
+				float value = c == 3 ? 1.0f : 0.7f * rand() / (float)RAND_MAX;
+				if (bright && i == width * (height / 2) + width / 2 && c == 2)
+					value = 4.0f;
+				halves[i * 4 + c] = PackedVector::XMConvertFloatToHalf(value);
+				pixel[c] = PackedVector::XMConvertHalfToFloat(halves[i * 4 + c]);
+			}
+		}
+
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = width;
+		textureDesc.Height = height;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		D3D11_SUBRESOURCE_DATA initialData = {};
+		initialData.pSysMem = &halves[0];
+		initialData.SysMemPitch = width * sizeof(PackedVector::HALF) * 4;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		device->CreateTexture2D(&textureDesc, &initialData, texture.GetAddressOf());
+		device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf());
+
+		for (int e = 0; e < 2; e++)
+		{
+			const unsigned int zeros[4] = {};
+			context->ClearUnorderedAccessViewUint(resultUAV.Get(), zeros);
+
+			unsigned int sourceSize[2] = { width, height };
+			shader->SetShader();
+			shader->SetShaderResourceView("source", srv);
+			shader->SetShaderResourceView("exposureState", exposureSRVs[e]);
+			shader->SetUnorderedAccessView("sceneMax", resultUAV);
+			shader->SetData("sourceSize", sourceSize, sizeof(sourceSize));
+			shader->CopyAllBufferData();
+			shader->DispatchByThreads((width + 1) / 2, (height + 1) / 2, 1);
+			shader->SetUnorderedAccessView("sceneMax", 0);
+			shader->SetShaderResourceView("source", 0);
+
+			// Waiting on the GPU is fine here, unlike in Draw()
+			context->CopyResource(stagingBuffer.Get(), resultBuffer.Get());
+			D3D11_MAPPED_SUBRESOURCE mapped = {};
+			context->Map(stagingBuffer.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+			float gpuMax = *(const float*)mapped.pData;
+			context->Unmap(stagingBuffer.Get(), 0);
+
+			if (gpuMax != BloomEarlyOut::FindMaxValue(scene, exposures[e]))
+				reductionMatches = false;
+		}
+	}
+
+	printf("Bloom early out: SceneMaxCS %s the CPU reference\n",
+		reductionMatches ? "matches" : "(MISMATCH) doesn't match");
+}
+
+// --------------------------------------------------------
+// Makes a half float texture from a BloomImage, rounding the
+// image to what the texture holds
+// --------------------------------------------------------
+static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateHalfTexture(Microsoft::WRL::ComPtr<ID3D11Device> device, BloomImage& image)
+{
+	std::vector<PackedVector::HALF> halves(image.pixels.size() * 4);
+	for (size_t i = 0; i < image.pixels.size(); i++)
+	{
+		float* pixel = &image.pixels[i].x;
+		for (int c = 0; c < 4; c++)
+		{
+			halves[i * 4 + c] = PackedVector::XMConvertFloatToHalf(pixel[c]);
+			pixel[c] = PackedVector::XMConvertHalfToFloat(halves[i * 4 + c]);
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = image.width;
+	textureDesc.Height = image.height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = &halves[0];
+	initialData.SysMemPitch = image.width * sizeof(PackedVector::HALF) * 4;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	device->CreateTexture2D(&textureDesc, &initialData, texture.GetAddressOf());
+	device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf());
+	return srv;
+}
+
+// --------------------------------------------------------
+// Draws BloomCombinePS into an 8 bit target, like the back
+// buffer, with each tonemapper and compares it to the CPU
+// reference (BloomFilter::Combine() and Resolve())
+// --------------------------------------------------------
+static void CheckBloomCombine(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<SimpleVertexShader> vertexShader,
+	std::shared_ptr<SimplePixelShader> pixelShader,
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> exposure)
+{
+	const int levelCount = 2;
+	const unsigned int width = 128;
+	const unsigned int height = 72;
+	const float exposure = 0.8f;
+	const float levelIntensities[levelCount] = { 1.0f, 0.5f };
+
+	// A ramp from black to well past white, and levels that
+	// are brightest in the middle
+	BloomImage scene;
+	scene.width = width;
+	scene.height = height;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float value = 8.0f * x / width;
+			scene.pixels.push_back(XMFLOAT4(value, value * y / height, 0.25f * value, 1.0f));
+		}
+	}
+
+	BloomImage levels[levelCount];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> levelSRVs[levelCount];
+	for (int i = 0; i < levelCount; i++)
+	{
+		levels[i].width = width >> (i + 1);
+		levels[i].height = height >> (i + 1);
+		for (unsigned int y = 0; y < levels[i].height; y++)
+		{
+			for (unsigned int x = 0; x < levels[i].width; x++)
+			{
+				float u = (x + 0.5f) / levels[i].width - 0.5f;
+				float v = (y + 0.5f) / levels[i].height - 0.5f;
+				float value = expf(-8.0f * (u * u + v * v));
+				levels[i].pixels.push_back(XMFLOAT4(value, 0.5f * value, value, 0.0f));
+			}
+		}
+		levelSRVs[i] = CreateHalfTexture(device, levels[i]);
+	}
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneSRV = CreateHalfTexture(device, scene);
+
+	D3D11_TEXTURE2D_DESC targetDesc = {};
+	targetDesc.Width = width;
+	targetDesc.Height = height;
+	targetDesc.MipLevels = 1;
+	targetDesc.ArraySize = 1;
+	targetDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	targetDesc.SampleDesc.Count = 1;
+	targetDesc.Usage = D3D11_USAGE_DEFAULT;
+	targetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> target;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> targetRTV;
+	device->CreateTexture2D(&targetDesc, 0, target.GetAddressOf());
+	device->CreateRenderTargetView(target.Get(), 0, targetRTV.GetAddressOf());
+
+	targetDesc.BindFlags = 0;
+	targetDesc.Usage = D3D11_USAGE_STAGING;
+	targetDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staging;
+	device->CreateTexture2D(&targetDesc, 0, staging.GetAddressOf());
+
+	BloomImage combined;
+	BloomFilter::Combine(scene, levels, levelIntensities, levelCount, combined);
+
+	XMFLOAT4 intensities[BloomFilter::MaxLevels] = {};
+	for (int i = 0; i < levelCount; i++)
+		intensities[i].x = levelIntensities[i];
+
+	const Tonemapper tonemappers[2] = { TONEMAPPER_REINHARD, TONEMAPPER_ACES };
+	int maxError[2] = {};
+	for (int t = 0; t < 2; t++)
+	{
+		std::vector<unsigned char> expected;
+		BloomFilter::Resolve(combined, exposure, tonemappers[t], expected);
+
+		UINT stride = sizeof(Vertex);
+		UINT offset = 0;
+		ID3D11Buffer* nothing = 0;
+		context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+		context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+
+		D3D11_VIEWPORT viewport = {};
+		viewport.Width = (float)width;
+		viewport.Height = (float)height;
+		viewport.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &viewport);
+		context->OMSetRenderTargets(1, targetRTV.GetAddressOf(), 0);
+		context->PSSetSamplers(0, 1, sampler.GetAddressOf());
+
+		vertexShader->SetShader();
+		pixelShader->SetShader();
+		pixelShader->SetShaderResourceView("originalPixels", sceneSRV);
+		pixelShader->SetShaderResourceView("bloomedPixels0", levelSRVs[0]);
+		pixelShader->SetShaderResourceView("bloomedPixels1", levelSRVs[1]);
+		pixelShader->SetShaderResourceView("exposureState", exposure);
+		pixelShader->SetData("intensities", intensities, sizeof(intensities));
+		pixelShader->SetFloat("exposure", exposure);
+		pixelShader->SetInt("tonemapper", tonemappers[t]);
+		pixelShader->CopyAllBufferData();
+		context->Draw(3, 0);
+
+		context->OMSetRenderTargets(0, 0, 0);
+		pixelShader->SetShaderResourceView("originalPixels", 0);
+		pixelShader->SetShaderResourceView("bloomedPixels0", 0);
+		pixelShader->SetShaderResourceView("bloomedPixels1", 0);
+
+		context->CopyResource(staging.Get(), target.Get());
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+		for (unsigned int y = 0; y < height; y++)
+		{
+			const unsigned char* row = (const unsigned char*)mapped.pData + y * mapped.RowPitch;
+			for (unsigned int x = 0; x < width * 4; x++)
+			{
+				int error = abs(row[x] - expected[y * width * 4 + x]);
+				if (error > maxError[t])
+					maxError[t] = error;
+			}
+		}
+		context->Unmap(staging.Get(), 0);
+	}
+
+	// Filtering and pow() aren't exact on GPUs, so allow a
+	// step either way
+	printf("Bloom combine: %ux%u with %d levels, largest difference from the CPU reference %d/255 with Reinhard, %d/255 with ACES%s\n",
+		width, height, levelCount,
+		maxError[0],
+		maxError[1],
+		maxError[0] <= 1 && maxError[1] <= 1 ? "" : " (MISMATCH)");
+}
+
+// --------------------------------------------------------
+// Checks that AutoExposureCS follows AutoExposure frame by
+// frame on a noisy scene
+// --------------------------------------------------------
+static void CheckAutoExposure(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<SimpleComputeShader> shader)
+{
+	AutoExposureSettings settings;
+
+	// Luminance spread evenly in stops, with some black
+	const unsigned int width = 640;
+	const unsigned int height = 360;
+	const int frameCount = 10;
+	BloomImage scene;
+	scene.width = width;
+	scene.height = height;
+	scene.pixels.resize(width * height);
+	std::vector<PackedVector::HALF> halves(width * height * 4);
+	srand(2024);
+	for (unsigned int i = 0; i < width * height; i++)
+	{
+		float value = rand() % 20 == 0 ? 0.0f : exp2f(-8.0f + 12.0f * rand() / (float)RAND_MAX);
+		float* pixel = &scene.pixels[i].x;
+		for (int c = 0; c < 4; c++)
+		{
+			halves[i * 4 + c] = PackedVector::XMConvertFloatToHalf(c == 3 ? 1.0f : value);
+			pixel[c] = PackedVector::XMConvertHalfToFloat(halves[i * 4 + c]);
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = &halves[0];
+	initialData.SysMemPitch = width * sizeof(PackedVector::HALF) * 4;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	device->CreateTexture2D(&textureDesc, &initialData, texture.GetAddressOf());
+	device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf());
+
+	float state[2] = { 1.0f, AutoExposure::GetInitialLog2Luminance(settings) };
+	D3D11_SUBRESOURCE_DATA stateData = {};
+	stateData.pSysMem = state;
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = sizeof(state);
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(float);
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> stateBuffer;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> stateUAV;
+	device->CreateBuffer(&bufferDesc, &stateData, stateBuffer.GetAddressOf());
+	device->CreateUnorderedAccessView(stateBuffer.Get(), 0, stateUAV.GetAddressOf());
+
+	bufferDesc.BindFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.Usage = D3D11_USAGE_STAGING;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> staging;
+	device->CreateBuffer(&bufferDesc, 0, staging.GetAddressOf());
+
+	unsigned int sampleStep = AutoExposure::GetSampleStep(width, height);
+	unsigned int sampleCount[2] = { width / sampleStep, height / sampleStep };
+	AutoExposure reference(settings);
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		reference.Update(scene, 1.0f / 60.0f);
+
+		shader->SetShader();
+		shader->SetShaderResourceView("source", srv);
+		shader->SetUnorderedAccessView("exposureState", stateUAV);
+		shader->SetData("sampleCount", sampleCount, sizeof(sampleCount));
+		shader->SetInt("sampleStep", sampleStep);
+		shader->SetFloat("minLog2Luminance", settings.minLog2Luminance);
+		shader->SetFloat("maxLog2Luminance", settings.maxLog2Luminance);
+		shader->SetFloat("lowPercent", settings.lowPercent);
+		shader->SetFloat("highPercent", settings.highPercent);
+		shader->SetFloat("key", settings.key);
+		shader->SetFloat("minExposure", settings.minExposure);
+		shader->SetFloat("maxExposure", settings.maxExposure);
+		shader->SetFloat("brightenAdaptation", AutoExposure::GetAdaptation(1.0f / 60.0f, settings.brightenSpeed));
+		shader->SetFloat("darkenAdaptation", AutoExposure::GetAdaptation(1.0f / 60.0f, settings.darkenSpeed));
+		shader->CopyAllBufferData();
+		shader->DispatchByGroups(1, 1, 1);
+	}
+	shader->SetUnorderedAccessView("exposureState", 0);
+	shader->SetShaderResourceView("source", 0);
+
+	context->CopyResource(staging.Get(), stateBuffer.Get());
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+	float gpuExposure = ((const float*)mapped.pData)[0];
+	context->Unmap(staging.Get(), 0);
+
+	// GPU log2() can put a sample right on a bin's edge into
+	// the next one
+	float gpuError = fabsf(gpuExposure / reference.GetExposure() - 1.0f);
+
+	printf("Auto exposure: AutoExposureCS %.4f against the CPU's %.4f after %d frames%s\n",
+		gpuExposure,
+		reference.GetExposure(),
+		frameCount,
+		gpuError < 0.001f ? "" : " (MISMATCH)");
+}
+
+// --------------------------------------------------------
+// Checks that every permutation in the archive creates a
+// valid shader, timing lookups and creation
+// --------------------------------------------------------
+static void CheckShaderArchive(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	ShaderArchive& archive)
+{
+	if (archive.GetEntryCount() == 0)
+	{
+		printf("Shader archive: no PixelShader.shaderpack, using PixelShader.cso\n");
+		return;
+	}
+
+	unsigned int validCount = 0;
+	unsigned int smallest = ~0u;
+	unsigned int largest = 0;
+
+	LARGE_INTEGER startTime, endTime, frequency;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&startTime);
+	for (unsigned int p = 0; p < ShaderPermutations::Count; p++)
+	{
+		unsigned int size = 0;
+		const void* bytecode = archive.Find(ShaderPermutations::GetKey(p), size);
+		if (!bytecode)
+			continue;
+
+		SimplePixelShader shader(device, context, bytecode, size);
+		if (shader.IsShaderValid())
+			validCount++;
+
+		if (size < smallest) smallest = size;
+		if (size > largest) largest = size;
+	}
+	QueryPerformanceCounter(&endTime);
+
+	printf("Shader archive: %u/%u PixelShader permutations valid, %.1f KB, %u to %u bytes each, longest probe %u, %.2f ms per shader created%s\n",
+		validCount,
+		ShaderPermutations::Count,
+		archive.GetSize() / 1024.0,
+		smallest,
+		largest,
+		archive.GetMaxProbeCount(),
+		(double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / frequency.QuadPart / ShaderPermutations::Count,
+		validCount == ShaderPermutations::Count ? "" : " (MISMATCH)");
+}
+#endif
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -24,7 +695,8 @@ Game::Game(HINSTANCE hInstance)
 		1280,			   // Width of the window's client area
 		720,			   // Height of the window's client area
 		true),			   // Show extra stats (fps) in title bar?
-	vsync(false)
+	vsync(false),
+	gpuChecks(strstr(GetCommandLineA(), "-gpuchecks") != 0)
 {
 	camera = std::make_shared<Camera>((float)this->width / this->height, XMFLOAT3(0, 0, -1));
 #if defined(DEBUG) || defined(_DEBUG)
@@ -54,12 +726,37 @@ Game::~Game()
 // --------------------------------------------------------
 void Game::Init()
 {
+#if defined(DEBUG) || defined(_DEBUG)
+	LARGE_INTEGER startTime, endTime, frequency;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&startTime);
+#endif
+
+	// Kick off decoding of every image on worker threads right away.
+	// Only the creation of the actual Direct3D resources, further
+	// down, happens on this thread.
+	AssetLoader assetLoader;
+
+	std::future<ImageData> skyboxFaceData[6] = {
+		assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/skybox/right.png")),
+		assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/skybox/left.png")),
+		assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/skybox/up.png")),
+		assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/skybox/down.png")),
+		assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/skybox/front.png")),
+		assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/skybox/back.png"))
+	};
+
+	std::future<ImageData> starshipAlbedoData = assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/starship_albedo.png"));
+	std::future<ImageData> starshipEmissiveData = assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/starship_emissive.png"));
+	std::future<ImageData> starshipRoughData = assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/starship_roughness.png"));
+	std::future<ImageData> starshipMetalData = assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/starship_metallic.png"));
+	std::future<ImageData> starshipNormalData = assetLoader.LoadImageData(GetFullPathTo_Wide(L"../../assets/textures/starship_normal.png"));
 
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
 	LoadShaders();
-	LoadMeshes();
+	LoadMeshes(assetLoader);
 
 	// Sampler
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
@@ -71,15 +768,69 @@ void Game::Init()
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	device->CreateSamplerState(&samplerDesc, samplerState.GetAddressOf());
 
+	// Post processing reads between texels, and never past the edges
+	D3D11_SAMPLER_DESC ppSamplerDesc = {};
+	ppSamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	ppSamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	ppSamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	ppSamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	ppSamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	device->CreateSamplerState(&ppSamplerDesc, ppSampler.GetAddressOf());
+
+	// SceneMaxCS keeps its result as a single uint, for
+	// InterlockedMax(), in a raw buffer
+	D3D11_BUFFER_DESC sceneMaxDesc = {};
+	sceneMaxDesc.ByteWidth = sizeof(unsigned int);
+	sceneMaxDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	sceneMaxDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	sceneMaxDesc.Usage = D3D11_USAGE_DEFAULT;
+	device->CreateBuffer(&sceneMaxDesc, 0, sceneMaxBuffer.GetAddressOf());
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC sceneMaxUAVDesc = {};
+	sceneMaxUAVDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	sceneMaxUAVDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	sceneMaxUAVDesc.Buffer.NumElements = 1;
+	sceneMaxUAVDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+	device->CreateUnorderedAccessView(sceneMaxBuffer.Get(), &sceneMaxUAVDesc, sceneMaxUAV.GetAddressOf());
+
+	sceneMaxDesc.BindFlags = 0;
+	sceneMaxDesc.MiscFlags = 0;
+	sceneMaxDesc.Usage = D3D11_USAGE_STAGING;
+	sceneMaxDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	for (unsigned int i = 0; i <= BloomEarlyOut::ResultLatency; i++)
+		device->CreateBuffer(&sceneMaxDesc, 0, sceneMaxStaging[i].GetAddressOf());
+
+	// AutoExposureCS's state starts out exposed at 1, and
+	// the fixed one stays there
+	float exposureState[2] = { 1.0f, AutoExposure::GetInitialLog2Luminance(autoExposureSettings) };
+	D3D11_SUBRESOURCE_DATA exposureData = {};
+	exposureData.pSysMem = exposureState;
+
+	D3D11_BUFFER_DESC exposureDesc = {};
+	exposureDesc.ByteWidth = sizeof(exposureState);
+	exposureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	exposureDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	exposureDesc.StructureByteStride = sizeof(float);
+	exposureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> exposureBuffer;
+	device->CreateBuffer(&exposureDesc, &exposureData, exposureBuffer.GetAddressOf());
+	device->CreateShaderResourceView(exposureBuffer.Get(), 0, exposureSRV.GetAddressOf());
+	device->CreateUnorderedAccessView(exposureBuffer.Get(), 0, exposureUAV.GetAddressOf());
+
+	exposureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	exposureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> fixedExposureBuffer;
+	device->CreateBuffer(&exposureDesc, &exposureData, fixedExposureBuffer.GetAddressOf());
+	device->CreateShaderResourceView(fixedExposureBuffer.Get(), 0, fixedExposureSRV.GetAddressOf());
+
 	// Skybox
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skyboxSRV = CreateCubemap(
-		GetFullPathTo_Wide(L"../../assets/textures/skybox/right.png").c_str(),
-		GetFullPathTo_Wide(L"../../assets/textures/skybox/left.png").c_str(),
-		GetFullPathTo_Wide(L"../../assets/textures/skybox/up.png").c_str(),
-		GetFullPathTo_Wide(L"../../assets/textures/skybox/down.png").c_str(),
-		GetFullPathTo_Wide(L"../../assets/textures/skybox/front.png").c_str(),
-		GetFullPathTo_Wide(L"../../assets/textures/skybox/back.png").c_str()
-	);
+	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
+	ImageData skyboxFaces[6];
+	for (int i = 0; i < 6; i++)
+		skyboxFaces[i] = skyboxFaceData[i].get();
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skyboxSRV = AssetLoader::CreateCubemap(device, skyboxFaces);
 	sky = std::make_shared<Sky>(cube, skyboxSRV, skyVertexShader, skyPixelShader, samplerState, device);
 
 	ambientColor = XMFLOAT3(0.0f, 0.0f, 0.0f);
@@ -98,19 +849,14 @@ void Game::Init()
 		});
 
 	// Textures
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipAlbedoSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../assets/textures/starship_albedo.png").c_str(), nullptr, starshipAlbedoSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipEmissiveSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../assets/textures/starship_emissive.png").c_str(), nullptr, starshipEmissiveSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipRoughSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../assets/textures/starship_roughness.png").c_str(), nullptr, starshipRoughSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipMetalSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../assets/textures/starship_metallic.png").c_str(), nullptr, starshipMetalSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipNormalSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../assets/textures/starship_normal.png").c_str(), nullptr, starshipNormalSRV.GetAddressOf());
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipAlbedoSRV = AssetLoader::CreateTexture(device, context, starshipAlbedoData.get());
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipEmissiveSRV = AssetLoader::CreateTexture(device, context, starshipEmissiveData.get());
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipRoughSRV = AssetLoader::CreateTexture(device, context, starshipRoughData.get());
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipMetalSRV = AssetLoader::CreateTexture(device, context, starshipMetalData.get());
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> starshipNormalSRV = AssetLoader::CreateTexture(device, context, starshipNormalData.get());
 
 	// Materials
-	matStarship = std::make_shared<Material>(vertexShader, pixelShader, XMFLOAT4(1, 1, 1, 1), DirectX::XMFLOAT2(1, 1), DirectX::XMFLOAT2(0, 0));
+	matStarship = std::make_shared<Material>(instancedVertexShader, pixelShader, XMFLOAT4(1, 1, 1, 1), DirectX::XMFLOAT2(1, 1), DirectX::XMFLOAT2(0, 0));
 	matStarship->AddTextureSRV(std::string("AlbedoMap"), starshipAlbedoSRV);
 	matStarship->AddTextureSRV(std::string("EmissiveMap"), starshipEmissiveSRV);
 	matStarship->AddTextureSRV(std::string("RoughMap"), starshipRoughSRV);
@@ -119,15 +865,34 @@ void Game::Init()
 	matStarship->AddSampler(std::string("BasicSampler"), samplerState);
 
 	// Game Entities
-	gameEntities = std::vector<std::shared_ptr<GameEntity>>();
-	gameEntities.push_back(std::make_shared<GameEntity>(GameEntity(shuttle.get(), matStarship, XMFLOAT3(0.0f, 0.0f, 0.0f))));
+	commandList = std::make_shared<DeviceCommandList>(device, context, &entities);
 
-	ResizeAllPostProcessResources();
+	EntityID starship = entities.Create(shuttle.get(), matStarship.get(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+	entities.SetLocalBounds(entities.GetIndex(starship), shuttle->GetBounds());
+
+	renderTargets = std::make_shared<DeviceRenderTargetPool>(device);
+	frameGraph = std::make_shared<DeviceFrameGraph>(context, renderTargets.get());
 	
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
 	// Essentially: "What kind of shape should the GPU draw with our data?"
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	QueryPerformanceCounter(&endTime);
+	printf("Init: %.2f ms with %u asset loading workers\n",
+		(double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / frequency.QuadPart,
+		assetLoader.GetWorkerCount());
+
+	if (gpuChecks)
+	{
+		CheckComputeBloom(device, context, bloomDownsampleCS, ppSampler, fixedExposureSRV);
+		CheckBloomEarlyOut(device, context, sceneMaxCS);
+		CheckBloomCombine(device, context, fullscreenVS, bloomCombinePS, ppSampler, fixedExposureSRV);
+		CheckAutoExposure(device, context, autoExposureCS);
+		CheckShaderArchive(device, context, pixelShaderArchive);
+	}
+#endif
 }
 
 // --------------------------------------------------------
@@ -141,233 +906,530 @@ void Game::Init()
 void Game::LoadShaders()
 {
 	vertexShader = std::make_shared<SimpleVertexShader>(device, context, GetFullPathTo_Wide(L"VertexShader.cso").c_str());
-	pixelShader = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"PixelShader.cso").c_str());
+
+	// Same vertex layout (instance data comes from a structured
+	// buffer), flagged so entities using it are drawn instanced
+	instancedVertexShader = std::make_shared<SimpleVertexShader>(device, context, GetFullPathTo_Wide(L"InstancedVertexShader.cso").c_str(), vertexShader->GetInputLayout(), true);
+
+	// The full featured permutation is what every material uses
+	// for now.  The archive is built next to the .exe by the
+	// ShaderPacker build step; PixelShader.cso (the same thing)
+	// stands in if it's missing.
+	pixelShaderArchive.Load(GetFullPathTo("PixelShader.shaderpack").c_str());
+	pixelShader = GetPixelShader(ShaderPermutations::GetPermutation(PIXEL_SHADER_ALL_FEATURES, LIGHT_COUNT_CLUSTERED));
+	if (!pixelShader)
+		pixelShader = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"PixelShader.cso").c_str());
+
 	skyVertexShader = std::make_shared<SimpleVertexShader>(device, context, GetFullPathTo_Wide(L"SkyVertexShader.cso").c_str());
 	skyPixelShader = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"SkyPixelShader.cso").c_str());
 	fullscreenVS = std::make_shared<SimpleVertexShader>(device, context, GetFullPathTo_Wide(L"FullscreenVS.cso").c_str());
 	gaussianBlurPS = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"GaussianBlurPS.cso").c_str());
 	bloomExtractPS = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"BloomExtractPS.cso").c_str());
 	bloomCombinePS = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"BloomCombinePS.cso").c_str());
+	bloomDownsampleCS = std::make_shared<SimpleComputeShader>(device, context, GetFullPathTo_Wide(L"BloomDownsampleCS.cso").c_str());
+	sceneMaxCS = std::make_shared<SimpleComputeShader>(device, context, GetFullPathTo_Wide(L"SceneMaxCS.cso").c_str());
+	autoExposureCS = std::make_shared<SimpleComputeShader>(device, context, GetFullPathTo_Wide(L"AutoExposureCS.cso").c_str());
 }
 
+// --------------------------------------------------------
+// A permutation of PixelShader.hlsl, created from the archive
+// the first time it's asked for: one index probe (usually)
+// and a CreatePixelShader().  Null if the archive doesn't
+// have it.
+// --------------------------------------------------------
+std::shared_ptr<SimplePixelShader> Game::GetPixelShader(unsigned int permutation)
+{
+	std::shared_ptr<SimplePixelShader>& shader = pixelShaderPermutations[permutation];
+	if (!shader)
+	{
+		unsigned int size = 0;
+		const void* bytecode = pixelShaderArchive.Find(ShaderPermutations::GetKey(permutation), size);
+		if (bytecode)
+			shader = std::make_shared<SimplePixelShader>(device, context, bytecode, size);
+	}
+	return shader;
+}
 
-void Game::LoadMeshes()
+// --------------------------------------------------------
+// Decodes every mesh on the asset loader's workers, then
+// creates their buffers here as each one finishes
+// --------------------------------------------------------
+void Game::LoadMeshes(AssetLoader& assetLoader)
 {
-	cube = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/cube.obj").c_str(), device, context);
-	cylinder = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/cylinder.obj").c_str(), device, context);
-	helix = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/helix.obj").c_str(), device, context);
-	quad = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/quad.obj").c_str(), device, context);
-	quadDoubleSided = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/quad_double_sided.obj").c_str(), device, context);
-	sphere = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/sphere.obj").c_str(), device, context);
-	torus = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/torus.obj").c_str(), device, context);
-	shuttle = std::make_shared<Mesh>(GetFullPathTo("../../assets/meshes/starship.obj").c_str(), device, context);
+	std::future<MeshData> cubeData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/cube.obj"));
+	std::future<MeshData> cylinderData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/cylinder.obj"));
+	std::future<MeshData> helixData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/helix.obj"));
+	std::future<MeshData> quadData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/quad.obj"));
+	std::future<MeshData> quadDoubleSidedData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/quad_double_sided.obj"));
+	std::future<MeshData> sphereData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/sphere.obj"));
+	std::future<MeshData> torusData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/torus.obj"));
+	std::future<MeshData> shuttleData = assetLoader.LoadMeshData(GetFullPathTo("../../assets/meshes/starship.obj"));
+
+	cube = std::make_shared<Mesh>(cubeData.get(), device, context);
+	cylinder = std::make_shared<Mesh>(cylinderData.get(), device, context);
+	helix = std::make_shared<Mesh>(helixData.get(), device, context);
+	quad = std::make_shared<Mesh>(quadData.get(), device, context);
+	quadDoubleSided = std::make_shared<Mesh>(quadDoubleSidedData.get(), device, context);
+	sphere = std::make_shared<Mesh>(sphereData.get(), device, context);
+	torus = std::make_shared<Mesh>(torusData.get(), device, context);
+	shuttle = std::make_shared<Mesh>(shuttleData.get(), device, context);
 }
 
-void Game::ResizeAllPostProcessResources()
+// --------------------------------------------------------
+// Clears the back buffer, depth buffer and scene target.
+// Any of them overwritten before they're read (like the back
+// buffer, which BloomCombine covers) is culled by the frame
+// graph.
+// --------------------------------------------------------
+void Game::AddClearPasses(unsigned int backBuffer, unsigned int depthBuffer, unsigned int scene)
 {
-	ResizeOnePostProcessResource(ppRTV, ppSRV, 1.0f, DXGI_FORMAT_R16G16B16A16_FLOAT);
-	ResizeOnePostProcessResource(bloomExtractRTV, bloomExtractSRV, 0.5f, DXGI_FORMAT_R16G16B16A16_FLOAT);
+	// Background color (Cornflower Blue in this case) for clearing
+	const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
 
-	float rtScale = 0.5f;
-	for (int i = 0; i < MaxBloomLevels; i++)
+	unsigned int pass = frameGraph->AddPass("Clear back buffer", [this, color]()
 	{
-		ResizeOnePostProcessResource(blurHorizontalRTV[i], blurHorizontalSRV[i], rtScale, DXGI_FORMAT_R16G16B16A16_FLOAT);
-		ResizeOnePostProcessResource(blurVerticalRTV[i], blurVerticalSRV[i], rtScale, DXGI_FORMAT_R16G16B16A16_FLOAT);
+		context->ClearRenderTargetView(backBufferRTV.Get(), color);
+	});
+	frameGraph->Write(pass, backBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
 
-		rtScale *= 0.5f;
+	pass = frameGraph->AddPass("Clear depth buffer", [this]()
+	{
+		context->ClearDepthStencilView(depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	});
+	frameGraph->Write(pass, depthBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+
+	pass = frameGraph->AddPass("Clear scene", [this, color, scene]()
+	{
+		context->ClearRenderTargetView(frameGraph->GetRenderTargetView(scene).Get(), color);
+	});
+	frameGraph->Write(pass, scene, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+}
+
+// --------------------------------------------------------
+// The entities, then the sky behind them, into the HDR scene
+// target
+// --------------------------------------------------------
+void Game::AddScenePasses(unsigned int scene, unsigned int depthBuffer)
+{
+	unsigned int pass = frameGraph->AddPass("Scene", [this, scene]()
+	{
+		D3D11_VIEWPORT vp = {};
+		vp.Width = (float)width;
+		vp.Height = (float)height;
+		vp.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &vp);
+
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> sceneRTV = frameGraph->GetRenderTargetView(scene);
+		context->OMSetRenderTargets(1, sceneRTV.GetAddressOf(), depthStencilView.Get());
+		DrawScene();
+	});
+	frameGraph->Write(pass, scene, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_PRESERVE);
+	frameGraph->Write(pass, depthBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_PRESERVE);
+
+	pass = frameGraph->AddPass("Sky", [this, scene]()
+	{
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> sceneRTV = frameGraph->GetRenderTargetView(scene);
+		context->OMSetRenderTargets(1, sceneRTV.GetAddressOf(), depthStencilView.Get());
+		sky->Draw(context, camera);
+	});
+	frameGraph->Write(pass, scene, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_PRESERVE);
+	frameGraph->Write(pass, depthBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_PRESERVE);
+}
+
+// --------------------------------------------------------
+// Adapts the exposure to the scene with one AutoExposureCS
+// dispatch.  The state buffer is imported, so the pass is
+// never culled, and every pass using the exposure reads it
+// straight from there.
+// --------------------------------------------------------
+void Game::AddAutoExposurePass(unsigned int scene, unsigned int exposureState, float deltaTime)
+{
+	unsigned int pass = frameGraph->AddPass("Auto exposure", [this, scene, deltaTime]()
+	{
+		unsigned int sampleStep = AutoExposure::GetSampleStep(width, height);
+		unsigned int sampleCount[2] = { width / sampleStep, height / sampleStep };
+		const AutoExposureSettings& settings = autoExposureSettings;
+
+		autoExposureCS->SetShader();
+		autoExposureCS->SetShaderResourceView("source", frameGraph->GetShaderResourceView(scene));
+		autoExposureCS->SetUnorderedAccessView("exposureState", exposureUAV);
+		autoExposureCS->SetData("sampleCount", sampleCount, sizeof(sampleCount));
+		autoExposureCS->SetInt("sampleStep", sampleStep);
+		autoExposureCS->SetFloat("minLog2Luminance", settings.minLog2Luminance);
+		autoExposureCS->SetFloat("maxLog2Luminance", settings.maxLog2Luminance);
+		autoExposureCS->SetFloat("lowPercent", settings.lowPercent);
+		autoExposureCS->SetFloat("highPercent", settings.highPercent);
+		autoExposureCS->SetFloat("key", settings.key);
+		autoExposureCS->SetFloat("minExposure", settings.minExposure);
+		autoExposureCS->SetFloat("maxExposure", settings.maxExposure);
+		autoExposureCS->SetFloat("brightenAdaptation", AutoExposure::GetAdaptation(deltaTime, settings.brightenSpeed));
+		autoExposureCS->SetFloat("darkenAdaptation", AutoExposure::GetAdaptation(deltaTime, settings.darkenSpeed));
+		autoExposureCS->CopyAllBufferData();
+		autoExposureCS->DispatchByGroups(1, 1, 1);
+	});
+	frameGraph->Read(pass, scene, FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE, ShaderResourceSlot(autoExposureCS, "source"));
+	frameGraph->Write(pass, exposureState, FRAME_GRAPH_BIND_UNORDERED_ACCESS, autoExposureCS->GetUnorderedAccessViewIndex("exposureState"), FRAME_GRAPH_WRITE_PRESERVE);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::GetExposureSRV()
+{
+	return autoExposure ? exposureSRV : fixedExposureSRV;
+}
+
+// --------------------------------------------------------
+// Hands bloomEarlyOut the result SceneMaxCS wrote into the
+// staging buffer this frame is about to reuse, if the GPU
+// is done with it.  Results are dropped while skipping is
+// off, since they'd be stale by the time it's back on.
+// --------------------------------------------------------
+void Game::ReadSceneMax()
+{
+	bloomEarlyOut.BeginFrame();
+
+	unsigned int slot = sceneMaxFrame % (BloomEarlyOut::ResultLatency + 1);
+	if (!skipDarkBloom)
+	{
+		for (unsigned int i = 0; i <= BloomEarlyOut::ResultLatency; i++)
+			sceneMaxPending[i] = false;
+		bloomEarlyOut.ForgetResult();
+		return;
 	}
+
+	if (!sceneMaxPending[slot])
+		return;
+	sceneMaxPending[slot] = false;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(sceneMaxStaging[slot].Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped)))
+		return;
+
+	float maxValue = *(const float*)mapped.pData;
+	context->Unmap(sceneMaxStaging[slot].Get(), 0);
+	bloomEarlyOut.SetResult(maxValue);
 }
 
-void Game::ResizeOnePostProcessResource(
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv,
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
-	float renderTargetScale,
-	DXGI_FORMAT format)
+// --------------------------------------------------------
+// Finds the scene's brightest channel with SceneMaxCS and
+// copies it to a staging buffer, for a later frame to read.
+// The result buffer is imported, so the pass is never culled.
+// --------------------------------------------------------
+void Game::AddSceneMaxPass(unsigned int scene, unsigned int exposureState)
 {
-	rtv.Reset();
-	srv.Reset();
+	unsigned int slot = sceneMaxFrame % (BloomEarlyOut::ResultLatency + 1);
+	sceneMaxFrame++;
 
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = (unsigned int)(width * renderTargetScale);
-	textureDesc.Height = (unsigned int)(height * renderTargetScale);
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // Will render to it and sample from it!
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = format;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	unsigned int result = frameGraph->ImportTarget("Scene max", 1, 1, DXGI_FORMAT_R32_UINT);
+	unsigned int pass = frameGraph->AddPass("Scene max", [this, scene, slot]()
+	{
+		const unsigned int zeros[4] = {};
+		context->ClearUnorderedAccessViewUint(sceneMaxUAV.Get(), zeros);
+
+		unsigned int sourceSize[2] = { width, height };
+		sceneMaxCS->SetShader();
+		sceneMaxCS->SetShaderResourceView("source", frameGraph->GetShaderResourceView(scene));
+		sceneMaxCS->SetShaderResourceView("exposureState", GetExposureSRV());
+		sceneMaxCS->SetUnorderedAccessView("sceneMax", sceneMaxUAV);
+		sceneMaxCS->SetData("sourceSize", sourceSize, sizeof(sourceSize));
+		sceneMaxCS->CopyAllBufferData();
+		sceneMaxCS->DispatchByThreads((width + 1) / 2, (height + 1) / 2, 1);
+
+		context->CopyResource(sceneMaxStaging[slot].Get(), sceneMaxBuffer.Get());
+		sceneMaxPending[slot] = true;
+	});
+	frameGraph->Read(pass, scene, FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE, ShaderResourceSlot(sceneMaxCS, "source"));
+	frameGraph->Read(pass, exposureState, FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE, ShaderResourceSlot(sceneMaxCS, "exposureState"));
+	frameGraph->Write(pass, result, FRAME_GRAPH_BIND_UNORDERED_ACCESS, sceneMaxCS->GetUnorderedAccessViewIndex("sceneMax"), FRAME_GRAPH_WRITE_DISCARD);
+}
 
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, ppTexture.GetAddressOf());
+// --------------------------------------------------------
+// An extract pass and two blur passes per level.  The first
+// level's vertical blur gets the extract's texture, since
+// the extract isn't read after the horizontal blur.  The
+// extract and first level are the quality tier's first step
+// smaller than the scene, and every level after is half the
+// one before.
+// --------------------------------------------------------
+void Game::AddPixelShaderBloomPasses(unsigned int scene, unsigned int exposureState, std::vector<unsigned int>& levels)
+{
+	if (bloomLevels == 0)
+		return;
+
+	const BloomTier& tier = BloomFilter::GetTier(bloomQuality);
+	unsigned int extractWidth = BloomFilter::LevelSize(width, tier.firstStep);
+	unsigned int extractHeight = BloomFilter::LevelSize(height, tier.firstStep);
+	unsigned int extract = frameGraph->CreateTarget("Bloom extract", extractWidth, extractHeight, tier.format);
+	unsigned int pass = frameGraph->AddPass("Bloom extract", [this, scene, extract, tier]()
+	{
+		BloomExtract(tier.firstStep, frameGraph->GetRenderTargetView(extract), frameGraph->GetShaderResourceView(scene));
+	});
+	frameGraph->Write(pass, extract, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+	frameGraph->Read(pass, scene, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, ShaderResourceSlot(bloomExtractPS, "pixels"));
+	frameGraph->Read(pass, exposureState, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, ShaderResourceSlot(bloomExtractPS, "exposureState"));
+
+	unsigned int blurSlot = ShaderResourceSlot(gaussianBlurPS, "pixels");
+	unsigned int source = extract;
+	unsigned int levelWidth = extractWidth;
+	unsigned int levelHeight = extractHeight;
+	for (int i = 0; i < bloomLevels; i++)
+	{
+		if (i > 0)
+		{
+			levelWidth = BloomFilter::LevelSize(levelWidth, 2);
+			levelHeight = BloomFilter::LevelSize(levelHeight, 2);
+		}
+
+		std::string name = "Bloom level " + std::to_string(i);
+		unsigned int horizontal = frameGraph->CreateTarget(name + " horizontal", levelWidth, levelHeight, tier.format);
+		unsigned int level = frameGraph->CreateTarget(name, levelWidth, levelHeight, tier.format);
 
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+		pass = frameGraph->AddPass(name + " horizontal blur", [this, i, levelWidth, levelHeight, source, horizontal]()
+		{
+			SingleDirectionBlur(levelWidth, levelHeight, XMFLOAT2(1, 0), bloomKernels[i], frameGraph->GetRenderTargetView(horizontal), frameGraph->GetShaderResourceView(source));
+		});
+		frameGraph->Write(pass, horizontal, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+		frameGraph->Read(pass, source, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, blurSlot);
+
+		pass = frameGraph->AddPass(name + " vertical blur", [this, i, levelWidth, levelHeight, horizontal, level]()
+		{
+			SingleDirectionBlur(levelWidth, levelHeight, XMFLOAT2(0, 1), bloomKernels[i], frameGraph->GetRenderTargetView(level), frameGraph->GetShaderResourceView(horizontal));
+		});
+		frameGraph->Write(pass, level, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+		frameGraph->Read(pass, horizontal, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, blurSlot);
 
-	device->CreateRenderTargetView(ppTexture.Get(), &rtvDesc, rtv.ReleaseAndGetAddressOf());
+		levels.push_back(level);
+		source = level;
+	}
+}
 
-	device->CreateShaderResourceView(ppTexture.Get(), 0, srv.ReleaseAndGetAddressOf());
+// --------------------------------------------------------
+// One BloomDownsampleCS dispatch per level, each reading the
+// level before.  The first steps down from the scene by the
+// quality tier's first step, and the rest halve.
+// --------------------------------------------------------
+void Game::AddComputeBloomPasses(unsigned int scene, unsigned int exposureState, std::vector<unsigned int>& levels)
+{
+	const BloomTier& tier = BloomFilter::GetTier(bloomQuality);
+	unsigned int sourceSlot = ShaderResourceSlot(bloomDownsampleCS, "source");
+	unsigned int exposureSlot = ShaderResourceSlot(bloomDownsampleCS, "exposureState");
+	unsigned int targetSlot = bloomDownsampleCS->GetUnorderedAccessViewIndex("target");
+
+	unsigned int source = scene;
+	unsigned int sourceWidth = width;
+	unsigned int sourceHeight = height;
+	unsigned int sourceStep = tier.firstStep;
+	for (int i = 0; i < bloomLevels; i++)
+	{
+		std::string name = "Bloom level " + std::to_string(i);
+		unsigned int levelWidth = BloomFilter::LevelSize(sourceWidth, sourceStep);
+		unsigned int levelHeight = BloomFilter::LevelSize(sourceHeight, sourceStep);
+		unsigned int level = frameGraph->CreateTarget(name, levelWidth, levelHeight, tier.format);
+
+		unsigned int pass = frameGraph->AddPass(name, [this, i, source, sourceWidth, sourceHeight, sourceStep, level]()
+		{
+			DispatchBloomLevel(bloomDownsampleCS, ppSampler, frameGraph->GetShaderResourceView(source), GetExposureSRV(), sourceWidth, sourceHeight, sourceStep,
+				frameGraph->GetUnorderedAccessView(level),
+				i == 0 ? bloomThreshold / exposure : 0.0f, bloomKernels[i].GetWeights(), bloomKernels[i].GetRadius());
+		});
+		frameGraph->Read(pass, source, FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE, sourceSlot);
+		frameGraph->Read(pass, exposureState, FRAME_GRAPH_BIND_COMPUTE_SHADER_RESOURCE, exposureSlot);
+		frameGraph->Write(pass, level, FRAME_GRAPH_BIND_UNORDERED_ACCESS, targetSlot, FRAME_GRAPH_WRITE_DISCARD);
+
+		levels.push_back(level);
+		source = level;
+		sourceWidth = levelWidth;
+		sourceHeight = levelHeight;
+		sourceStep = 2;
+	}
+}
+
+void Game::AddBloomCombinePass(unsigned int scene, unsigned int exposureState, const std::vector<unsigned int>& levels, unsigned int backBuffer)
+{
+	unsigned int pass = frameGraph->AddPass("Bloom combine", [this, scene, levels]()
+	{
+		BloomCombine(scene, levels);
+	});
+	frameGraph->Write(pass, backBuffer, FRAME_GRAPH_BIND_RENDER_TARGETS, 0, FRAME_GRAPH_WRITE_DISCARD);
+	frameGraph->Read(pass, scene, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, ShaderResourceSlot(bloomCombinePS, "originalPixels"));
+	frameGraph->Read(pass, exposureState, FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, ShaderResourceSlot(bloomCombinePS, "exposureState"));
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		std::string name = "bloomedPixels" + std::to_string(i);
+		frameGraph->Read(pass, levels[i], FRAME_GRAPH_BIND_PIXEL_SHADER_RESOURCE, ShaderResourceSlot(bloomCombinePS, name));
+	}
 }
 
-void Game::BloomExtract()
+// --------------------------------------------------------
+// Culls the entities, sorts what's left by state and draws
+// it, into whatever targets are bound
+// --------------------------------------------------------
+void Game::DrawScene()
 {
+	// Ensure the pipeline knows how to interpret the data (numbers)
+	// from the vertex buffer.  
+	// - If all of your 3D models use the exact same vertex layout,
+	//    this could simply be done once in Init()
+	// - However, this isn't always the case (but might be for this course)
+	context->IASetInputLayout(inputLayout.Get());
+
+	// Draw the entities that are in view
+	XMFLOAT4 frustumPlanes[6];
+	camera->GetFrustumPlanes(frustumPlanes);
+
+	entities.UpdateWorldMatrices();
+	entities.BuildDrawList(drawList, frustumPlanes);
+
+	// Sorted by state, then front to back, so shared state is
+	// only set once and nearer objects can hide farther ones
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	renderQueue.Clear();
+	for (unsigned int i = 0; i < drawList.size(); i++)
+	{
+		const DrawItem& item = drawList[i];
+		const XMFLOAT4X4& world = entities.GetWorldMatrix(item.entityIndex);
+		float viewDepth = world._41 * view._13 + world._42 * view._23 + world._43 * view._33 + view._43;
+
+		SimpleVertexShader* vs = item.material->GetVertexShader().get();
+		SimplePixelShader* ps = item.material->GetPixelShader().get();
+		RenderSortIDs sortIDs = { vs->GetID(), ps->GetID(), item.material->GetID(), item.mesh->GetID() };
+		renderQueue.Add(
+			RENDER_PASS_OPAQUE,
+			vs,
+			ps,
+			item.material,
+			item.mesh,
+			sortIDs,
+			viewDepth,
+			item.entityIndex);
+	}
+	renderQueue.Sort();
+
+	// Each pixel only shades the lights that can reach it
+	lightClusters.Build(view, camera->GetProjectionMatrix(), lights.empty() ? 0 : &lights[0], (unsigned int)lights.size());
+	commandList->BeginFrame(camera, lights, lightClusters, ambientColor);
+	renderQueue.Submit(*commandList);
+	commandList->EndFrame();
+}
+
+// --------------------------------------------------------
+// State every fullscreen post processing pass shares:
+// FullscreenVS's generated triangle, the clamp sampler and a
+// viewport the size of the target
+// --------------------------------------------------------
+void Game::SetUpFullscreenPass(float targetWidth, float targetHeight)
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	ID3D11Buffer* nothing = 0;
+	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+
+	fullscreenVS->SetShader();
+	context->PSSetSamplers(0, 1, ppSampler.GetAddressOf());
+
 	D3D11_VIEWPORT vp = {};
-	vp.Width = width * 0.5f;
-	vp.Height = height * 0.5f;
+	vp.Width = targetWidth;
+	vp.Height = targetHeight;
 	vp.MaxDepth = 1.0f;
 	context->RSSetViewports(1, &vp);
+}
 
-	context->OMSetRenderTargets(1, bloomExtractRTV.GetAddressOf(), 0);
+// --------------------------------------------------------
+// Thresholds the scene into a target 1 / sourceStep of its
+// size (2 or 4)
+// --------------------------------------------------------
+void Game::BloomExtract(unsigned int sourceStep, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> target, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> source)
+{
+	SetUpFullscreenPass((float)BloomFilter::LevelSize(width, sourceStep), (float)BloomFilter::LevelSize(height, sourceStep));
+
+	context->OMSetRenderTargets(1, target.GetAddressOf(), 0);
 
 	bloomExtractPS->SetShader();
-	bloomExtractPS->SetShaderResourceView("pixels", ppSRV.Get());
-	bloomExtractPS->SetFloat("bloomThreshold", bloomThreshold);
+	bloomExtractPS->SetShaderResourceView("pixels", source.Get());
+	bloomExtractPS->SetShaderResourceView("exposureState", GetExposureSRV().Get());
+	bloomExtractPS->SetFloat("bloomThreshold", bloomThreshold / exposure);
+	bloomExtractPS->SetInt("sourceStep", sourceStep);
+	bloomExtractPS->SetFloat2("sourceTexelSize", XMFLOAT2(1.0f / width, 1.0f / height));
 	bloomExtractPS->CopyAllBufferData();
 
 	context->Draw(3, 0);
 }
 
-void Game::SingleDirectionBlur(float renderTargetScale, DirectX::XMFLOAT2 blurDirection, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> target, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sourceTexture)
+// --------------------------------------------------------
+// Keeps bloomLevels in range and rebuilds the kernel of
+// any level whose sigma (scaled for the quality tier) has
+// changed
+// --------------------------------------------------------
+void Game::UpdateBloomKernels()
 {
-	D3D11_VIEWPORT vp = {};
-	vp.Width = width * renderTargetScale;
-	vp.Height = height * renderTargetScale;
-	vp.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &vp);
+	if (bloomLevels < 0)
+		bloomLevels = 0;
+	if (bloomLevels > MaxBloomLevels)
+		bloomLevels = MaxBloomLevels;
+
+	float sigmaScale = BloomFilter::GetTier(bloomQuality).sigmaScale;
+	for (int i = 0; i < bloomLevels; i++)
+	{
+		float sigma = bloomLevelSigmas[i] * sigmaScale;
+		if (bloomKernels[i].GetSigma() != sigma)
+			bloomKernels[i] = GaussianKernel(sigma);
+	}
+}
+
+void Game::SingleDirectionBlur(unsigned int targetWidth, unsigned int targetHeight, DirectX::XMFLOAT2 blurDirection, GaussianKernel& kernel, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> target, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sourceTexture)
+{
+	SetUpFullscreenPass((float)targetWidth, (float)targetHeight);
 
 	context->OMSetRenderTargets(1, target.GetAddressOf(), 0);
 
 	gaussianBlurPS->SetShader();
 	gaussianBlurPS->SetShaderResourceView("pixels", sourceTexture.Get());
-	gaussianBlurPS->SetFloat2("pixelUVSize", XMFLOAT2(1.0f / (width * renderTargetScale), 1.0f / (height * renderTargetScale)));
+	gaussianBlurPS->SetFloat2("pixelUVSize", XMFLOAT2(1.0f / targetWidth, 1.0f / targetHeight));
 	gaussianBlurPS->SetFloat2("blurDirection", blurDirection);
+
+	// Array elements in a cbuffer take 16 bytes each
+	XMFLOAT4 taps[GaussianKernel::MaxTaps] = {};
+	for (int i = 0; i < kernel.GetTapCount(); i++)
+		taps[i] = XMFLOAT4(kernel.GetTapWeights()[i], kernel.GetTapOffsets()[i], 0, 0);
+	gaussianBlurPS->SetInt("tapCount", kernel.GetTapCount());
+	gaussianBlurPS->SetData("taps", taps, sizeof(taps));
 	gaussianBlurPS->CopyAllBufferData();
 
 	context->Draw(3, 0);
 }
 
-void Game::BloomCombine()
+void Game::BloomCombine(unsigned int scene, const std::vector<unsigned int>& levels)
 {
-	D3D11_VIEWPORT vp = {};
-	vp.Width = (float)width;
-	vp.Height = (float)height;
-	vp.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &vp);
+	SetUpFullscreenPass((float)width, (float)height);
 
 	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), 0);
 
 	bloomCombinePS->SetShader();
-	bloomCombinePS->SetShaderResourceView("originalPixels", ppSRV.Get());
-	bloomCombinePS->SetShaderResourceView("bloomedPixels0", blurVerticalSRV[0].Get());
-	bloomCombinePS->SetShaderResourceView("bloomedPixels1", blurVerticalSRV[1].Get());
-	bloomCombinePS->SetShaderResourceView("bloomedPixels2", blurVerticalSRV[2].Get());
-	bloomCombinePS->SetShaderResourceView("bloomedPixels3", blurVerticalSRV[3].Get());
-	bloomCombinePS->SetShaderResourceView("bloomedPixels4", blurVerticalSRV[4].Get());
-
-	bloomCombinePS->SetFloat("intensityLevel0", bloomLevelIntensities[0]);
-	bloomCombinePS->SetFloat("intensityLevel1", bloomLevelIntensities[1]);
-	bloomCombinePS->SetFloat("intensityLevel2", bloomLevelIntensities[2]);
-	bloomCombinePS->SetFloat("intensityLevel3", bloomLevelIntensities[3]);
-	bloomCombinePS->SetFloat("intensityLevel4", bloomLevelIntensities[4]);
-	bloomCombinePS->CopyAllBufferData();
 
-	context->Draw(3, 0);
-}
-
-// --------------------------------------------------------
-// Loads six individual textures (the six faces of a cube map), then
-// creates a blank cube map and copies each of the six textures to
-// another face.  Afterwards, creates a shader resource view for
-// the cube map and cleans up all of the temporary resources.
-// --------------------------------------------------------
-Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::CreateCubemap(
-	const wchar_t* right,
-	const wchar_t* left,
-	const wchar_t* up,
-	const wchar_t* down,
-	const wchar_t* front,
-	const wchar_t* back)
-{
-	// Load the 6 textures into an array.
-	// - We need references to the TEXTURES, not the SHADER RESOURCE VIEWS!
-	// - Specifically NOT generating mipmaps, as we usually don't need them for the sky!
-	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
-	ID3D11Texture2D* textures[6] = {};
-	CreateWICTextureFromFile(device.Get(), right, (ID3D11Resource**)&textures[0], 0);
-	CreateWICTextureFromFile(device.Get(), left, (ID3D11Resource**)&textures[1], 0);
-	CreateWICTextureFromFile(device.Get(), up, (ID3D11Resource**)&textures[2], 0);
-	CreateWICTextureFromFile(device.Get(), down, (ID3D11Resource**)&textures[3], 0);
-	CreateWICTextureFromFile(device.Get(), front, (ID3D11Resource**)&textures[4], 0);
-	CreateWICTextureFromFile(device.Get(), back, (ID3D11Resource**)&textures[5], 0);
-
-	// We'll assume all of the textures are the same color format and resolution,
-	// so get the description of the first shader resource view
-	D3D11_TEXTURE2D_DESC faceDesc = {};
-	textures[0]->GetDesc(&faceDesc);
-
-	// Describe the resource for the cube map, which is simply 
-	// a "texture 2d array".  This is a special GPU resource format, 
-	// NOT just a C++ array of textures!!!
-	D3D11_TEXTURE2D_DESC cubeDesc = {};
-	cubeDesc.ArraySize = 6; // Cube map!
-	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE; // We'll be using as a texture in a shader
-	cubeDesc.CPUAccessFlags = 0; // No read back
-	cubeDesc.Format = faceDesc.Format; // Match the loaded texture's color format
-	cubeDesc.Width = faceDesc.Width;  // Match the size
-	cubeDesc.Height = faceDesc.Height; // Match the size
-	cubeDesc.MipLevels = 1; // Only need 1
-	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // A CUBE MAP, not 6 separate textures
-	cubeDesc.Usage = D3D11_USAGE_DEFAULT; // Standard usage
-	cubeDesc.SampleDesc.Count = 1;
-	cubeDesc.SampleDesc.Quality = 0;
-
-	// Create the actual texture resource
-	ID3D11Texture2D* cubeMapTexture = 0;
-	device->CreateTexture2D(&cubeDesc, 0, &cubeMapTexture);
-
-	// Loop through the individual face textures and copy them,
-	// one at a time, to the cube map texure
-	for (int i = 0; i < 6; i++)
+	// Levels past bloomLevels weren't drawn this frame, and
+	// have no target.  Array elements in a cbuffer take 16
+	// bytes each.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> levelSRVs[MaxBloomLevels];
+	XMFLOAT4 intensities[MaxBloomLevels] = {};
+	for (size_t i = 0; i < levels.size(); i++)
 	{
-		// Calculate the subresource position to copy into
-		unsigned int subresource = D3D11CalcSubresource(
-			0,	// Which mip (zero, since there's only one)
-			i,	// Which array element?
-			1); 	// How many mip levels are in the texture?
-
-		// Copy from one resource (texture) to another
-		context->CopySubresourceRegion(
-			cubeMapTexture, // Destination resource
-			subresource,	// Dest subresource index (one of the array elements)
-			0, 0, 0,		// XYZ location of copy
-			textures[i],	// Source resource
-			0,	// Source subresource index (we're assuming there's only one)
-			0);	// Source subresource "box" of data to copy (zero means the whole thing)
+		levelSRVs[i] = frameGraph->GetShaderResourceView(levels[i]);
+		intensities[i].x = bloomLevelIntensities[i];
 	}
 
-	// At this point, all of the faces have been copied into the 
-	// cube map texture, so we can describe a shader resource view for it
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = cubeDesc.Format; 	// Same format as texture
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
-	srvDesc.TextureCube.MipLevels = 1;	// Only need access to 1 mip
-	srvDesc.TextureCube.MostDetailedMip = 0; // Index of the first mip we want to see
-
-	// Make the SRV
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
-	device->CreateShaderResourceView(cubeMapTexture, &srvDesc, cubeSRV.GetAddressOf());
-
-	// Now that we're done, clean up the stuff we don't need anymore
-	cubeMapTexture->Release();  // Done with this particular reference (the SRV has another)
-	for (int i = 0; i < 6; i++)
-		textures[i]->Release();
+	bloomCombinePS->SetShaderResourceView("originalPixels", frameGraph->GetShaderResourceView(scene).Get());
+	bloomCombinePS->SetShaderResourceView("bloomedPixels0", levelSRVs[0].Get());
+	bloomCombinePS->SetShaderResourceView("bloomedPixels1", levelSRVs[1].Get());
+	bloomCombinePS->SetShaderResourceView("bloomedPixels2", levelSRVs[2].Get());
+	bloomCombinePS->SetShaderResourceView("bloomedPixels3", levelSRVs[3].Get());
+	bloomCombinePS->SetShaderResourceView("bloomedPixels4", levelSRVs[4].Get());
+	bloomCombinePS->SetShaderResourceView("exposureState", GetExposureSRV().Get());
+
+	bloomCombinePS->SetData("intensities", intensities, sizeof(intensities));
+	bloomCombinePS->SetFloat("exposure", exposure);
+	bloomCombinePS->SetInt("tonemapper", tonemapper);
+	bloomCombinePS->CopyAllBufferData();
 
-	// Send back the SRV, which is what we need for our shaders
-	return cubeSRV;
+	context->Draw(3, 0);
 }
 
 // --------------------------------------------------------
@@ -379,6 +1441,10 @@ void Game::OnResize()
 	camera->UpdateProjectionMatrix((float)this->width / this->height);
 	// Handle base-level DX resize stuff
 	DXCore::OnResize();
+
+	// No post processing target will match the new size
+	if (renderTargets)
+		renderTargets->DestroyFreeTargets();
 }
 
 // --------------------------------------------------------
@@ -392,9 +1458,9 @@ void Game::Update(float deltaTime, float totalTime)
 
 	camera->Update(deltaTime);
 
-	for (std::shared_ptr<GameEntity> ge : gameEntities)
+	for (unsigned int i = 0; i < entities.GetCount(); i++)
 	{
-		ge->GetTransform()->Rotate(-0.01 * deltaTime, 0, -0.005 * deltaTime);
+		entities.Rotate(i, -0.01f * deltaTime, 0, -0.005f * deltaTime);
 	}
 }
 
@@ -403,79 +1469,43 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
-	// Background color (Cornflower Blue in this case) for clearing
-	const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
-
-	// Clear the render target and depth buffer (erases what's on the screen)
-	//  - Do this ONCE PER FRAME
-	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV.Get(), color);
-	context->ClearDepthStencilView(
-		depthStencilView.Get(),
-		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
-		1.0f,
-		0);
-
-	{
-		context->ClearRenderTargetView(ppRTV.Get(), color);
-		context->ClearRenderTargetView(bloomExtractRTV.Get(), color);
-
-		for (int i = 0; i < MaxBloomLevels; i++) {
-			context->ClearRenderTargetView(blurHorizontalRTV[i].Get(), color);
-			context->ClearRenderTargetView(blurVerticalRTV[i].Get(), color);
-		}
-
-		context->OMSetRenderTargets(1, ppRTV.GetAddressOf(), depthStencilView.Get());
-	}
-
-
-	// Ensure the pipeline knows how to interpret the data (numbers)
-	// from the vertex buffer.  
-	// - If all of your 3D models use the exact same vertex layout,
-	//    this could simply be done once in Init()
-	// - However, this isn't always the case (but might be for this course)
-	context->IASetInputLayout(inputLayout.Get());
-
-	// Draw the entity
-	for (std::shared_ptr<GameEntity> ge : gameEntities)
+	// Every pass declares what it reads and writes, and the
+	// frame graph culls the ones nothing needs, hands out
+	// post processing targets from the pool for just as long
+	// as they're used, and unbinds views before they conflict
+	renderTargets->BeginFrame();
+	frameGraph->Reset();
+
+	unsigned int backBuffer = frameGraph->ImportTarget("Back buffer", width, height, DXGI_FORMAT_R8G8B8A8_UNORM);
+	unsigned int depthBuffer = frameGraph->ImportTarget("Depth buffer", width, height, DXGI_FORMAT_D24_UNORM_S8_UINT);
+	unsigned int scene = frameGraph->CreateTarget("Scene", width, height, DXGI_FORMAT_R16G16B16A16_FLOAT);
+	unsigned int exposureState = frameGraph->ImportTarget("Exposure", 2, 1, DXGI_FORMAT_R32_FLOAT);
+
+	AddClearPasses(backBuffer, depthBuffer, scene);
+	AddScenePasses(scene, depthBuffer);
+	if (autoExposure)
+		AddAutoExposurePass(scene, exposureState, deltaTime);
+
+	// Without any levels, the combine pass just tonemaps the
+	// scene into the back buffer.  SceneMaxCS's results are
+	// already exposed, so only the manual exposure is left.
+	UpdateBloomKernels();
+	ReadSceneMax();
+	if (skipDarkBloom)
+		AddSceneMaxPass(scene, exposureState);
+
+	std::vector<unsigned int> bloomLevelTargets;
+	if (!skipDarkBloom || bloomEarlyOut.IsBloomNeeded(bloomThreshold / exposure))
 	{
-		ge->GetMaterial()->GetPixelShader()->SetData("lights", &lights[0], (sizeof(Light) * (int)lights.size()));
-		ge->GetMaterial()->GetPixelShader()->SetInt("lightCount", (int)lights.size());
-		ge->GetMaterial()->GetPixelShader()->SetFloat3("ambient", ambientColor);
-		ge->Draw(camera);
+		if (computeBloom)
+			AddComputeBloomPasses(scene, exposureState, bloomLevelTargets);
+		else
+			AddPixelShaderBloomPasses(scene, exposureState, bloomLevelTargets);
 	}
+	AddBloomCombinePass(scene, exposureState, bloomLevelTargets, backBuffer);
 
-	sky->Draw(context, camera);
-
-	{
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		ID3D11Buffer* nothing = 0;
-		context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
-		context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
-
-		fullscreenVS->SetShader();
-		context->PSSetSamplers(0, 1, ppSampler.GetAddressOf());
-
-		BloomExtract();
-
-		if (bloomLevels >= 1) {
-			float levelScale = 0.5f;
-			SingleDirectionBlur(levelScale, XMFLOAT2(1, 0), blurHorizontalRTV[0], bloomExtractSRV);
-			SingleDirectionBlur(levelScale, XMFLOAT2(0, 1), blurVerticalRTV[0], blurHorizontalSRV[0]);
-
-			for (int i = 1; i < bloomLevels; i++) {
-				levelScale *= 0.5f;
-				SingleDirectionBlur(levelScale, XMFLOAT2(1, 0), blurHorizontalRTV[i], blurVerticalSRV[i - 1]);
-				SingleDirectionBlur(levelScale, XMFLOAT2(0, 1), blurVerticalRTV[i], blurHorizontalSRV[i]);
-			}
-		}
-
-		BloomCombine();
-
-		ID3D11ShaderResourceView* nullSRVs[16] = {};
-		context->PSSetShaderResources(0, 16, nullSRVs);
-	}
+	frameGraph->Compile();
+	frameGraph->Execute();
 
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
@@ -485,4 +1515,4 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Due to the usage of a more sophisticated swap chain,
 	// the render target must be re-bound after every call to Present()
 	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
-}
\ No newline at end of file
+}
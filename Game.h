@@ -6,13 +6,24 @@
 #include <memory>
 #include "Mesh.h"
 #include "BufferStructs.h"
-#include "GameEntity.h"
+#include "EntityStore.h"
 #include "Camera.h"
 #include "SimpleShader.h"
 #include "Material.h"
 #include "Lights.h"
-#include "WICTextureLoader.h"
+#include "LightClusters.h"
+#include "BloomFilter.h"
+#include "BloomEarlyOut.h"
+#include "AutoExposure.h"
+#include "ShaderArchive.h"
+#include "ShaderPermutations.h"
+#include "GaussianKernel.h"
+#include "AssetLoader.h"
 #include "Sky.h"
+#include "RenderQueue.h"
+#include "DeviceCommandList.h"
+#include "DeviceRenderTargetPool.h"
+#include "DeviceFrameGraph.h"
 
 class Game 
 	: public DXCore
@@ -32,47 +43,76 @@ public:
 private:
 
 	// Post processing resources for bloom
-	static const int MaxBloomLevels = 5;
+	static const int MaxBloomLevels = BloomFilter::MaxLevels;
 
 	bool drawBloomTextures = true;
+	bool computeBloom = true;	// BloomDownsampleCS, rather than the pixel shader passes
+	BloomQuality bloomQuality = BLOOM_QUALITY_HIGH;
+	bool skipDarkBloom = true;	// Leave bloom out while nothing is above bloomThreshold
+	float exposure = 1.0f;		// Scales the scene before tonemapping, on top of auto exposure
+	bool autoExposure = true;	// Adapt to the scene's brightness, which bloomThreshold is relative to
+	AutoExposureSettings autoExposureSettings;
+	Tonemapper tonemapper = TONEMAPPER_ACES;
 	int bloomLevels = 5;
 	float bloomThreshold = 0.75f;
 	float bloomLevelIntensities[MaxBloomLevels] = { 1, 1, 1, 1, 1 };
+	float bloomLevelSigmas[MaxBloomLevels] = { 7.5f, 7.5f, 7.5f, 7.5f, 7.5f };	// In texels of each level
+
+	// Blur kernels for bloomLevelSigmas, rebuilt when they change
+	GaussianKernel bloomKernels[MaxBloomLevels];
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler; // Clamp sampler for post processing
 
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ppRTV;		// Allows us to render to a texture
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ppSRV;		// Allows us to sample from the same texture
+	// The scene's brightest channel, from SceneMaxCS, and the
+	// staging buffers it's read back from a few frames later
+	BloomEarlyOut bloomEarlyOut;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> sceneMaxBuffer;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> sceneMaxUAV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> sceneMaxStaging[BloomEarlyOut::ResultLatency + 1];
+	bool sceneMaxPending[BloomEarlyOut::ResultLatency + 1] = {};
+	unsigned int sceneMaxFrame = 0;
 
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> bloomExtractRTV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bloomExtractSRV;
+	// AutoExposureCS's exposure and adapted luminance, which
+	// stay on the GPU, and an exposure of 1 for when it's off
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> exposureUAV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> exposureSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> fixedExposureSRV;
 
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> blurHorizontalRTV[MaxBloomLevels];
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> blurHorizontalSRV[MaxBloomLevels];
+	// Post processing targets, acquired by each pass as it
+	// needs them and released once they've been read
+	std::shared_ptr<DeviceRenderTargetPool> renderTargets;
 
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> blurVerticalRTV[MaxBloomLevels];
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> blurVerticalSRV[MaxBloomLevels];
+	// Rebuilt every frame from the passes below
+	std::shared_ptr<DeviceFrameGraph> frameGraph;
 
 	// Should we use vsync to limit the frame rate?
 	bool vsync;
 
+	// Compare the post processing shaders against their CPU
+	// references during Init()?  Debug builds only, with
+	// -gpuchecks on the command line.  Everything that needs
+	// no device is checked by Benchmarks.exe instead.
+	bool gpuChecks;
+
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void LoadShaders(); 
-	void LoadMeshes();
-	void ResizeAllPostProcessResources();
-	void ResizeOnePostProcessResource(Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv, float renderTargetScale, DXGI_FORMAT format);
-	void BloomExtract();
-	void SingleDirectionBlur(float renderTargetScale, DirectX::XMFLOAT2 blurDirection, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> target, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sourceTexture);
-	void BloomCombine();
-
-	// Helper for creating a cubemap from 6 individual textures
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
-		const wchar_t* right,
-		const wchar_t* left,
-		const wchar_t* up,
-		const wchar_t* down,
-		const wchar_t* front,
-		const wchar_t* back);
+	std::shared_ptr<SimplePixelShader> GetPixelShader(unsigned int permutation);
+	void LoadMeshes(AssetLoader& assetLoader);
+	void AddClearPasses(unsigned int backBuffer, unsigned int depthBuffer, unsigned int scene);
+	void AddScenePasses(unsigned int scene, unsigned int depthBuffer);
+	void AddAutoExposurePass(unsigned int scene, unsigned int exposureState, float deltaTime);
+	void ReadSceneMax();
+	void AddSceneMaxPass(unsigned int scene, unsigned int exposureState);
+	void AddPixelShaderBloomPasses(unsigned int scene, unsigned int exposureState, std::vector<unsigned int>& levels);
+	void AddComputeBloomPasses(unsigned int scene, unsigned int exposureState, std::vector<unsigned int>& levels);
+	void AddBloomCombinePass(unsigned int scene, unsigned int exposureState, const std::vector<unsigned int>& levels, unsigned int backBuffer);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetExposureSRV();
+	void DrawScene();
+	void SetUpFullscreenPass(float targetWidth, float targetHeight);
+	void BloomExtract(unsigned int sourceStep, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> target, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> source);
+	void UpdateBloomKernels();
+	void SingleDirectionBlur(unsigned int targetWidth, unsigned int targetHeight, DirectX::XMFLOAT2 blurDirection, GaussianKernel& kernel, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> target, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sourceTexture);
+	void BloomCombine(unsigned int scene, const std::vector<unsigned int>& levels);
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -81,17 +121,27 @@ private:
 	
 	// Shaders and shader-related constructs
 	std::shared_ptr<SimplePixelShader> pixelShader, skyPixelShader, gaussianBlurPS, bloomExtractPS, bloomCombinePS;
-	std::shared_ptr<SimpleVertexShader> vertexShader, skyVertexShader, fullscreenVS;
+	std::shared_ptr<SimpleVertexShader> vertexShader, instancedVertexShader, skyVertexShader, fullscreenVS;
+	std::shared_ptr<SimpleComputeShader> bloomDownsampleCS, sceneMaxCS, autoExposureCS;
+
+	// Every PixelShader.hlsl permutation, each created from the
+	// archive the first time GetPixelShader() is asked for it
+	ShaderArchive pixelShaderArchive;
+	std::shared_ptr<SimplePixelShader> pixelShaderPermutations[ShaderPermutations::Count];
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> constantBufferVS;
 
 	std::shared_ptr<Mesh> cube, cylinder, helix, quad, quadDoubleSided, sphere, torus, shuttle;
 	std::shared_ptr<Material> matStone, matMetal, matStarship;
 	std::shared_ptr<Sky> sky;
-	std::vector<std::shared_ptr<GameEntity>> gameEntities;
+	EntityStore entities;
+	std::vector<DrawItem> drawList;
+	RenderQueue renderQueue;
+	std::shared_ptr<DeviceCommandList> commandList;
 	std::shared_ptr<Camera> camera;
 
 	DirectX::XMFLOAT3 ambientColor;
 	std::vector<Light> lights;
+	LightClusters lightClusters;
 };
 
@@ -1,6 +1,15 @@
+// Most bilinear taps a kernel can have, center included.
+// Must match GaussianKernel::MaxTaps.
+#define MAX_TAPS 8
+
 cbuffer externalData : register(b0) {
 	float2 pixelUVSize;
 	float2 blurDirection;
+	int tapCount;
+
+	// From GaussianKernel, center first: x is the weight and
+	// y the offset in pixels, used on both sides
+	float4 taps[MAX_TAPS];
 }
 
 struct VertexToPixel {
@@ -13,19 +22,14 @@ SamplerState samplerOptions	: register(s0);
 
 float4 main(VertexToPixel input) : SV_TARGET
 {
-	#define NUM_SAMPLES 15
-
-	const float weights[NUM_SAMPLES] = { 0.023089, 0.034587, 0.048689, 0.064408, 0.080066, 0.093531, 0.102673, 0.105915, 0.102673, 0.093531, 0.080066, 0.064408, 0.048689, 0.034587, 0.023089 };
-	const float offsets[NUM_SAMPLES] = { -13.5f, -11.5f, -9.5f, -7.5f, -5.5f, -3.5f, -1.5f, 0, 1.5f, 3.5f, 5.5f, 7.5f, 9.5f, 11.5f, 13.5f };
-
-	float3 colorTotal = float3(0, 0, 0);
-
 	float2 uvOffset = blurDirection * pixelUVSize;
 
-	for (int i = 0; i < NUM_SAMPLES; i++) {
-		float2 uv = input.uv + (uvOffset * offsets[i]);
-		colorTotal += pixels.Sample(samplerOptions, uv).rgb * weights[i];
+	// Each tap blends two texels with the bilinear filter
+	float3 colorTotal = pixels.Sample(samplerOptions, input.uv).rgb * taps[0].x;
+	for (int i = 1; i < tapCount; i++) {
+		float2 tapOffset = uvOffset * taps[i].y;
+		colorTotal += (pixels.Sample(samplerOptions, input.uv - tapOffset).rgb + pixels.Sample(samplerOptions, input.uv + tapOffset).rgb) * taps[i].x;
 	}
 
 	return float4(colorTotal, 1);
-}
\ No newline at end of file
+}
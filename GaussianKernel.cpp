@@ -0,0 +1,118 @@
+#include "GaussianKernel.h"
+#include <math.h>
+
+// --------------------------------------------------------
+// A kernel that leaves the image as it is
+// --------------------------------------------------------
+GaussianKernel::GaussianKernel()
+{
+	this->Create(0.0f, 0);
+}
+
+// --------------------------------------------------------
+// A kernel three standard deviations wide, or as wide as
+// the compute shader's tiles allow
+// --------------------------------------------------------
+GaussianKernel::GaussianKernel(float sigma)
+{
+	this->Create(sigma, GetRadiusForSigma(sigma));
+}
+
+GaussianKernel::GaussianKernel(float sigma, int radius)
+{
+	this->Create(sigma, radius);
+}
+
+int GaussianKernel::GetRadiusForSigma(float sigma)
+{
+	int radius = (int)ceilf(sigma * 3.0f);
+	if (radius < 0)
+		return 0;
+	return radius > BloomFilter::MaxRadius ? BloomFilter::MaxRadius : radius;
+}
+
+float GaussianKernel::GetSigma()
+{
+	return this->sigma;
+}
+
+int GaussianKernel::GetRadius()
+{
+	return this->radius;
+}
+
+const float* GaussianKernel::GetWeights()
+{
+	return this->weights;
+}
+
+int GaussianKernel::GetTapCount()
+{
+	return this->tapCount;
+}
+
+const float* GaussianKernel::GetTapWeights()
+{
+	return this->tapWeights;
+}
+
+const float* GaussianKernel::GetTapOffsets()
+{
+	return this->tapOffsets;
+}
+
+// --------------------------------------------------------
+// Samples the Gaussian at each texel, normalizes the
+// (truncated) kernel to sum to one, then merges each pair
+// of texels after the center into one bilinear tap
+// --------------------------------------------------------
+void GaussianKernel::Create(float sigma, int radius)
+{
+	if (radius < 0)
+		radius = 0;
+	if (radius > BloomFilter::MaxRadius)
+		radius = BloomFilter::MaxRadius;
+	if (!(sigma > 0.0f))
+		radius = 0;
+
+	this->sigma = sigma;
+	this->radius = radius;
+
+	float total = 0.0f;
+	for (int i = 0; i <= BloomFilter::MaxRadius; i++)
+	{
+		this->weights[i] = i <= radius ? expf(-(float)(i * i) / (2.0f * sigma * sigma)) : 0.0f;
+		if (i > radius)
+			continue;
+		total += i == 0 ? this->weights[i] : 2.0f * this->weights[i];
+	}
+	if (radius == 0)
+	{
+		this->weights[0] = 1.0f;
+		total = 1.0f;
+	}
+	for (int i = 0; i <= radius; i++)
+		this->weights[i] /= total;
+
+	// Texels 1 and 2, 3 and 4, and so on; an odd radius
+	// leaves the last texel on its own, sampled at its center
+	this->tapCount = 1;
+	this->tapWeights[0] = this->weights[0];
+	this->tapOffsets[0] = 0.0f;
+	for (int a = 1; a <= radius; a += 2)
+	{
+		int b = a + 1;
+		float weightA = this->weights[a];
+		float weightB = b <= radius ? this->weights[b] : 0.0f;
+		float weight = weightA + weightB;
+
+		this->tapWeights[this->tapCount] = weight;
+		this->tapOffsets[this->tapCount] = weight > 0.0f ? (a * weightA + b * weightB) / weight : (float)a;
+		this->tapCount++;
+	}
+	for (int i = this->tapCount; i < MaxTaps; i++)
+	{
+		this->tapWeights[i] = 0.0f;
+		this->tapOffsets[i] = 0.0f;
+	}
+}
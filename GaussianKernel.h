@@ -0,0 +1,49 @@
+#pragma once
+
+#include "BloomFilter.h"
+
+// --------------------------------------------------------
+// A normalized, symmetric Gaussian blur kernel, both as one
+// weight per texel (for BloomDownsampleCS and BloomFilter)
+// and merged into bilinear taps (for GaussianBlurPS)
+//
+// Merging uses the filtering hardware: texels a and b read
+// with one bilinear sample at
+//   offset = (a * w[a] + b * w[b]) / (w[a] + w[b])
+// and weighted by w[a] + w[b] give exactly w[a] and w[b], so
+// a radius r kernel takes 1 + 2 * ceil(r / 2) samples rather
+// than 1 + 2r.
+//
+// Weights and taps are center first, each used on both
+// sides.  Needs no Direct3D device at all.
+// --------------------------------------------------------
+class GaussianKernel {
+public:
+	// Must match MAX_TAPS in GaussianBlurPS.hlsl
+	static const int MaxTaps = 1 + (BloomFilter::MaxRadius + 1) / 2;
+
+	GaussianKernel();
+	GaussianKernel(float sigma);
+	GaussianKernel(float sigma, int radius);
+
+	static int GetRadiusForSigma(float sigma);
+
+	float GetSigma();
+	int GetRadius();
+	const float* GetWeights();
+
+	int GetTapCount();
+	const float* GetTapWeights();
+	const float* GetTapOffsets();
+
+private:
+	void Create(float sigma, int radius);
+
+	float sigma;
+	int radius;
+	float weights[BloomFilter::MaxRadius + 1];
+
+	int tapCount;
+	float tapWeights[MaxTaps];
+	float tapOffsets[MaxTaps];
+};
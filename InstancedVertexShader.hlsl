@@ -0,0 +1,43 @@
+#include "ShaderStructs.hlsli"
+
+// Must match InstanceData in BufferStructs.h
+struct InstanceData
+{
+	matrix worldMatrix;
+	matrix worldInvTranspose;
+};
+
+// Set once per frame (the per-object data is in instances)
+cbuffer PerFrame : register(b0) {
+	matrix viewMatrix;
+	matrix projectionMatrix;
+}
+
+// One entry per instance, filled by DeviceCommandList
+StructuredBuffer<InstanceData> instances : register(t0);
+
+// --------------------------------------------------------
+// Instanced version of VertexShader.hlsl
+// 
+// - Every instance of a draw shares the mesh and material
+// - The world matrices come from the instance buffer, so
+//   each instance only costs its entry there
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input, uint instanceID : SV_InstanceID )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+	InstanceData instance = instances[instanceID];
+
+	matrix wvp = mul(projectionMatrix, mul(viewMatrix, instance.worldMatrix));
+	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+
+	output.normal = mul((float3x3)instance.worldInvTranspose, input.normal);
+	output.worldPos = mul(instance.worldMatrix, float4(input.localPosition, 1)).xyz;
+
+	output.uv = input.uv;
+	output.tangent = input.tangent;
+
+	return output;
+}
@@ -0,0 +1,67 @@
+#include "JobSystem.h"
+#include <Windows.h>
+
+// --------------------------------------------------------
+// Starts the worker threads
+//
+// threadCount - Number of workers, or 0 to use one less
+//               than the number of hardware threads (the
+//               main thread is usually busy as well)
+// --------------------------------------------------------
+JobSystem::JobSystem(unsigned int threadCount)
+{
+	this->shuttingDown = false;
+
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this));
+}
+
+// --------------------------------------------------------
+// Finishes any queued jobs, then joins the workers
+// --------------------------------------------------------
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shuttingDown = true;
+	}
+	jobAvailable.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+	return (unsigned int)workers.size();
+}
+
+void JobSystem::WorkerLoop()
+{
+	CoInitializeEx(0, COINIT_MULTITHREADED);
+
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this]() { return shuttingDown || !jobs.empty(); });
+
+			if (jobs.empty())
+				break; // Shutting down and nothing left to do
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		job();
+	}
+
+	CoUninitialize();
+}
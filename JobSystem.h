@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A fixed pool of worker threads that runs submitted jobs
+// in FIFO order
+//
+// - Submit() returns a std::future for the job's result,
+//   which doubles as the handle used to wait on it
+// - Workers are COM (multithreaded apartment) threads, so
+//   jobs may use WIC and other COM-based APIs
+// --------------------------------------------------------
+class JobSystem {
+public:
+	JobSystem(unsigned int threadCount = 0);
+	~JobSystem();
+
+	unsigned int GetThreadCount();
+
+	template<typename F>
+	auto Submit(F job) -> std::future<decltype(job())>
+	{
+		// Wrap the job so its result (or exception)
+		// ends up in the returned future
+		typedef decltype(job()) Result;
+		std::shared_ptr<std::packaged_task<Result()>> task =
+			std::make_shared<std::packaged_task<Result()>>(job);
+		std::future<Result> result = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back([task]() { (*task)(); });
+		}
+		jobAvailable.notify_one();
+
+		return result;
+	}
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	bool shuttingDown;
+};
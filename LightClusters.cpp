@@ -0,0 +1,263 @@
+#include "LightClusters.h"
+#include <math.h>
+
+// --------------------------------------------------------
+// Squared distance from a value to a range, zero inside it.
+// Build() and BuildBruteForce() both use it, so they agree
+// to the bit on which lights touch which clusters.
+// --------------------------------------------------------
+static float SquaredAxisDistance(float value, float min, float max)
+{
+	float distance = 0.0f;
+	if (value < min)
+		distance = min - value;
+	else if (value > max)
+		distance = value - max;
+	return distance * distance;
+}
+
+LightClusters::LightClusters()
+{
+	this->xScale = 1.0f;
+	this->yScale = 1.0f;
+	this->depthScale = 0.0f;
+	this->depthBias = 0.0f;
+	this->clusters.resize(ClusterCount);
+}
+
+// --------------------------------------------------------
+// Bins the lights, walking only the slices and tiles each
+// light's sphere can reach
+// --------------------------------------------------------
+void LightClusters::Build(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, const Light* lights, unsigned int lightCount)
+{
+	this->SetUpGrid(projection);
+	this->TransformLights(view, lights, lightCount);
+
+	this->clusterLights.clear();
+	for (unsigned int l = 0; l < lightCount; l++)
+	{
+		const DirectX::XMFLOAT4& sphere = this->spheres[l];
+		if (sphere.w < 0.0f)
+		{
+			for (unsigned int c = 0; c < ClusterCount; c++)
+			{
+				ClusterLight clusterLight = { c, l };
+				this->clusterLights.push_back(clusterLight);
+			}
+			continue;
+		}
+
+		float radiusSquared = sphere.w * sphere.w;
+		for (unsigned int z = 0; z < Slices; z++)
+		{
+			float dz2 = SquaredAxisDistance(sphere.z, this->sliceMinZ[z], this->sliceMaxZ[z]);
+			if (dz2 > radiusSquared)
+				continue;
+
+			float dx2[TilesX];
+			for (unsigned int x = 0; x < TilesX; x++)
+				dx2[x] = SquaredAxisDistance(sphere.x, this->tileMinX[z][x], this->tileMaxX[z][x]);
+
+			for (unsigned int y = 0; y < TilesY; y++)
+			{
+				// Adding a non-negative distance can't bring the
+				// sum back under the radius, so skip the whole row
+				float dy2 = SquaredAxisDistance(sphere.y, this->tileMinY[z][y], this->tileMaxY[z][y]);
+				if (dy2 + dz2 > radiusSquared)
+					continue;
+
+				unsigned int rowStart = (z * TilesY + y) * TilesX;
+				for (unsigned int x = 0; x < TilesX; x++)
+				{
+					if (dx2[x] + dy2 + dz2 <= radiusSquared)
+					{
+						ClusterLight clusterLight = { rowStart + x, l };
+						this->clusterLights.push_back(clusterLight);
+					}
+				}
+			}
+		}
+	}
+
+	this->Finish();
+}
+
+// --------------------------------------------------------
+// Tests every light against every cluster.  Much slower, but
+// produces exactly the same lists as Build().
+// --------------------------------------------------------
+void LightClusters::BuildBruteForce(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, const Light* lights, unsigned int lightCount)
+{
+	this->SetUpGrid(projection);
+	this->TransformLights(view, lights, lightCount);
+
+	this->clusterLights.clear();
+	for (unsigned int z = 0; z < Slices; z++)
+	{
+		for (unsigned int y = 0; y < TilesY; y++)
+		{
+			for (unsigned int x = 0; x < TilesX; x++)
+			{
+				unsigned int cluster = (z * TilesY + y) * TilesX + x;
+				for (unsigned int l = 0; l < lightCount; l++)
+				{
+					const DirectX::XMFLOAT4& sphere = this->spheres[l];
+
+					bool touches = sphere.w < 0.0f;
+					if (!touches)
+					{
+						float dx2 = SquaredAxisDistance(sphere.x, this->tileMinX[z][x], this->tileMaxX[z][x]);
+						float dy2 = SquaredAxisDistance(sphere.y, this->tileMinY[z][y], this->tileMaxY[z][y]);
+						float dz2 = SquaredAxisDistance(sphere.z, this->sliceMinZ[z], this->sliceMaxZ[z]);
+						touches = dx2 + dy2 + dz2 <= sphere.w * sphere.w;
+					}
+
+					if (touches)
+					{
+						ClusterLight clusterLight = { cluster, l };
+						this->clusterLights.push_back(clusterLight);
+					}
+				}
+			}
+		}
+	}
+
+	this->Finish();
+}
+
+const std::vector<LightCluster>& LightClusters::GetClusters()
+{
+	return this->clusters;
+}
+
+const std::vector<unsigned int>& LightClusters::GetLightIndices()
+{
+	return this->lightIndices;
+}
+
+float LightClusters::GetDepthScale()
+{
+	return this->depthScale;
+}
+
+float LightClusters::GetDepthBias()
+{
+	return this->depthBias;
+}
+
+// --------------------------------------------------------
+// The cluster a view space position falls in, found the
+// same way PixelShader.hlsl finds it for a pixel
+// --------------------------------------------------------
+unsigned int LightClusters::GetClusterIndex(const DirectX::XMFLOAT3& viewPosition)
+{
+	float ndcX = viewPosition.x * this->xScale / viewPosition.z;
+	float ndcY = viewPosition.y * this->yScale / viewPosition.z;
+
+	// Tile rows count down from the top, like pixel rows
+	int x = (int)floorf((ndcX + 1.0f) * 0.5f * TilesX);
+	int y = (int)floorf((1.0f - ndcY) * 0.5f * TilesY);
+	int z = (int)floorf(log2f(viewPosition.z) * this->depthScale + this->depthBias);
+
+	x = x < 0 ? 0 : (x >= (int)TilesX ? TilesX - 1 : x);
+	y = y < 0 ? 0 : (y >= (int)TilesY ? TilesY - 1 : y);
+	z = z < 0 ? 0 : (z >= (int)Slices ? Slices - 1 : z);
+	return (z * TilesY + y) * TilesX + x;
+}
+
+// --------------------------------------------------------
+// Works out the view space box around every cluster from a
+// perspective projection's near and far planes and scales
+// --------------------------------------------------------
+void LightClusters::SetUpGrid(const DirectX::XMFLOAT4X4& projection)
+{
+	// XMMatrixPerspectiveFovLH puts far / (far - near) in _33
+	// and -near * far / (far - near) in _43
+	float nearClip = -projection._43 / projection._33;
+	float farClip = projection._43 / (1.0f - projection._33);
+
+	this->xScale = projection._11;
+	this->yScale = projection._22;
+
+	float logDepthRange = log2f(farClip / nearClip);
+	this->depthScale = Slices / logDepthRange;
+	this->depthBias = -(float)Slices * log2f(nearClip) / logDepthRange;
+
+	for (unsigned int z = 0; z < Slices; z++)
+	{
+		float minZ = nearClip * powf(farClip / nearClip, (float)z / Slices);
+		float maxZ = z + 1 == Slices ? farClip : nearClip * powf(farClip / nearClip, (float)(z + 1) / Slices);
+		this->sliceMinZ[z] = minZ;
+		this->sliceMaxZ[z] = maxZ;
+
+		// A tile's edges are planes through the eye, so its
+		// box spans the near edge at one depth and the far
+		// edge at the other, whichever is wider
+		for (unsigned int x = 0; x < TilesX; x++)
+		{
+			float left = -1.0f + 2.0f * x / TilesX;
+			float right = -1.0f + 2.0f * (x + 1) / TilesX;
+			this->tileMinX[z][x] = (left < 0.0f ? left * maxZ : left * minZ) / this->xScale;
+			this->tileMaxX[z][x] = (right > 0.0f ? right * maxZ : right * minZ) / this->xScale;
+		}
+
+		for (unsigned int y = 0; y < TilesY; y++)
+		{
+			float top = 1.0f - 2.0f * y / TilesY;
+			float bottom = 1.0f - 2.0f * (y + 1) / TilesY;
+			this->tileMinY[z][y] = (bottom < 0.0f ? bottom * maxZ : bottom * minZ) / this->yScale;
+			this->tileMaxY[z][y] = (top > 0.0f ? top * maxZ : top * minZ) / this->yScale;
+		}
+	}
+}
+
+void LightClusters::TransformLights(const DirectX::XMFLOAT4X4& view, const Light* lights, unsigned int lightCount)
+{
+	this->spheres.resize(lightCount);
+	for (unsigned int l = 0; l < lightCount; l++)
+	{
+		const Light& light = lights[l];
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+		{
+			this->spheres[l] = DirectX::XMFLOAT4(0, 0, 0, -1.0f);
+			continue;
+		}
+
+		// Spot lights get their whole range too; the cone
+		// would be a tighter fit, but this is never wrong
+		const DirectX::XMFLOAT3& p = light.Position;
+		this->spheres[l] = DirectX::XMFLOAT4(
+			p.x * view._11 + p.y * view._21 + p.z * view._31 + view._41,
+			p.x * view._12 + p.y * view._22 + p.z * view._32 + view._42,
+			p.x * view._13 + p.y * view._23 + p.z * view._33 + view._43,
+			light.Range);
+	}
+}
+
+// --------------------------------------------------------
+// Groups the (cluster, light) pairs by cluster with a
+// counting sort, keeping each cluster's lights in order
+// --------------------------------------------------------
+void LightClusters::Finish()
+{
+	for (unsigned int c = 0; c < ClusterCount; c++)
+		this->clusters[c].count = 0;
+	for (size_t i = 0; i < this->clusterLights.size(); i++)
+		this->clusters[this->clusterLights[i].cluster].count++;
+
+	unsigned int offset = 0;
+	for (unsigned int c = 0; c < ClusterCount; c++)
+	{
+		this->clusters[c].offset = offset;
+		offset += this->clusters[c].count;
+		this->clusters[c].count = 0;
+	}
+
+	this->lightIndices.resize(this->clusterLights.size());
+	for (size_t i = 0; i < this->clusterLights.size(); i++)
+	{
+		LightCluster& cluster = this->clusters[this->clusterLights[i].cluster];
+		this->lightIndices[cluster.offset + cluster.count++] = this->clusterLights[i].light;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Lights.h"
+
+// --------------------------------------------------------
+// Where one cluster's lights start in the index list, and
+// how many there are.  Must match LightCluster in
+// PixelShader.hlsl.
+// --------------------------------------------------------
+struct LightCluster
+{
+	unsigned int offset;
+	unsigned int count;
+};
+
+// --------------------------------------------------------
+// Bins lights into a grid of clusters ("froxels") over the
+// camera's view frustum, for clustered forward shading
+//
+// - The grid is TilesX by TilesY screen tiles, each split
+//   into Slices along view depth.  Slices get exponentially
+//   deeper between the near and far clip planes, so clusters
+//   stay roughly cube shaped.
+// - Point and spot lights are bounded by a sphere of their
+//   range, and added to every cluster whose view space box
+//   the sphere touches.  Directional lights go in every
+//   cluster.
+// - Each cluster's light indices are contiguous and in
+//   ascending order, so the pixel shader only walks the
+//   lights that can reach its cluster.
+//
+// The near and far planes and field of view come from the
+// projection matrix, so any XMMatrixPerspectiveFovLH one
+// works.  Needs no Direct3D device at all.
+// --------------------------------------------------------
+class LightClusters {
+public:
+	// Must match the CLUSTER_ defines in Lighting.hlsli
+	static const unsigned int TilesX = 16;
+	static const unsigned int TilesY = 9;
+	static const unsigned int Slices = 24;
+	static const unsigned int ClusterCount = TilesX * TilesY * Slices;
+
+	LightClusters();
+
+	void Build(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, const Light* lights, unsigned int lightCount);
+	void BuildBruteForce(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, const Light* lights, unsigned int lightCount);
+
+	const std::vector<LightCluster>& GetClusters();
+	const std::vector<unsigned int>& GetLightIndices();
+
+	// For the pixel shader's slice lookup:
+	//   slice = log2(viewDepth) * scale + bias
+	float GetDepthScale();
+	float GetDepthBias();
+
+	unsigned int GetClusterIndex(const DirectX::XMFLOAT3& viewPosition);
+
+private:
+	void SetUpGrid(const DirectX::XMFLOAT4X4& projection);
+	void TransformLights(const DirectX::XMFLOAT4X4& view, const Light* lights, unsigned int lightCount);
+	void Finish();
+
+	// A light touching a cluster, before they're grouped
+	struct ClusterLight
+	{
+		unsigned int cluster;
+		unsigned int light;
+	};
+
+	float xScale;
+	float yScale;
+	float depthScale;
+	float depthBias;
+
+	// View space bounds of each slice, and of each tile within
+	// each slice (tiles widen with depth)
+	float sliceMinZ[Slices];
+	float sliceMaxZ[Slices];
+	float tileMinX[Slices][TilesX];
+	float tileMaxX[Slices][TilesX];
+	float tileMinY[Slices][TilesY];
+	float tileMaxY[Slices][TilesY];
+
+	// This frame's lights as view space spheres; a negative
+	// radius marks a directional light
+	std::vector<DirectX::XMFLOAT4> spheres;
+
+	std::vector<ClusterLight> clusterLights;
+	std::vector<LightCluster> clusters;
+	std::vector<unsigned int> lightIndices;
+};
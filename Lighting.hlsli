@@ -2,14 +2,18 @@
 #ifndef __GGP_LIGHTING__
 #define __GGP_LIGHTING__
 
-#define MAX_LIGHTS 128
-
 #define MAX_SPECULAR_EXPONENT 256.0f
 
 #define LIGHT_TYPE_DIRECTIONAL	0
 #define LIGHT_TYPE_POINT		1
 #define LIGHT_TYPE_SPOT			2
 
+// Light cluster grid, must match LightClusters.h
+#define CLUSTER_TILES_X			16
+#define CLUSTER_TILES_Y			9
+#define CLUSTER_SLICES			24
+
+// Must match Light in Lights.h, which checks its layout
 struct Light
 {
 	int		Type;
@@ -1,5 +1,6 @@
 #pragma once
 #include <DirectXMath.h>
+#include <stddef.h>
 #define LIGHT_TYPE_DIRECTIONAL 0
 #define LIGHT_TYPE_POINT 1
 #define LIGHT_TYPE_SPOT 2
@@ -13,4 +14,15 @@ struct Light {
 	DirectX::XMFLOAT3 Color;
 	float SpotFalloff;
 	DirectX::XMFLOAT3 Padding;
-};
\ No newline at end of file
+};
+
+// Light is copied as-is into PixelShader's StructuredBuffer<Light>,
+// so it must match the struct in Lighting.hlsli byte for byte
+static_assert(sizeof(Light) == 64, "Light must be 64 bytes to match Lighting.hlsli");
+static_assert(offsetof(Light, Type) == 0, "Light::Type must match Lighting.hlsli");
+static_assert(offsetof(Light, Direction) == 4, "Light::Direction must match Lighting.hlsli");
+static_assert(offsetof(Light, Range) == 16, "Light::Range must match Lighting.hlsli");
+static_assert(offsetof(Light, Position) == 20, "Light::Position must match Lighting.hlsli");
+static_assert(offsetof(Light, intensity) == 32, "Light::intensity must match Lighting.hlsli");
+static_assert(offsetof(Light, Color) == 36, "Light::Color must match Lighting.hlsli");
+static_assert(offsetof(Light, SpotFalloff) == 48, "Light::SpotFalloff must match Lighting.hlsli");
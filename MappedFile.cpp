@@ -0,0 +1,127 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	this->data = 0;
+	this->size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	this->Close();
+}
+
+// --------------------------------------------------------
+// Maps the whole file.  The view keeps the mapping alive,
+// so the file itself is closed straight away.
+// --------------------------------------------------------
+bool MappedFile::Open(const char* filename)
+{
+	this->Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+
+	if (mapping) CloseHandle(mapping);
+	CloseHandle(file);
+
+	if (!view)
+		return false;
+
+	this->data = (const unsigned char*)view;
+	this->size = (size_t)fileSize.QuadPart;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	void* view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	this->data = (const unsigned char*)view;
+	this->size = (size_t)info.st_size;
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (this->data)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(this->data);
+#else
+		munmap((void*)this->data, this->size);
+#endif
+	}
+
+	this->data = 0;
+	this->size = 0;
+}
+
+const unsigned char* MappedFile::GetData()
+{
+	return this->data;
+}
+
+size_t MappedFile::GetSize()
+{
+	return this->size;
+}
+
+bool MappedFile::GetInfo(const char* filename, unsigned long long& size, unsigned long long& modifiedTime)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &attributes))
+		return false;
+
+	size = ((unsigned long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	modifiedTime = ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat info;
+	if (stat(filename, &info) != 0)
+		return false;
+
+	size = (unsigned long long)info.st_size;
+#ifdef __APPLE__
+	modifiedTime = (unsigned long long)info.st_mtimespec.tv_sec * 1000000000ull + info.st_mtimespec.tv_nsec;
+#else
+	modifiedTime = (unsigned long long)info.st_mtim.tv_sec * 1000000000ull + info.st_mtim.tv_nsec;
+#endif
+#endif
+
+	return true;
+}
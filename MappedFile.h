@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+// --------------------------------------------------------
+// A whole file mapped read-only into memory, so loaders can
+// walk its bytes in place instead of copying them through a
+// stream.  Uses CreateFileMapping() on Windows and mmap()
+// everywhere else.
+//
+// - Open() fails on a missing or empty file, so GetData()
+//   is never null while a file is open
+// - GetInfo() reads a file's size and last write time
+//   without mapping it.  The time is only meant to be
+//   compared for equality, and its units differ by platform.
+// --------------------------------------------------------
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* filename);
+	void Close();
+
+	const unsigned char* GetData();
+	size_t GetSize();
+
+	static bool GetInfo(const char* filename, unsigned long long& size, unsigned long long& modifiedTime);
+
+private:
+	// Copies would unmap the same view twice
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* data;
+	size_t size;
+};
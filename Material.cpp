@@ -1,5 +1,8 @@
 #include "Material.h"
 
+// Counts up forever, so no two materials share an ID
+static unsigned int NextMaterialID = 0;
+
 Material::Material(std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<SimplePixelShader> pixelShader, DirectX::XMFLOAT4 colorTint, DirectX::XMFLOAT2 uvScale, DirectX::XMFLOAT2 uvOffset)
 {
 	this->vertexShader = vertexShader;
@@ -7,6 +10,7 @@ Material::Material(std::shared_ptr<SimpleVertexShader> vertexShader, std::shared
 	this->colorTint = colorTint;
 	this->uvScale = uvScale;
 	this->uvOffset = uvOffset;
+	this->id = NextMaterialID++;
 }
 
 Material::~Material()
@@ -38,6 +42,11 @@ std::shared_ptr<SimplePixelShader> Material::GetPixelShader()
 	return this->pixelShader;
 }
 
+unsigned int Material::GetID()
+{
+	return this->id;
+}
+
 void Material::AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV)
 {
 	this->textureSRVs.insert({ shaderName, textureSRV });
@@ -19,12 +19,14 @@ public:
 	DirectX::XMFLOAT2 GetUVOffset();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
+	unsigned int GetID();
 
 	void AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV);
 	void AddSampler(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 	void PrepareMaterial();
 
 private:
+	unsigned int id;
 	DirectX::XMFLOAT4 colorTint;
 	DirectX::XMFLOAT2 uvOffset;
 	DirectX::XMFLOAT2 uvScale;
@@ -0,0 +1,309 @@
+#include "MeshBuilder.h"
+#include "ObjLoader.h"
+#include "MeshCache.h"
+#include <emmintrin.h>
+#include <math.h>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Loads a mesh file into CPU-side vertices and indices, with
+// tangents and bounds already calculated.  Never touches
+// Direct3D, so it is safe to call from any thread.
+//
+// Uses the binary cache when it's still valid, otherwise
+// parses the file and rebuilds the cache
+// --------------------------------------------------------
+bool MeshBuilder::LoadMeshData(const char* filename, MeshData& meshData)
+{
+	if (MeshCache::Load(filename, meshData))
+		return true;
+
+	if (!ObjLoader::Load(filename, meshData))
+		return false;
+
+	int vertexCount = (int)meshData.vertices.size();
+	int indexCount = (int)meshData.indices.size();
+
+	CalculateTangents(&meshData.vertices[0], vertexCount, &meshData.indices[0], indexCount);
+	CalculateBounds(&meshData.vertices[0], vertexCount, meshData.bounds);
+	MeshCache::Save(filename, meshData);
+	return true;
+}
+
+// --------------------------------------------------------
+// Scalar reference version of CalculateTangents(), which
+// walks the vertices one triangle at a time
+// --------------------------------------------------------
+void MeshBuilder::CalculateTangentsScalar(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	// Reset tangents
+	for (int i = 0; i < numVerts; i++)
+	{
+		verts[i].tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (int i = 0; i < numIndices;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->position.x - v1->position.x;
+		float y1 = v2->position.y - v1->position.y;
+		float z1 = v2->position.z - v1->position.z;
+
+		float x2 = v3->position.x - v1->position.x;
+		float y2 = v3->position.y - v1->position.y;
+		float z2 = v3->position.z - v1->position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->uv.x - v1->uv.x;
+		float t1 = v2->uv.y - v1->uv.y;
+
+		float s2 = v3->uv.x - v1->uv.x;
+		float t2 = v3->uv.y - v1->uv.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->tangent.x += tx;
+		v1->tangent.y += ty;
+		v1->tangent.z += tz;
+
+		v2->tangent.x += tx;
+		v2->tangent.y += ty;
+		v2->tangent.z += tz;
+
+		v3->tangent.x += tx;
+		v3->tangent.y += ty;
+		v3->tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (int i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
+
+		// Use Gram-Schmidt orthonormalize to ensure
+		// the normal and tangent are exactly 90 degrees apart
+		XMFLOAT3 orthogonal;
+		XMStoreFloat3(&orthogonal, tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Zero-length tangents stay zero rather than becoming NaN
+		float length = sqrtf(orthogonal.x * orthogonal.x + orthogonal.y * orthogonal.y + orthogonal.z * orthogonal.z);
+		if (length == 0.0f)
+		{
+			verts[i].tangent = XMFLOAT3(0, 0, 0);
+			continue;
+		}
+
+		// Store the tangent
+		verts[i].tangent = XMFLOAT3(orthogonal.x / length, orthogonal.y / length, orthogonal.z / length);
+	}
+}
+
+// --------------------------------------------------------
+// Calculates per-vertex tangents, four triangles at a time
+//
+// Each vertex's position and UV are first staged as two
+// 16-byte rows, so the corners of four triangles can be
+// loaded whole and transposed into structure-of-arrays
+// registers (one SSE lane per triangle).  The results are
+// then added to their vertices one lane at a time, which
+// keeps the sums correct when triangles share vertices.
+// Produces the same results as CalculateTangentsScalar(),
+// zero-length tangents included.
+// --------------------------------------------------------
+void MeshBuilder::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	if (numVerts <= 0)
+		return;
+
+	// Staging rows: (x, y, z, u), (v, 0, 0, 0) and the normal,
+	// followed by the tangent sums as (x, y, z, 0)
+	std::vector<__m128> staging((size_t)numVerts * 4);
+	__m128* posU = &staging[0];
+	__m128* vRow = posU + numVerts;
+	__m128* normals = vRow + numVerts;
+	__m128* sums = normals + numVerts;
+
+	for (int i = 0; i < numVerts; i++)
+	{
+		posU[i] = _mm_setr_ps(verts[i].position.x, verts[i].position.y, verts[i].position.z, verts[i].uv.x);
+		vRow[i] = _mm_set_ss(verts[i].uv.y);
+		normals[i] = _mm_setr_ps(verts[i].normal.x, verts[i].normal.y, verts[i].normal.z, 0.0f);
+		sums[i] = _mm_setzero_ps();
+	}
+
+	// Four whole triangles per iteration
+	int numTriangles = numIndices / 3;
+	int simdTriangles = numTriangles & ~3;
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (int t = 0; t < simdTriangles; t += 4)
+	{
+		const unsigned int* tri = &indices[t * 3];
+
+		// Load each corner of the four triangles and transpose,
+		// leaving x, y, z and u of every triangle in its own lane
+		__m128 ax = posU[tri[0]], ay = posU[tri[3]], az = posU[tri[6]], au = posU[tri[9]];
+		__m128 bx = posU[tri[1]], by = posU[tri[4]], bz = posU[tri[7]], bu = posU[tri[10]];
+		__m128 cx = posU[tri[2]], cy = posU[tri[5]], cz = posU[tri[8]], cu = posU[tri[11]];
+		_MM_TRANSPOSE4_PS(ax, ay, az, au);
+		_MM_TRANSPOSE4_PS(bx, by, bz, bu);
+		_MM_TRANSPOSE4_PS(cx, cy, cz, cu);
+
+		__m128 av = _mm_unpacklo_ps(_mm_unpacklo_ps(vRow[tri[0]], vRow[tri[6]]), _mm_unpacklo_ps(vRow[tri[3]], vRow[tri[9]]));
+		__m128 bv = _mm_unpacklo_ps(_mm_unpacklo_ps(vRow[tri[1]], vRow[tri[7]]), _mm_unpacklo_ps(vRow[tri[4]], vRow[tri[10]]));
+		__m128 cv = _mm_unpacklo_ps(_mm_unpacklo_ps(vRow[tri[2]], vRow[tri[8]]), _mm_unpacklo_ps(vRow[tri[5]], vRow[tri[11]]));
+
+		// Calculate vectors relative to triangle positions
+		__m128 x1 = _mm_sub_ps(bx, ax), y1 = _mm_sub_ps(by, ay), z1 = _mm_sub_ps(bz, az);
+		__m128 x2 = _mm_sub_ps(cx, ax), y2 = _mm_sub_ps(cy, ay), z2 = _mm_sub_ps(cz, az);
+
+		// Do the same for vectors relative to triangle uv's
+		__m128 s1 = _mm_sub_ps(bu, au), t1 = _mm_sub_ps(bv, av);
+		__m128 s2 = _mm_sub_ps(cu, au), t2 = _mm_sub_ps(cv, av);
+
+		// r = 1 / (s1 * t2 - s2 * t1)
+		__m128 r = _mm_div_ps(one, _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1)));
+
+		// Tangent = (t2 * e1 - t1 * e2) * r, transposed back
+		// into one (x, y, z, 0) row per triangle
+		__m128 tangents[4];
+		tangents[0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r);
+		tangents[1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r);
+		tangents[2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r);
+		tangents[3] = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(tangents[0], tangents[1], tangents[2], tangents[3]);
+
+		// Add to each vertex of each triangle, lane by lane
+		for (int lane = 0; lane < 4; lane++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				__m128& sum = sums[tri[lane * 3 + corner]];
+				sum = _mm_add_ps(sum, tangents[lane]);
+			}
+		}
+	}
+
+	// Leftover triangles, one at a time
+	for (int t = simdTriangles; t < numTriangles; t++)
+	{
+		unsigned int i1 = indices[t * 3];
+		unsigned int i2 = indices[t * 3 + 1];
+		unsigned int i3 = indices[t * 3 + 2];
+
+		__m128 e1 = _mm_sub_ps(posU[i2], posU[i1]);
+		__m128 e2 = _mm_sub_ps(posU[i3], posU[i1]);
+		float s1 = _mm_cvtss_f32(_mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 3, 3, 3)));
+		float s2 = _mm_cvtss_f32(_mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 3, 3, 3)));
+		float t1 = _mm_cvtss_f32(_mm_sub_ss(vRow[i2], vRow[i1]));
+		float t2 = _mm_cvtss_f32(_mm_sub_ss(vRow[i3], vRow[i1]));
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		// Same per-component math as the SIMD loop, with w cleared
+		const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+		__m128 tangent = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(t2), e1), _mm_mul_ps(_mm_set1_ps(t1), e2)), _mm_set1_ps(r));
+		tangent = _mm_and_ps(tangent, xyzMask);
+
+		sums[i1] = _mm_add_ps(sums[i1], tangent);
+		sums[i2] = _mm_add_ps(sums[i2], tangent);
+		sums[i3] = _mm_add_ps(sums[i3], tangent);
+	}
+
+	// Gram-Schmidt orthonormalize, four vertices at a time, to
+	// ensure the normal and tangent are exactly 90 degrees apart
+	const __m128 zero = _mm_setzero_ps();
+	for (int i = 0; i < numVerts; i += 4)
+	{
+		// The last group may be partial, so pad it by
+		// repeating its final vertex
+		int group[4];
+		for (int k = 0; k < 4; k++)
+			group[k] = i + k < numVerts ? i + k : numVerts - 1;
+
+		__m128 nx = normals[group[0]], ny = normals[group[1]], nz = normals[group[2]], nw = normals[group[3]];
+		_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+
+		__m128 tx = sums[group[0]], ty = sums[group[1]], tz = sums[group[2]], tw = sums[group[3]];
+		_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+		tx = _mm_sub_ps(tx, _mm_mul_ps(nx, dot));
+		ty = _mm_sub_ps(ty, _mm_mul_ps(ny, dot));
+		tz = _mm_sub_ps(tz, _mm_mul_ps(nz, dot));
+
+		// Zero-length tangents stay zero rather than becoming NaN
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+		__m128 nonZero = _mm_cmpneq_ps(length, zero);
+		tx = _mm_and_ps(_mm_div_ps(tx, length), nonZero);
+		ty = _mm_and_ps(_mm_div_ps(ty, length), nonZero);
+		tz = _mm_and_ps(_mm_div_ps(tz, length), nonZero);
+		tw = zero;
+		_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+
+		// Store the tangents
+		__m128 results[4] = { tx, ty, tz, tw };
+		for (int k = 0; k < 4 && i + k < numVerts; k++)
+		{
+			XMFLOAT4 result;
+			_mm_storeu_ps(&result.x, results[k]);
+			verts[i + k].tangent = XMFLOAT3(result.x, result.y, result.z);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Calculates the local-space axis-aligned bounding box and
+// a bounding sphere (centered on the box) for the vertices
+// --------------------------------------------------------
+void MeshBuilder::CalculateBounds(const Vertex* verts, int numVerts, MeshBounds& bounds)
+{
+	if (numVerts <= 0)
+	{
+		bounds = {};
+		return;
+	}
+
+	XMVECTOR min = XMLoadFloat3(&verts[0].position);
+	XMVECTOR max = min;
+	for (int i = 1; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].position);
+		min = XMVectorMin(min, pos);
+		max = XMVectorMax(max, pos);
+	}
+
+	XMVECTOR center = (min + max) * 0.5f;
+
+	// The sphere must contain the actual vertices, which
+	// is usually tighter than the corner of the box
+	XMVECTOR radiusSq = XMVectorZero();
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].position);
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(pos - center));
+	}
+
+	XMStoreFloat3(&bounds.min, min);
+	XMStoreFloat3(&bounds.max, max);
+	XMStoreFloat3(&bounds.center, center);
+	bounds.radius = sqrtf(XMVectorGetX(radiusSq));
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// The CPU-side steps that turn a mesh file into MeshData,
+// ready for a Mesh to upload
+//
+// - LoadMeshData() reads the mesh cache, or parses the OBJ,
+//   calculates its tangents and bounds and rebuilds the cache
+// - CalculateTangents() works on four triangles at a time
+//   with SSE, and CalculateTangentsScalar() is its reference
+//
+// Needs no Direct3D device at all, so it's safe to call from
+// any thread, before a device exists.
+// --------------------------------------------------------
+class MeshBuilder {
+public:
+	static bool LoadMeshData(const char* filename, MeshData& meshData);
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	static void CalculateTangentsScalar(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	static void CalculateBounds(const Vertex* verts, int numVerts, MeshBounds& bounds);
+};
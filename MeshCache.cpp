@@ -0,0 +1,162 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#define MESH_CACHE_MAGIC 0x434D5844 // "DXMC"
+#define MESH_CACHE_FORMAT_VERSION 2
+
+// --------------------------------------------------------
+// Size, last write time and (optionally) a 64-bit FNV-1a
+// content hash of a file
+// --------------------------------------------------------
+static bool GetSourceInfo(const char* filename, bool computeHash, unsigned long long& size, unsigned long long& modifiedTime, unsigned long long& hash)
+{
+	if (!MappedFile::GetInfo(filename, size, modifiedTime))
+		return false;
+
+	hash = 0xCBF29CE484222325ull;
+	if (!computeHash || size == 0)
+		return true;
+
+	MappedFile file;
+	if (!file.Open(filename) || file.GetSize() != size)
+		return false;
+
+	const unsigned char* data = file.GetData();
+	for (unsigned long long i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3ull;
+	}
+	return true;
+}
+
+static std::string GetCacheFilename(const char* sourceFilename)
+{
+	return std::string(sourceFilename) + ".meshcache";
+}
+
+// --------------------------------------------------------
+// Overwrites the header at the start of an existing cache,
+// leaving the blobs after it alone
+// --------------------------------------------------------
+static bool RewriteHeader(const std::string& cacheFilename, const MeshCacheHeader& header)
+{
+	FILE* file = fopen(cacheFilename.c_str(), "r+b");
+	if (!file)
+		return false;
+
+	bool result = fwrite(&header, sizeof(MeshCacheHeader), 1, file) == 1;
+
+	return fclose(file) == 0 && result;
+}
+
+bool MeshCache::Load(const char* sourceFilename, MeshData& meshData)
+{
+	std::string cacheFilename = GetCacheFilename(sourceFilename);
+	MappedFile file;
+	if (!file.Open(cacheFilename.c_str()))
+		return false;
+
+	// Validate the header against this build and the source file
+	MeshCacheHeader header = {};
+	bool valid = file.GetSize() >= sizeof(MeshCacheHeader);
+	if (valid)
+	{
+		memcpy(&header, file.GetData(), sizeof(MeshCacheHeader));
+		valid =
+			header.magic == MESH_CACHE_MAGIC &&
+			header.formatVersion == MESH_CACHE_FORMAT_VERSION &&
+			header.vertexLayoutVersion == MESH_CACHE_VERTEX_LAYOUT_VERSION &&
+			header.generatorVersion == MESH_CACHE_GENERATOR_VERSION &&
+			header.vertexSize == sizeof(Vertex) &&
+			header.vertexCount > 0 &&
+			header.indexCount > 0;
+	}
+
+	// The file must hold exactly the blobs the header describes,
+	// so a truncated or corrupt cache is never read past its end
+	unsigned long long vertexBytes = (unsigned long long)sizeof(Vertex) * header.vertexCount;
+	unsigned long long indexBytes = (unsigned long long)sizeof(unsigned int) * header.indexCount;
+	if (valid)
+		valid = file.GetSize() == sizeof(MeshCacheHeader) + vertexBytes + indexBytes;
+
+	unsigned long long size = 0, modifiedTime = 0, hash = 0;
+	if (valid)
+		valid = GetSourceInfo(sourceFilename, false, size, modifiedTime, hash) && size == header.sourceSize;
+
+	// The source was touched but kept its size, so only
+	// a content change should invalidate the cache
+	bool touched = valid && modifiedTime != header.sourceModifiedTime;
+	if (touched)
+		valid = GetSourceInfo(sourceFilename, true, size, modifiedTime, hash) && hash == header.sourceHash;
+
+	// Copy the blobs straight into their final storage
+	if (valid)
+	{
+		const unsigned char* blobs = file.GetData() + sizeof(MeshCacheHeader);
+		meshData.vertices.resize(header.vertexCount);
+		meshData.indices.resize(header.indexCount);
+		meshData.bounds = header.bounds;
+		memcpy(&meshData.vertices[0], blobs, (size_t)vertexBytes);
+		memcpy(&meshData.indices[0], blobs + vertexBytes, (size_t)indexBytes);
+	}
+
+	file.Close();
+
+	if (!valid)
+	{
+		meshData.vertices.clear();
+		meshData.indices.clear();
+		return false;
+	}
+
+	// Record the new time, so later loads don't hash the
+	// source again.  If this fails they just keep hashing.
+	if (touched)
+	{
+		header.sourceModifiedTime = modifiedTime;
+		RewriteHeader(cacheFilename, header);
+	}
+
+	return true;
+}
+
+bool MeshCache::Save(const char* sourceFilename, const MeshData& meshData)
+{
+	if (meshData.vertices.empty() || meshData.indices.empty())
+		return false;
+
+	MeshCacheHeader header = {};
+	header.magic = MESH_CACHE_MAGIC;
+	header.formatVersion = MESH_CACHE_FORMAT_VERSION;
+	header.vertexLayoutVersion = MESH_CACHE_VERTEX_LAYOUT_VERSION;
+	header.generatorVersion = MESH_CACHE_GENERATOR_VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.vertexCount = (unsigned int)meshData.vertices.size();
+	header.indexCount = (unsigned int)meshData.indices.size();
+	header.bounds = meshData.bounds;
+
+	if (!GetSourceInfo(sourceFilename, true, header.sourceSize, header.sourceModifiedTime, header.sourceHash))
+		return false;
+
+	std::string cacheFilename = GetCacheFilename(sourceFilename);
+	FILE* file = fopen(cacheFilename.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool result =
+		fwrite(&header, sizeof(MeshCacheHeader), 1, file) == 1 &&
+		fwrite(&meshData.vertices[0], sizeof(Vertex), meshData.vertices.size(), file) == meshData.vertices.size() &&
+		fwrite(&meshData.indices[0], sizeof(unsigned int), meshData.indices.size(), file) == meshData.indices.size();
+
+	result = fclose(file) == 0 && result;
+
+	// Never leave a partial cache behind
+	if (!result)
+		remove(cacheFilename.c_str());
+
+	return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "MeshData.h"
+
+// Bump this whenever the layout of the Vertex struct changes,
+// so stale caches are rebuilt instead of being misread
+#define MESH_CACHE_VERTEX_LAYOUT_VERSION 1
+
+// Bump this whenever ObjLoader or
+// MeshBuilder::CalculateTangents() would produce different
+// vertices, indices or tangents for the same source, so
+// caches built by the old code are rebuilt even though
+// their layout still matches
+#define MESH_CACHE_GENERATOR_VERSION 1
+
+// --------------------------------------------------------
+// Header at the start of every binary mesh cache file.
+// It is followed by the vertex blob (laid out exactly as
+// Vertex.h) and then the index blob.
+// --------------------------------------------------------
+struct MeshCacheHeader
+{
+	unsigned int magic;
+	unsigned int formatVersion;
+	unsigned int vertexLayoutVersion;
+	unsigned int generatorVersion;
+	unsigned int vertexSize;
+
+	// Identity of the source file the cache was built from
+	unsigned long long sourceSize;
+	unsigned long long sourceModifiedTime;
+	unsigned long long sourceHash;
+
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	MeshBounds bounds;
+};
+
+// --------------------------------------------------------
+// Reads and writes binary mesh caches that sit next to
+// their source files (e.g. "cube.obj" -> "cube.obj.meshcache")
+//
+// A cache is only used while the source file's size and
+// modified time (or, failing that, its content hash) match
+// what was recorded when the cache was written, and while
+// the Vertex layout and generator versions are unchanged.  When only the
+// time changed, the new one is written back to the cache so
+// the source isn't hashed again on every load.  A cache whose
+// size doesn't match its header is never read.
+// --------------------------------------------------------
+class MeshCache {
+public:
+	static bool Load(const char* sourceFilename, MeshData& meshData);
+	static bool Save(const char* sourceFilename, const MeshData& meshData);
+};
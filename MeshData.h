@@ -0,0 +1,27 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Local-space bounding volumes of a mesh
+// --------------------------------------------------------
+struct MeshBounds
+{
+	DirectX::XMFLOAT3 min;		// Axis-aligned box
+	DirectX::XMFLOAT3 max;
+	DirectX::XMFLOAT3 center;	// Bounding sphere
+	float radius;
+};
+
+// --------------------------------------------------------
+// CPU-side geometry produced by a mesh loader, before
+// any Direct3D resources have been created from it
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	MeshBounds bounds;
+};
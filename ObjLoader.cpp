@@ -0,0 +1,431 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include <math.h>
+#include <string.h>
+#include <unordered_map>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Larger integers are clamped to this, which no index can
+// reach and which already over- or underflows any float
+static const int MaxScannedInt = 1000000000;
+
+// Exactly representable powers of ten used by the float scanner
+static const double PowersOfTen[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+static bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && IsSpace(*p))
+		p++;
+	return p;
+}
+
+static const char* NextLine(const char* p, const char* end)
+{
+	const char* newline = (const char*)memchr(p, '\n', end - p);
+	return newline ? newline + 1 : end;
+}
+
+// --------------------------------------------------------
+// Scans a signed decimal integer starting at p
+//
+// Returns a pointer just past the number, or null if
+// there were no digits to read.  Every digit is consumed,
+// but the value stops growing at MaxScannedInt.
+// --------------------------------------------------------
+static const char* ScanInt(const char* p, const char* end, int* result)
+{
+	p = SkipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	if (p == end || !IsDigit(*p))
+		return 0;
+
+	int value = 0;
+	while (p < end && IsDigit(*p))
+	{
+		value = value < MaxScannedInt / 10 ? value * 10 + (*p - '0') : MaxScannedInt;
+		p++;
+	}
+
+	*result = negative ? -value : value;
+	return p;
+}
+
+// --------------------------------------------------------
+// Scans a decimal floating point number (with optional
+// fraction and exponent) starting at p
+//
+// Returns a pointer just past the number, or null if
+// there were no digits to read
+// --------------------------------------------------------
+static const char* ScanFloat(const char* p, const char* end, float* result)
+{
+	p = SkipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	// Gather up to 19 significant digits into an integer
+	// mantissa, tracking the decimal exponent separately
+	unsigned long long mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while (p < end && IsDigit(*p))
+	{
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0) significantDigits++;
+		}
+		else
+		{
+			exponent++;
+		}
+		anyDigits = true;
+		p++;
+	}
+
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && IsDigit(*p))
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) significantDigits++;
+				exponent--;
+			}
+			anyDigits = true;
+			p++;
+		}
+	}
+
+	if (!anyDigits)
+		return 0;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		int explicitExponent = 0;
+		const char* afterExponent = ScanInt(p + 1, end, &explicitExponent);
+		if (afterExponent)
+		{
+			exponent += explicitExponent;
+			p = afterExponent;
+		}
+	}
+
+	// Scale by the exponent, using exact powers of ten where possible
+	double value = (double)mantissa;
+	if (exponent < 0)
+		value = -exponent <= 22 ? value / PowersOfTen[-exponent] : value * pow(10.0, exponent);
+	else if (exponent > 0)
+		value = exponent <= 22 ? value * PowersOfTen[exponent] : value * pow(10.0, exponent);
+
+	*result = (float)(negative ? -value : value);
+	return p;
+}
+
+// --------------------------------------------------------
+// Scans one face corner in any of the OBJ forms:
+//  p, p/t, p//n or p/t/n
+//
+// Missing indices are reported as zero, which is never
+// a valid OBJ index
+// --------------------------------------------------------
+static const char* ScanFaceCorner(const char* p, const char* end, int corner[3])
+{
+	corner[1] = 0;
+	corner[2] = 0;
+
+	p = ScanInt(p, end, &corner[0]);
+	if (!p) return 0;
+
+	if (p < end && *p == '/')
+	{
+		p++;
+		if (p < end && *p != '/')
+		{
+			p = ScanInt(p, end, &corner[1]);
+			if (!p) return 0;
+		}
+
+		if (p < end && *p == '/')
+		{
+			p = ScanInt(p + 1, end, &corner[2]);
+			if (!p) return 0;
+		}
+	}
+
+	return p;
+}
+
+// --------------------------------------------------------
+// Converts a 1-based (or negative, relative) OBJ index to
+// a 0-based index, or -1 if it is missing or out of range
+// --------------------------------------------------------
+static int ResolveIndex(int index, size_t count)
+{
+	if (index > 0)
+		return (size_t)index <= count ? index - 1 : -1;
+	if (index < 0)
+		return (size_t)(-index) <= count ? (int)count + index : -1;
+	return -1;
+}
+
+// --------------------------------------------------------
+// The resolved position/uv/normal indices of a face corner,
+// which uniquely identify an output vertex
+// --------------------------------------------------------
+struct VertexKey
+{
+	int position;
+	int uv;
+	int normal;
+
+	bool operator==(const VertexKey& other) const
+	{
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+struct VertexKeyHash
+{
+	size_t operator()(const VertexKey& key) const
+	{
+		// Mix the three indices with large odd multipliers
+		unsigned long long h = (unsigned long long)(unsigned int)key.position * 0x9E3779B97F4A7C15ull;
+		h ^= (unsigned long long)(unsigned int)key.uv * 0xC2B2AE3D27D4EB4Full;
+		h ^= (unsigned long long)(unsigned int)key.normal * 0x165667B19E3779F9ull;
+		return (size_t)(h ^ (h >> 29));
+	}
+};
+
+// --------------------------------------------------------
+// Assembles a single vertex from resolved face corner indices,
+// converting it from OBJ's right-handed space to DirectX's
+// left-handed one
+// --------------------------------------------------------
+static Vertex BuildVertex(
+	const VertexKey& key,
+	const std::vector<XMFLOAT3>& positions,
+	const std::vector<XMFLOAT2>& uvs,
+	const std::vector<XMFLOAT3>& normals)
+{
+	// Files without UVs or normals still load, using
+	// a zero UV and a zero normal for every vertex
+	Vertex vertex;
+	vertex.position = positions[key.position];
+	vertex.uv = key.uv >= 0 ? uvs[key.uv] : XMFLOAT2(0, 0);
+	vertex.normal = key.normal >= 0 ? normals[key.normal] : XMFLOAT3(0, 0, 0);
+	vertex.tangent = XMFLOAT3(0, 0, 0);
+
+	// The model is most likely in a right-handed space,
+	// especially if it came from Maya.  We want to convert
+	// to a left-handed space for DirectX.  This means we
+	// need to:
+	//  - Invert the Z position
+	//  - Invert the normal's Z
+	//  - Flip the winding order (done by the caller)
+	// We also need to flip the UV coordinate since DirectX
+	// defines (0,0) as the top left of the texture, and many
+	// 3D modeling packages use the bottom left as (0,0)
+	vertex.uv.y = 1.0f - vertex.uv.y;
+	vertex.position.z *= -1.0f;
+	vertex.normal.z *= -1.0f;
+	return vertex;
+}
+
+bool ObjLoader::Load(const char* filename, MeshData& meshData)
+{
+	// Map the whole file read-only so the parser can walk it
+	// directly, without copying it through a stream
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+
+	return Parse((const char*)file.GetData(), file.GetSize(), meshData);
+}
+
+bool ObjLoader::Parse(const char* data, size_t size, MeshData& meshData)
+{
+	const char* end = data + size;
+
+	// First pass: count everything so no vector
+	// ever has to grow while we're parsing
+	size_t positionCount = 0;
+	size_t normalCount = 0;
+	size_t uvCount = 0;
+	size_t triangleCount = 0;
+
+	for (const char* line = data; line < end; line = NextLine(line, end))
+	{
+		const char* p = SkipSpaces(line, end);
+		if (end - p < 2)
+			continue;
+
+		if (p[0] == 'v' && IsSpace(p[1])) positionCount++;
+		else if (p[0] == 'v' && p[1] == 'n') normalCount++;
+		else if (p[0] == 'v' && p[1] == 't') uvCount++;
+		else if (p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Count the corners of the face, which
+			// become (corners - 2) fan triangles
+			size_t corners = 0;
+			bool inToken = false;
+			for (p++; p < end && *p != '\n'; p++)
+			{
+				bool space = IsSpace(*p);
+				if (!space && !inToken) corners++;
+				inToken = !space;
+			}
+
+			if (corners >= 3)
+				triangleCount += corners - 2;
+		}
+	}
+
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;			// UVs from the file
+	positions.reserve(positionCount);
+	normals.reserve(normalCount);
+	uvs.reserve(uvCount);
+
+	std::vector<Vertex>& verts = meshData.vertices;
+	std::vector<unsigned int>& indices = meshData.indices;
+	verts.clear();
+	indices.clear();
+	indices.reserve(triangleCount * 3);
+
+	// Shared corners are merged, so the final vertex count is usually
+	// close to the largest of the position/uv/normal counts rather
+	// than three per triangle
+	size_t expectedVerts = positionCount;
+	if (uvCount > expectedVerts) expectedVerts = uvCount;
+	if (normalCount > expectedVerts) expectedVerts = normalCount;
+
+	std::unordered_map<VertexKey, unsigned int, VertexKeyHash> uniqueVerts;
+	uniqueVerts.reserve(expectedVerts);
+	verts.reserve(expectedVerts);
+
+	// Second pass: the actual parse
+	for (const char* line = data; line < end; line = NextLine(line, end))
+	{
+		const char* p = SkipSpaces(line, end);
+		if (end - p < 2)
+			continue;
+
+		if (p[0] == 'v' && IsSpace(p[1]))
+		{
+			XMFLOAT3 pos(0, 0, 0);
+			p = ScanFloat(p + 1, end, &pos.x);
+			if (p) p = ScanFloat(p, end, &pos.y);
+			if (p) p = ScanFloat(p, end, &pos.z);
+			positions.push_back(pos);
+		}
+		else if (p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm(0, 0, 0);
+			p = ScanFloat(p + 2, end, &norm.x);
+			if (p) p = ScanFloat(p, end, &norm.y);
+			if (p) p = ScanFloat(p, end, &norm.z);
+			normals.push_back(norm);
+		}
+		else if (p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2 uv(0, 0);
+			p = ScanFloat(p + 2, end, &uv.x);
+			if (p) p = ScanFloat(p, end, &uv.y);
+			uvs.push_back(uv);
+		}
+		else if (p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Faces are triangulated as a fan around their first
+			// corner, flipping the winding order as we go.  For a
+			// quad this gives (1, 3, 2) and (1, 4, 3)
+			unsigned int first = 0, previous = 0, current = 0;
+			int corner[3];
+			int cornerCount = 0;
+
+			p++;
+			while (true)
+			{
+				p = SkipSpaces(p, end);
+				if (p == end || *p == '\n')
+					break;
+
+				p = ScanFaceCorner(p, end, corner);
+				if (!p)
+					break;
+
+				// A position is required, and an index that's there
+				// has to point at something, or the face would end
+				// up silently cut short
+				VertexKey key;
+				key.position = ResolveIndex(corner[0], positions.size());
+				key.uv = ResolveIndex(corner[1], uvs.size());
+				key.normal = ResolveIndex(corner[2], normals.size());
+				if (key.position < 0 ||
+					(corner[1] != 0 && key.uv < 0) ||
+					(corner[2] != 0 && key.normal < 0))
+				{
+					p = 0;
+					break;
+				}
+
+				// Each unique position/uv/normal combination
+				// becomes exactly one vertex in the output
+				std::pair<std::unordered_map<VertexKey, unsigned int, VertexKeyHash>::iterator, bool> result =
+					uniqueVerts.insert(std::make_pair(key, (unsigned int)verts.size()));
+				if (result.second)
+					verts.push_back(BuildVertex(key, positions, uvs, normals));
+				current = result.first->second;
+
+				if (cornerCount == 0)
+					first = current;
+				else if (cornerCount >= 2)
+				{
+					indices.push_back(first);
+					indices.push_back(current);
+					indices.push_back(previous);
+				}
+
+				previous = current;
+				cornerCount++;
+			}
+
+			// Bail on malformed faces rather than guessing
+			if (!p)
+				return false;
+		}
+	}
+
+	return !indices.empty();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Loads Wavefront OBJ files by memory-mapping them and
+// tokenizing the mapped bytes in place
+//
+// - Load() handles the file mapping, Parse() does the work
+//   and can be used on any buffer already in memory
+// - Numbers are scanned by hand, so parsing is independent
+//   of the current C locale and has no line length limit
+// - A face with a zero or out of range index fails the
+//   whole load, rather than being cut short
+// --------------------------------------------------------
+class ObjLoader {
+public:
+	static bool Load(const char* filename, MeshData& meshData);
+	static bool Parse(const char* data, size_t size, MeshData& meshData);
+};
@@ -1,6 +1,31 @@
 #include "ShaderStructs.hlsli"
 #include "Lighting.hlsli"
 
+// Features this shader can be compiled with or without.  The
+// defaults are the full shader (PixelShader.cso); every other
+// combination is compiled into PixelShader.shaderpack, so a
+// new define must be added to ShaderPermutations.h too
+#ifndef NORMAL_MAP
+#define NORMAL_MAP			1
+#endif
+
+#ifndef EMISSIVE
+#define EMISSIVE			1
+#endif
+
+#ifndef LIGHTING_PBR
+#define LIGHTING_PBR		1	// Blinn-Phong when 0
+#endif
+
+// Must match LightCountClass in ShaderPermutations.h
+#define LIGHT_COUNT_NONE		0	// Ambient (and emissive) only
+#define LIGHT_COUNT_SINGLE		1	// Just lights[0], no cluster lookup
+#define LIGHT_COUNT_CLUSTERED	2
+
+#ifndef LIGHT_COUNT_CLASS
+#define LIGHT_COUNT_CLASS	LIGHT_COUNT_CLUSTERED
+#endif
+
 Texture2D AlbedoMap			: register(t0);
 Texture2D EmissiveMap		: register(t1);
 Texture2D RoughMap			: register(t2);
@@ -8,19 +33,70 @@ Texture2D MetalMap			: register(t3);
 Texture2D NormalMap			: register(t4);
 SamplerState BasicSampler	: register(s0);
 
-cbuffer ExternalData : register(b0) {
-	Light lights[MAX_LIGHTS];
-	int lightCount;
+// Where one cluster's lights start in lightIndices, and how
+// many there are.  Must match LightCluster in LightClusters.h
+struct LightCluster
+{
+	uint offset;
+	uint count;
+};
 
+// Every light in the scene, and the ones that can reach each
+// cluster of the view frustum, uploaded once per frame
+StructuredBuffer<Light> lights					: register(t5);
+StructuredBuffer<LightCluster> lightClusters	: register(t6);
+StructuredBuffer<uint> lightIndices				: register(t7);
+
+// Set once per frame
+cbuffer PerFrame : register(b0) {
 	float3 ambient;
+	float clusterDepthScale;
 
 	float3 cameraPosition;
+	float clusterDepthBias;
+
+	float2 clusterTileScale;	// Tiles per pixel
+}
 
+// Set when the material changes
+cbuffer PerMaterial : register(b1) {
 	float4 colorTint;
 	float2 uvScale;
 	float2 uvOffset;
 }
 
+// --------------------------------------------------------
+// One light's contribution to the surface
+// --------------------------------------------------------
+float3 LightSurface(Light light, float3 normal, float3 worldPos, float roughness, float metal, float3 surfaceColor, float3 specColor)
+{
+	light.Direction = normalize(light.Direction);
+
+#if LIGHTING_PBR
+	switch (light.Type) {
+		case LIGHT_TYPE_DIRECTIONAL:
+			return DirLightPBR(light, normal, worldPos, cameraPosition, roughness, metal, surfaceColor, specColor);
+		case LIGHT_TYPE_POINT:
+			return PointLightPBR(light, normal, worldPos, cameraPosition, roughness, metal, surfaceColor, specColor);
+		case LIGHT_TYPE_SPOT:
+			return SpotLightPBR(light, normal, worldPos, cameraPosition, roughness, metal, surfaceColor, specColor);
+	}
+#else
+	// Blinn-Phong has no metalness, so every surface gets a
+	// full strength (untinted) highlight
+	switch (light.Type) {
+		case LIGHT_TYPE_DIRECTIONAL:
+			return DirLight(light, normal, worldPos, cameraPosition, roughness, surfaceColor, 1.0f);
+		case LIGHT_TYPE_POINT:
+			return PointLight(light, normal, worldPos, cameraPosition, roughness, surfaceColor, 1.0f);
+		case LIGHT_TYPE_SPOT:
+			return SpotLight(light, normal, worldPos, cameraPosition, roughness, surfaceColor, 1.0f);
+	}
+#endif
+
+	return float3(0, 0, 0);
+}
+
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
 // 
@@ -37,8 +113,9 @@ float4 main(VertexToPixel input) : SV_TARGET
 	input.uv = input.uv * uvScale + uvOffset;
 
 	// Normal Mapping
-	float3 normalMap = NormalMapping(NormalMap, BasicSampler, input.uv, input.normal, input.tangent);
-	input.normal = normalMap;
+#if NORMAL_MAP
+	input.normal = NormalMapping(NormalMap, BasicSampler, input.uv, input.normal, input.tangent);
+#endif
 
 	// Roughness Mapping
 	float roughness = RoughMap.Sample(BasicSampler, input.uv).r;
@@ -54,26 +131,26 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float3 specColor = lerp(F0_NON_METAL.rrr, surfaceColor.rgb, metal);
 
 	// Ambient Color
-	float3 totalLight = EmissiveMap.Sample(BasicSampler, input.uv) + ambient * surfaceColor.rgb;
-
-	// Lights
-	for (int i = 0; i < lightCount; i++) {
-		Light light = lights[i];
-		light.Direction = normalize(light.Direction);
-
-		switch (light.Type) {
-			case LIGHT_TYPE_DIRECTIONAL:
-				totalLight += DirLightPBR(light, input.normal, input.worldPos, cameraPosition, roughness, metal, surfaceColor.rgb, specColor);
-				break;
-			case LIGHT_TYPE_POINT:
-				totalLight += PointLightPBR(light, input.normal, input.worldPos, cameraPosition, roughness, metal, surfaceColor.rgb, specColor);
-				break;
-			case LIGHT_TYPE_SPOT:
-				totalLight += SpotLightPBR(light, input.normal, input.worldPos, cameraPosition, roughness, metal, surfaceColor.rgb, specColor);
-				break;
-		}
-	}
+	float3 totalLight = ambient * surfaceColor.rgb;
+#if EMISSIVE
+	totalLight += EmissiveMap.Sample(BasicSampler, input.uv).rgb;
+#endif
+
+#if LIGHT_COUNT_CLASS == LIGHT_COUNT_SINGLE
+	totalLight += LightSurface(lights[0], input.normal, input.worldPos, roughness, metal, surfaceColor.rgb, specColor);
+#elif LIGHT_COUNT_CLASS == LIGHT_COUNT_CLUSTERED
+	// Only the lights that can reach this pixel's cluster
+	// (SV_POSITION's w is the view space depth)
+	uint3 cluster;
+	cluster.xy = min((uint2)(input.screenPosition.xy * clusterTileScale), uint2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+	cluster.z = (uint)clamp(floor(log2(input.screenPosition.w) * clusterDepthScale + clusterDepthBias), 0, CLUSTER_SLICES - 1);
+	LightCluster lightCluster = lightClusters[(cluster.z * CLUSTER_TILES_Y + cluster.y) * CLUSTER_TILES_X + cluster.x];
+
+	for (uint i = 0; i < lightCluster.count; i++)
+		totalLight += LightSurface(lights[lightIndices[lightCluster.offset + i]], input.normal, input.worldPos, roughness, metal, surfaceColor.rgb, specColor);
+#endif
 
-	float3 final = pow(totalLight, 1.0f / 2.2f);
-	return float4(final, 1);
+	// Linear, since BloomCombinePS tonemaps and encodes the
+	// whole scene at the end
+	return float4(totalLight, 1);
 }
\ No newline at end of file
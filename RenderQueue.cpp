@@ -0,0 +1,317 @@
+#include "RenderQueue.h"
+#include <string.h>
+
+RecordingCommandList::RecordingCommandList()
+{
+	this->Clear();
+}
+
+// Pass changes aren't binds, so they don't count as one
+void RecordingCommandList::SetPass(RenderPass pass)
+{
+	RenderCommand command = { RENDER_COMMAND_SET_PASS, 0, 0, 0, pass };
+	this->commands.push_back(command);
+}
+
+void RecordingCommandList::SetShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+{
+	RenderCommand command = { RENDER_COMMAND_SET_SHADERS, pixelShader, 0, 0 };
+	this->commands.push_back(command);
+
+	this->bindCount++;
+	if (vertexShader == this->boundVertexShader && pixelShader == this->boundPixelShader)
+	{
+		this->redundantBindCount++;
+		return;
+	}
+
+	// Material data lives in the shaders, so it goes too
+	this->boundVertexShader = vertexShader;
+	this->boundPixelShader = pixelShader;
+	this->boundMaterial = 0;
+}
+
+void RecordingCommandList::SetMaterial(Material* material)
+{
+	RenderCommand command = { RENDER_COMMAND_SET_MATERIAL, material, 0, 0 };
+	this->commands.push_back(command);
+
+	this->bindCount++;
+	if (material == this->boundMaterial)
+		this->redundantBindCount++;
+
+	this->boundMaterial = material;
+}
+
+void RecordingCommandList::SetMesh(Mesh* mesh)
+{
+	RenderCommand command = { RENDER_COMMAND_SET_MESH, mesh, 0, 0 };
+	this->commands.push_back(command);
+
+	this->bindCount++;
+	if (mesh == this->boundMesh)
+		this->redundantBindCount++;
+
+	this->boundMesh = mesh;
+}
+
+void RecordingCommandList::Draw(const unsigned int* entityIndices, unsigned int count)
+{
+	RenderCommand command = { RENDER_COMMAND_DRAW, 0, entityIndices[0], count };
+	this->commands.push_back(command);
+	this->drawCount++;
+	this->instanceCount += count;
+}
+
+void RecordingCommandList::Clear()
+{
+	this->commands.clear();
+	this->boundVertexShader = 0;
+	this->boundPixelShader = 0;
+	this->boundMaterial = 0;
+	this->boundMesh = 0;
+	this->bindCount = 0;
+	this->redundantBindCount = 0;
+	this->drawCount = 0;
+	this->instanceCount = 0;
+}
+
+const std::vector<RenderCommand>& RecordingCommandList::GetCommands()
+{
+	return this->commands;
+}
+
+unsigned int RecordingCommandList::GetBindCount()
+{
+	return this->bindCount;
+}
+
+unsigned int RecordingCommandList::GetRedundantBindCount()
+{
+	return this->redundantBindCount;
+}
+
+unsigned int RecordingCommandList::GetDrawCount()
+{
+	return this->drawCount;
+}
+
+unsigned int RecordingCommandList::GetInstanceCount()
+{
+	return this->instanceCount;
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Clear()
+{
+	this->items.clear();
+	this->keys.clear();
+	this->order.clear();
+}
+
+void RenderQueue::Reserve(unsigned int drawCount)
+{
+	this->items.reserve(drawCount);
+	this->keys.reserve(drawCount);
+	this->order.reserve(drawCount);
+	this->scratchKeys.reserve(drawCount);
+	this->scratchOrder.reserve(drawCount);
+}
+
+// --------------------------------------------------------
+// Queues one draw.  Items are submitted in the order they
+// were added until Sort() is called.
+//
+// sortIDs   - IDs of the shaders, material and mesh
+// viewDepth - Distance along the camera's forward axis
+// --------------------------------------------------------
+void RenderQueue::Add(
+	RenderPass pass,
+	SimpleVertexShader* vertexShader,
+	SimplePixelShader* pixelShader,
+	Material* material,
+	Mesh* mesh,
+	const RenderSortIDs& sortIDs,
+	float viewDepth,
+	unsigned int entityIndex)
+{
+	Item item = { pass, vertexShader, pixelShader, material, mesh, entityIndex };
+	unsigned int shaderID = ((sortIDs.vertexShader & 0x3F) << 6) | (sortIDs.pixelShader & 0x3F);
+
+	this->order.push_back((unsigned int)this->items.size());
+	this->items.push_back(item);
+	this->keys.push_back(MakeKey(pass, shaderID, sortIDs.material, sortIDs.mesh, viewDepth));
+}
+
+// --------------------------------------------------------
+// Sorts the queued draws by key with an LSD radix sort, one
+// byte per pass.  All eight histograms are built in a single
+// read of the keys, and passes where every key has the same
+// byte (common for the high, pass and shader bytes) are
+// skipped.  Equal keys keep the order they were added in.
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	unsigned int count = (unsigned int)this->keys.size();
+	if (count < 2)
+		return;
+
+	unsigned int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned long long key = this->keys[i];
+		for (int b = 0; b < 8; b++)
+			histograms[b][(key >> (b * 8)) & 0xFF]++;
+	}
+
+	this->scratchKeys.resize(count);
+	this->scratchOrder.resize(count);
+
+	for (int b = 0; b < 8; b++)
+	{
+		unsigned int* histogram = histograms[b];
+		int shift = b * 8;
+		if (histogram[(this->keys[0] >> shift) & 0xFF] == count)
+			continue;
+
+		// Counts -> starting offsets
+		unsigned int offset = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			unsigned int digitCount = histogram[d];
+			histogram[d] = offset;
+			offset += digitCount;
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned long long key = this->keys[i];
+			unsigned int destination = histogram[(key >> shift) & 0xFF]++;
+			this->scratchKeys[destination] = key;
+			this->scratchOrder[destination] = this->order[i];
+		}
+
+		this->keys.swap(this->scratchKeys);
+		this->order.swap(this->scratchOrder);
+	}
+}
+
+// --------------------------------------------------------
+// Walks the queue in order, setting only the state that
+// differs from the previous draw, and drawing each run of
+// entities with identical state (pass included) at once.
+// Material data lives in the shaders, so a shader change
+// always re-sets the material too.
+// --------------------------------------------------------
+void RenderQueue::Submit(RenderCommandList& commandList)
+{
+	RenderPass pass = RENDER_PASS_OPAQUE;
+	SimpleVertexShader* vertexShader = 0;
+	SimplePixelShader* pixelShader = 0;
+	Material* material = 0;
+	Mesh* mesh = 0;
+
+	this->runEntityIndices.clear();
+	for (unsigned int i = 0; i < this->order.size(); i++)
+	{
+		const Item& item = this->items[this->order[i]];
+
+		bool sameState =
+			i > 0 &&
+			item.pass == pass &&
+			item.vertexShader == vertexShader &&
+			item.pixelShader == pixelShader &&
+			item.material == material &&
+			item.mesh == mesh;
+		if (sameState)
+		{
+			this->runEntityIndices.push_back(item.entityIndex);
+			continue;
+		}
+
+		// The previous run is complete
+		if (!this->runEntityIndices.empty())
+		{
+			commandList.Draw(&this->runEntityIndices[0], (unsigned int)this->runEntityIndices.size());
+			this->runEntityIndices.clear();
+		}
+
+		if (i == 0 || item.pass != pass)
+		{
+			pass = item.pass;
+			commandList.SetPass(pass);
+		}
+
+		if (item.vertexShader != vertexShader || item.pixelShader != pixelShader)
+		{
+			vertexShader = item.vertexShader;
+			pixelShader = item.pixelShader;
+			material = 0;
+			commandList.SetShaders(vertexShader, pixelShader);
+		}
+
+		if (item.material != material)
+		{
+			material = item.material;
+			commandList.SetMaterial(material);
+		}
+
+		if (item.mesh != mesh)
+		{
+			mesh = item.mesh;
+			commandList.SetMesh(mesh);
+		}
+
+		this->runEntityIndices.push_back(item.entityIndex);
+	}
+
+	if (!this->runEntityIndices.empty())
+		commandList.Draw(&this->runEntityIndices[0], (unsigned int)this->runEntityIndices.size());
+}
+
+unsigned int RenderQueue::GetCount()
+{
+	return (unsigned int)this->items.size();
+}
+
+// --------------------------------------------------------
+// Packs a draw's state into a sort key (see RenderQueue.h).
+// The depth field is the top 16 bits of the float: for
+// non-negative floats the bit patterns sort like the values,
+// so this is a coarse but ordered depth with no range to
+// configure.  Inverting those bits sorts back to front.
+// --------------------------------------------------------
+unsigned long long RenderQueue::MakeKey(unsigned int pass, unsigned int shaderID, unsigned int materialID, unsigned int meshID, float viewDepth)
+{
+	// Behind the camera (or NaN) counts as nearest
+	if (!(viewDepth > 0.0f))
+		viewDepth = 0.0f;
+
+	unsigned int depthBits;
+	memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+
+	if (pass == RENDER_PASS_TRANSPARENT)
+	{
+		return
+			((unsigned long long)(pass & 0xF) << 60) |
+			((unsigned long long)(~depthBits >> 16) << 44) |
+			((unsigned long long)(shaderID & 0xFFF) << 32) |
+			((unsigned long long)(materialID & 0xFFFF) << 16) |
+			(unsigned long long)(meshID & 0xFFFF);
+	}
+
+	return
+		((unsigned long long)(pass & 0xF) << 60) |
+		((unsigned long long)(shaderID & 0xFFF) << 48) |
+		((unsigned long long)(materialID & 0xFFFF) << 32) |
+		((unsigned long long)(meshID & 0xFFFF) << 16) |
+		(unsigned long long)(depthBits >> 16);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+
+class SimpleVertexShader;
+class SimplePixelShader;
+class Material;
+class Mesh;
+
+// Passes, in the order they're drawn (4 bits of the key)
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE = 0,
+	RENDER_PASS_TRANSPARENT = 1
+};
+
+// --------------------------------------------------------
+// Sort IDs of a draw's state: each object's GetID(), which
+// is never reused, so keys don't depend on where objects
+// happen to live in memory
+// --------------------------------------------------------
+struct RenderSortIDs
+{
+	unsigned int vertexShader;
+	unsigned int pixelShader;
+	unsigned int material;
+	unsigned int mesh;
+};
+
+// --------------------------------------------------------
+// Receives the state changes and draws of a sorted queue.
+// The queue only calls a Set method when that state is
+// different from what it last set, and passes every run of
+// entities that share all state to a single Draw(), so they
+// can be drawn with one instanced draw.  SetPass() comes
+// before the first draw and whenever the pass changes, so
+// the list can switch its blend and depth states.
+// --------------------------------------------------------
+class RenderCommandList {
+public:
+	virtual ~RenderCommandList() {}
+
+	virtual void SetPass(RenderPass pass) = 0;
+	virtual void SetShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader) = 0;
+	virtual void SetMaterial(Material* material) = 0;
+	virtual void SetMesh(Mesh* mesh) = 0;
+	virtual void Draw(const unsigned int* entityIndices, unsigned int count) = 0;
+};
+
+enum RenderCommandType
+{
+	RENDER_COMMAND_SET_PASS,
+	RENDER_COMMAND_SET_SHADERS,
+	RENDER_COMMAND_SET_MATERIAL,
+	RENDER_COMMAND_SET_MESH,
+	RENDER_COMMAND_DRAW
+};
+
+struct RenderCommand
+{
+	RenderCommandType type;
+	const void* state;			// Pixel shader, material or mesh
+	unsigned int entityIndex;	// Draws only: the first entity
+	unsigned int count;			// Draws only: how many entities
+	RenderPass pass;			// Pass changes only
+};
+
+// --------------------------------------------------------
+// Command list that only records what it's given, so a
+// queue's output can be inspected without a GPU.  Counts
+// binds of state that was already bound as redundant.
+// --------------------------------------------------------
+class RecordingCommandList : public RenderCommandList {
+public:
+	RecordingCommandList();
+
+	void SetPass(RenderPass pass);
+	void SetShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader);
+	void SetMaterial(Material* material);
+	void SetMesh(Mesh* mesh);
+	void Draw(const unsigned int* entityIndices, unsigned int count);
+
+	void Clear();
+	const std::vector<RenderCommand>& GetCommands();
+	unsigned int GetBindCount();
+	unsigned int GetRedundantBindCount();
+	unsigned int GetDrawCount();
+	unsigned int GetInstanceCount();
+
+private:
+	std::vector<RenderCommand> commands;
+	SimpleVertexShader* boundVertexShader;
+	SimplePixelShader* boundPixelShader;
+	Material* boundMaterial;
+	Mesh* boundMesh;
+	unsigned int bindCount;
+	unsigned int redundantBindCount;
+	unsigned int drawCount;
+	unsigned int instanceCount;
+};
+
+// --------------------------------------------------------
+// Collects a frame's draws and issues them in an order that
+// minimizes state changes
+//
+// Each opaque draw gets a 64-bit key, most significant first:
+//   pass (4) | shaders (12) | material (16) | mesh (16) | depth (16)
+// so sorting the keys groups by pass, then shaders, then
+// material, then mesh, front to back within a mesh.
+//
+// Transparent draws have to blend back to front regardless
+// of their state, so their depth comes first, inverted:
+//   pass (4) | ~depth (16) | shaders (12) | material (16) | mesh (16)
+//
+// The shader field holds 6 bits of each shader's ID.  IDs
+// that don't fit their field wrap around; that only makes
+// the grouping worse, since Submit() compares the actual
+// state.
+// --------------------------------------------------------
+class RenderQueue {
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	void Clear();
+	void Reserve(unsigned int drawCount);
+	void Add(
+		RenderPass pass,
+		SimpleVertexShader* vertexShader,
+		SimplePixelShader* pixelShader,
+		Material* material,
+		Mesh* mesh,
+		const RenderSortIDs& sortIDs,
+		float viewDepth,
+		unsigned int entityIndex);
+
+	void Sort();
+	void Submit(RenderCommandList& commandList);
+	unsigned int GetCount();
+
+	static unsigned long long MakeKey(unsigned int pass, unsigned int shaderID, unsigned int materialID, unsigned int meshID, float viewDepth);
+
+private:
+	struct Item
+	{
+		RenderPass pass;
+		SimpleVertexShader* vertexShader;
+		SimplePixelShader* pixelShader;
+		Material* material;
+		Mesh* mesh;
+		unsigned int entityIndex;
+	};
+
+	std::vector<Item> items;
+
+	// Keys and item indices, in submission order once sorted,
+	// and the radix sort's second buffers
+	std::vector<unsigned long long> keys;
+	std::vector<unsigned int> order;
+	std::vector<unsigned long long> scratchKeys;
+	std::vector<unsigned int> scratchOrder;
+
+	// Entity indices of the run Submit() is collecting
+	std::vector<unsigned int> runEntityIndices;
+};
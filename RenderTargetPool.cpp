@@ -0,0 +1,190 @@
+#include "RenderTargetPool.h"
+
+RenderTargetPool::RenderTargetPool()
+{
+	this->frame = 0;
+	this->createCount = 0;
+	this->allocatedBytes = 0;
+	this->peakBytes = 0;
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+}
+
+// --------------------------------------------------------
+// Frees anything still acquired (transient targets never
+// outlive a frame), then destroys targets the last frame
+// didn't use
+// --------------------------------------------------------
+void RenderTargetPool::BeginFrame()
+{
+	for (unsigned int i = 0; i < this->slots.size(); i++)
+	{
+		Slot& slot = this->slots[i];
+		if (!slot.alive)
+			continue;
+
+		slot.inUse = false;
+		if (slot.lastUsedFrame != this->frame)
+			this->Destroy(i);
+	}
+
+	this->frame++;
+}
+
+// --------------------------------------------------------
+// Returns a target of this size and format, reusing the
+// first free one that matches
+// --------------------------------------------------------
+unsigned int RenderTargetPool::Acquire(unsigned int width, unsigned int height, DXGI_FORMAT format)
+{
+	unsigned int deadSlot = (unsigned int)this->slots.size();
+	for (unsigned int i = 0; i < this->slots.size(); i++)
+	{
+		Slot& slot = this->slots[i];
+		if (!slot.alive)
+		{
+			if (deadSlot == this->slots.size())
+				deadSlot = i;
+			continue;
+		}
+
+		if (!slot.inUse &&
+			slot.desc.width == width &&
+			slot.desc.height == height &&
+			slot.desc.format == format)
+		{
+			slot.inUse = true;
+			slot.lastUsedFrame = this->frame;
+			return i;
+		}
+	}
+
+	if (deadSlot == this->slots.size())
+		this->slots.push_back(Slot());
+
+	Slot& slot = this->slots[deadSlot];
+	slot.desc.width = width;
+	slot.desc.height = height;
+	slot.desc.format = format;
+	slot.alive = true;
+	slot.inUse = true;
+	slot.lastUsedFrame = this->frame;
+
+	this->createCount++;
+	this->allocatedBytes += GetBytes(slot.desc);
+	if (this->allocatedBytes > this->peakBytes)
+		this->peakBytes = this->allocatedBytes;
+
+	this->CreateTarget(deadSlot, slot.desc);
+	return deadSlot;
+}
+
+// --------------------------------------------------------
+// Lets later passes reuse the target.  Anything written to
+// it is only good until then.
+// --------------------------------------------------------
+void RenderTargetPool::Release(unsigned int target)
+{
+	this->slots[target].inUse = false;
+}
+
+// --------------------------------------------------------
+// Destroys every target that isn't acquired right now, such
+// as when the window is resized and none will match again
+// --------------------------------------------------------
+void RenderTargetPool::DestroyFreeTargets()
+{
+	for (unsigned int i = 0; i < this->slots.size(); i++)
+	{
+		if (this->slots[i].alive && !this->slots[i].inUse)
+			this->Destroy(i);
+	}
+}
+
+unsigned int RenderTargetPool::GetTargetCount()
+{
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < this->slots.size(); i++)
+	{
+		if (this->slots[i].alive)
+			count++;
+	}
+	return count;
+}
+
+const RenderTargetDesc& RenderTargetPool::GetDesc(unsigned int target)
+{
+	return this->slots[target].desc;
+}
+
+unsigned long long RenderTargetPool::GetAllocatedBytes()
+{
+	return this->allocatedBytes;
+}
+
+unsigned long long RenderTargetPool::GetPeakBytes()
+{
+	return this->peakBytes;
+}
+
+unsigned int RenderTargetPool::GetCreateCount()
+{
+	return this->createCount;
+}
+
+// --------------------------------------------------------
+// Size of one texel of the formats post processing (and
+// the swap chain and depth buffer) use
+// --------------------------------------------------------
+unsigned int RenderTargetPool::GetBytesPerPixel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 16;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return 8;
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+		return 4;
+	case DXGI_FORMAT_R16_FLOAT:
+		return 2;
+	case DXGI_FORMAT_R8_UNORM:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+unsigned long long RenderTargetPool::GetBytes(const RenderTargetDesc& desc)
+{
+	return (unsigned long long)desc.width * desc.height * GetBytesPerPixel(desc.format);
+}
+
+void RenderTargetPool::CreateTarget(unsigned int target, const RenderTargetDesc& desc)
+{
+}
+
+void RenderTargetPool::DestroyTarget(unsigned int target)
+{
+}
+
+void RenderTargetPool::Destroy(unsigned int target)
+{
+	Slot& slot = this->slots[target];
+	slot.alive = false;
+	slot.inUse = false;
+	this->allocatedBytes -= GetBytes(slot.desc);
+
+	this->DestroyTarget(target);
+}
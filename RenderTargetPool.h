@@ -0,0 +1,79 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <vector>
+
+// --------------------------------------------------------
+// The size and format a pooled target is created with, and
+// the key targets are shared by
+// --------------------------------------------------------
+struct RenderTargetDesc
+{
+	unsigned int width;
+	unsigned int height;
+	DXGI_FORMAT format;
+};
+
+// --------------------------------------------------------
+// Hands out transient render targets for a frame's passes,
+// by (width, height, format)
+//
+// - Acquire() returns a free target with the same desc if
+//   there is one, and only creates a new one otherwise
+// - Release() hands a target back as soon as the last pass
+//   reading it has been issued, so a later pass in the same
+//   frame can reuse it - passes whose targets are never
+//   alive at the same time share one texture
+// - BeginFrame() destroys any target that went unused for
+//   a whole frame (after a resize, or with fewer bloom
+//   levels), so memory follows what's actually drawn
+//
+// Targets are indices; creating and destroying the actual
+// textures is left to a subclass (see DeviceRenderTargetPool),
+// so the allocation logic needs no Direct3D device at all.
+// --------------------------------------------------------
+class RenderTargetPool {
+public:
+	RenderTargetPool();
+	virtual ~RenderTargetPool();
+
+	void BeginFrame();
+	unsigned int Acquire(unsigned int width, unsigned int height, DXGI_FORMAT format);
+	void Release(unsigned int target);
+	void DestroyFreeTargets();
+
+	unsigned int GetTargetCount();
+	const RenderTargetDesc& GetDesc(unsigned int target);
+
+	// Memory of the targets alive right now, and the most
+	// there has ever been at once
+	unsigned long long GetAllocatedBytes();
+	unsigned long long GetPeakBytes();
+	unsigned int GetCreateCount();
+
+	static unsigned int GetBytesPerPixel(DXGI_FORMAT format);
+	static unsigned long long GetBytes(const RenderTargetDesc& desc);
+
+protected:
+	// Called with the target's index, which stays the same
+	// until it's destroyed (and may be reused after)
+	virtual void CreateTarget(unsigned int target, const RenderTargetDesc& desc);
+	virtual void DestroyTarget(unsigned int target);
+
+private:
+	struct Slot
+	{
+		RenderTargetDesc desc;
+		bool alive;
+		bool inUse;
+		unsigned int lastUsedFrame;
+	};
+
+	void Destroy(unsigned int target);
+
+	std::vector<Slot> slots;
+	unsigned int frame;
+	unsigned int createCount;
+	unsigned long long allocatedBytes;
+	unsigned long long peakBytes;
+};
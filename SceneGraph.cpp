@@ -0,0 +1,282 @@
+#include "SceneGraph.h"
+#include "Transform.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+SceneGraph::SceneGraph()
+{
+	this->anyDirty = false;
+	this->orderDirty = false;
+}
+
+SceneGraph::~SceneGraph()
+{
+}
+
+// --------------------------------------------------------
+// Adds an identity node, as a root or as the last child of
+// an existing node, and returns its handle
+// --------------------------------------------------------
+unsigned int SceneGraph::AddNode(unsigned int parent)
+{
+	unsigned int handle = (unsigned int)this->handleToIndex.size();
+	unsigned int index = (unsigned int)this->parents.size();
+
+	// The parent already exists, so it's earlier in the arrays
+	// and the order stays valid
+	this->handleToIndex.push_back(index);
+	this->indexToHandle.push_back(handle);
+	this->parents.push_back(parent == SCENE_GRAPH_NO_PARENT ? SCENE_GRAPH_NO_PARENT : this->handleToIndex[parent]);
+	this->positions.push_back(XMFLOAT3(0, 0, 0));
+	this->rotations.push_back(XMFLOAT3(0, 0, 0));
+	this->scales.push_back(XMFLOAT3(1, 1, 1));
+	this->dirty.push_back(1);
+	this->worldMatrices.push_back(XMFLOAT4X4());
+	this->worldInverseTransposeMatrices.push_back(XMFLOAT4X4());
+
+	this->anyDirty = true;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Moves a node (and its subtree) under a new parent, or makes
+// it a root.  Requests that would create a cycle are ignored.
+// --------------------------------------------------------
+void SceneGraph::SetParent(unsigned int node, unsigned int parent)
+{
+	unsigned int index = this->handleToIndex[node];
+	unsigned int parentIndex = parent == SCENE_GRAPH_NO_PARENT ? SCENE_GRAPH_NO_PARENT : this->handleToIndex[parent];
+
+	for (unsigned int ancestor = parentIndex; ancestor != SCENE_GRAPH_NO_PARENT; ancestor = this->parents[ancestor])
+	{
+		if (ancestor == index)
+			return;
+	}
+
+	this->parents[index] = parentIndex;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+
+	// Parents must stay ahead of their children
+	if (parentIndex != SCENE_GRAPH_NO_PARENT && parentIndex > index)
+		this->orderDirty = true;
+}
+
+unsigned int SceneGraph::GetParent(unsigned int node)
+{
+	unsigned int parentIndex = this->parents[this->handleToIndex[node]];
+	return parentIndex == SCENE_GRAPH_NO_PARENT ? SCENE_GRAPH_NO_PARENT : this->indexToHandle[parentIndex];
+}
+
+unsigned int SceneGraph::GetNodeCount()
+{
+	return (unsigned int)this->parents.size();
+}
+
+void SceneGraph::Reserve(unsigned int nodeCount)
+{
+	this->handleToIndex.reserve(nodeCount);
+	this->indexToHandle.reserve(nodeCount);
+	this->parents.reserve(nodeCount);
+	this->positions.reserve(nodeCount);
+	this->rotations.reserve(nodeCount);
+	this->scales.reserve(nodeCount);
+	this->dirty.reserve(nodeCount);
+	this->worldMatrices.reserve(nodeCount);
+	this->worldInverseTransposeMatrices.reserve(nodeCount);
+}
+
+void SceneGraph::SetPosition(unsigned int node, DirectX::XMFLOAT3 position)
+{
+	unsigned int index = this->handleToIndex[node];
+	this->positions[index] = position;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+void SceneGraph::SetRotation(unsigned int node, DirectX::XMFLOAT3 pitchYawRoll)
+{
+	unsigned int index = this->handleToIndex[node];
+	this->rotations[index] = pitchYawRoll;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+void SceneGraph::SetScale(unsigned int node, DirectX::XMFLOAT3 scale)
+{
+	unsigned int index = this->handleToIndex[node];
+	this->scales[index] = scale;
+	this->dirty[index] = 1;
+	this->anyDirty = true;
+}
+
+DirectX::XMFLOAT3 SceneGraph::GetPosition(unsigned int node)
+{
+	return this->positions[this->handleToIndex[node]];
+}
+
+DirectX::XMFLOAT3 SceneGraph::GetRotation(unsigned int node)
+{
+	return this->rotations[this->handleToIndex[node]];
+}
+
+DirectX::XMFLOAT3 SceneGraph::GetScale(unsigned int node)
+{
+	return this->scales[this->handleToIndex[node]];
+}
+
+const DirectX::XMFLOAT4X4& SceneGraph::GetWorldMatrix(unsigned int node)
+{
+	return this->worldMatrices[this->handleToIndex[node]];
+}
+
+const DirectX::XMFLOAT4X4& SceneGraph::GetWorldInverseTransposeMatrix(unsigned int node)
+{
+	return this->worldInverseTransposeMatrices[this->handleToIndex[node]];
+}
+
+// --------------------------------------------------------
+// Rebuilds the world matrices of every dirty node and all
+// of their descendants, in one pass over the arrays
+// --------------------------------------------------------
+void SceneGraph::UpdateWorldMatrices()
+{
+	if (this->orderDirty)
+		this->SortNodes();
+
+	if (!this->anyDirty)
+		return;
+
+	UpdateSortedMatrices(
+		(unsigned int)this->parents.size(), &this->parents[0],
+		&this->positions[0], &this->rotations[0], &this->scales[0],
+		&this->dirty[0], &this->worldMatrices[0], &this->worldInverseTransposeMatrices[0]);
+
+	std::fill(this->dirty.begin(), this->dirty.end(), (unsigned char)0);
+	this->anyDirty = false;
+}
+
+// --------------------------------------------------------
+// Rebuilds the world matrices of every dirty node and all
+// of its descendants, in one linear pass.  Every parent must
+// come before its children.  Leaves each rebuilt node's
+// dirty flag set, for the caller to act on and clear.
+// --------------------------------------------------------
+void SceneGraph::UpdateSortedMatrices(
+	unsigned int count, const unsigned int* parents,
+	const DirectX::XMFLOAT3* positions, const DirectX::XMFLOAT3* rotations, const DirectX::XMFLOAT3* scales,
+	unsigned char* dirty, DirectX::XMFLOAT4X4* worldMatrices, DirectX::XMFLOAT4X4* worldInverseTransposeMatrices)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		// The parent was already visited, so its flag is final
+		// for this pass and a dirty parent dirties the child
+		unsigned int parent = parents[i];
+		if (parent != SCENE_GRAPH_NO_PARENT && dirty[parent])
+			dirty[i] = 1;
+
+		if (!dirty[i])
+			continue;
+
+		XMMATRIX world, inverseTranspose;
+		Transform::BuildLocalMatrices(positions[i], rotations[i], scales[i], world, inverseTranspose);
+
+		if (parent != SCENE_GRAPH_NO_PARENT)
+		{
+			world = XMMatrixMultiply(world, XMLoadFloat4x4(&worldMatrices[parent]));
+			inverseTranspose = XMMatrixMultiply(inverseTranspose, XMLoadFloat4x4(&worldInverseTransposeMatrices[parent]));
+		}
+
+		XMStoreFloat4x4(&worldMatrices[i], world);
+		XMStoreFloat4x4(&worldInverseTransposeMatrices[i], inverseTranspose);
+	}
+}
+
+// --------------------------------------------------------
+// Fills order with every node index in depth-first order,
+// given each node's parent index (SCENE_GRAPH_NO_PARENT for
+// a root).  Siblings keep their relative order.
+// --------------------------------------------------------
+void SceneGraph::GetDepthFirstOrder(const std::vector<unsigned int>& parents, std::vector<unsigned int>& order)
+{
+	unsigned int nodeCount = (unsigned int)parents.size();
+
+	// Children of each node as ranges of one flat list,
+	// keeping their current relative order
+	std::vector<unsigned int> childStart(nodeCount + 1, 0);
+	for (unsigned int i = 0; i < nodeCount; i++)
+	{
+		if (parents[i] != SCENE_GRAPH_NO_PARENT)
+			childStart[parents[i] + 1]++;
+	}
+	for (unsigned int i = 0; i < nodeCount; i++)
+		childStart[i + 1] += childStart[i];
+
+	std::vector<unsigned int> children(childStart[nodeCount]);
+	std::vector<unsigned int> childFill(childStart.begin(), childStart.end() - 1);
+	for (unsigned int i = 0; i < nodeCount; i++)
+	{
+		if (parents[i] != SCENE_GRAPH_NO_PARENT)
+			children[childFill[parents[i]]++] = i;
+	}
+
+	// Depth-first from each root, with an explicit stack
+	std::vector<unsigned int> pending;
+	order.clear();
+	order.reserve(nodeCount);
+	for (unsigned int root = 0; root < nodeCount; root++)
+	{
+		if (parents[root] != SCENE_GRAPH_NO_PARENT)
+			continue;
+
+		pending.push_back(root);
+		while (!pending.empty())
+		{
+			unsigned int node = pending.back();
+			pending.pop_back();
+			order.push_back(node);
+
+			// Reversed, so the first child is visited first
+			for (unsigned int c = childStart[node + 1]; c > childStart[node]; c--)
+				pending.push_back(children[c - 1]);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Re-sorts the arrays into depth-first order, which puts
+// parents before children and keeps each subtree together
+// --------------------------------------------------------
+void SceneGraph::SortNodes()
+{
+	unsigned int nodeCount = (unsigned int)this->parents.size();
+
+	std::vector<unsigned int> order;
+	GetDepthFirstOrder(this->parents, order);
+
+	// Old index -> new index
+	std::vector<unsigned int> newIndex(nodeCount);
+	for (unsigned int i = 0; i < nodeCount; i++)
+		newIndex[order[i]] = i;
+
+	Reorder(this->parents, order);
+	for (unsigned int i = 0; i < nodeCount; i++)
+	{
+		if (this->parents[i] != SCENE_GRAPH_NO_PARENT)
+			this->parents[i] = newIndex[this->parents[i]];
+	}
+
+	Reorder(this->indexToHandle, order);
+	for (unsigned int i = 0; i < nodeCount; i++)
+		this->handleToIndex[this->indexToHandle[i]] = i;
+
+	Reorder(this->positions, order);
+	Reorder(this->rotations, order);
+	Reorder(this->scales, order);
+	Reorder(this->dirty, order);
+	Reorder(this->worldMatrices, order);
+	Reorder(this->worldInverseTransposeMatrices, order);
+
+	this->orderDirty = false;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#define SCENE_GRAPH_NO_PARENT 0xFFFFFFFF
+
+// --------------------------------------------------------
+// A flattened transform hierarchy for large scenes
+//
+// - Nodes live in contiguous arrays, ordered so that every
+//   parent comes before its children, which is all the
+//   update pass relies on.  Subtrees are not necessarily
+//   contiguous: AddNode() appends at the end, after any
+//   other nodes added since the parent, and only the
+//   depth-first re-sort that follows a SetParent() into a
+//   later parent puts each subtree back together.
+// - UpdateWorldMatrices() rebuilds every dirty node and its
+//   descendants in a single linear pass, with no pointer
+//   chasing and no recursion
+// - Node handles returned by AddNode() stay valid when the
+//   arrays are re-sorted after a SetParent()
+//
+// Local values follow Transform's conventions (rotation is
+// pitch, yaw, roll in radians).
+// --------------------------------------------------------
+class SceneGraph {
+public:
+	SceneGraph();
+	~SceneGraph();
+
+	unsigned int AddNode(unsigned int parent = SCENE_GRAPH_NO_PARENT);
+	void SetParent(unsigned int node, unsigned int parent);
+	unsigned int GetParent(unsigned int node);
+	unsigned int GetNodeCount();
+	void Reserve(unsigned int nodeCount);
+
+	void SetPosition(unsigned int node, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int node, DirectX::XMFLOAT3 pitchYawRoll);
+	void SetScale(unsigned int node, DirectX::XMFLOAT3 scale);
+
+	DirectX::XMFLOAT3 GetPosition(unsigned int node);
+	DirectX::XMFLOAT3 GetRotation(unsigned int node);
+	DirectX::XMFLOAT3 GetScale(unsigned int node);
+
+	// Only valid after UpdateWorldMatrices()
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int node);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(unsigned int node);
+
+	void UpdateWorldMatrices();
+
+	// The sort and update behind SceneGraph, for other
+	// structure-of-arrays hierarchies (see EntityStore)
+	static void GetDepthFirstOrder(const std::vector<unsigned int>& parents, std::vector<unsigned int>& order);
+	static void UpdateSortedMatrices(
+		unsigned int count, const unsigned int* parents,
+		const DirectX::XMFLOAT3* positions, const DirectX::XMFLOAT3* rotations, const DirectX::XMFLOAT3* scales,
+		unsigned char* dirty, DirectX::XMFLOAT4X4* worldMatrices, DirectX::XMFLOAT4X4* worldInverseTransposeMatrices);
+
+	// Rearranges values so that values[i] becomes the old
+	// values[order[i]]
+	template<typename T>
+	static void Reorder(std::vector<T>& values, const std::vector<unsigned int>& order)
+	{
+		std::vector<T> reordered(values.size());
+		for (size_t i = 0; i < order.size(); i++)
+			reordered[i] = values[order[i]];
+		values.swap(reordered);
+	}
+
+private:
+	void SortNodes();
+
+	// Handle <-> array index
+	std::vector<unsigned int> handleToIndex;
+	std::vector<unsigned int> indexToHandle;
+
+	// Per-node data, by array index
+	std::vector<unsigned int> parents;
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> rotations;
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<unsigned char> dirty;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposeMatrices;
+
+	bool anyDirty;
+	bool orderDirty;
+};
@@ -0,0 +1,54 @@
+#define SCENE_MAX_TILE_SIZE		16
+#define SCENE_MAX_THREAD_COUNT	(SCENE_MAX_TILE_SIZE * SCENE_MAX_TILE_SIZE)
+
+cbuffer externalData : register(b0) {
+	uint2 sourceSize;
+}
+
+Texture2D source				: register(t0);
+StructuredBuffer<float> exposureState	: register(t1);	// The auto exposure first (see AutoExposureCS)
+RWByteAddressBuffer sceneMax	: register(u0);
+
+groupshared float tileMax[SCENE_MAX_THREAD_COUNT];
+
+// --------------------------------------------------------
+// Finds the brightest red, green or blue value of any texel
+// in the source, times the auto exposure, which is what
+// BloomEarlyOut::FindMaxValue() computes when given that
+// same exposure
+//
+// - Each thread takes a 2x2 block, the group halves its
+//   values down to one, and a single atomic per group merges
+//   that into sceneMax, which must be cleared to zero first
+// - Non-negative floats order the same as their bits, so
+//   the maximum is kept as a uint
+// --------------------------------------------------------
+[numthreads(SCENE_MAX_TILE_SIZE, SCENE_MAX_TILE_SIZE, 1)]
+void main(uint3 threadID : SV_DispatchThreadID, uint threadIndex : SV_GroupIndex)
+{
+	float value = 0;
+	for (uint y = 0; y < 2; y++)
+	{
+		for (uint x = 0; x < 2; x++)
+		{
+			uint2 texel = threadID.xy * 2 + uint2(x, y);
+			if (all(texel < sourceSize))
+			{
+				float3 color = source.Load(int3(texel, 0)).rgb;
+				value = max(value, max(color.r, max(color.g, color.b)));
+			}
+		}
+	}
+	tileMax[threadIndex] = value;
+	GroupMemoryBarrierWithGroupSync();
+
+	for (uint stride = SCENE_MAX_THREAD_COUNT / 2; stride > 0; stride /= 2)
+	{
+		if (threadIndex < stride)
+			tileMax[threadIndex] = max(tileMax[threadIndex], tileMax[threadIndex + stride]);
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if (threadIndex == 0)
+		sceneMax.InterlockedMax(0, asuint(tileMax[0] * exposureState[0]));
+}
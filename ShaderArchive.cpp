@@ -0,0 +1,240 @@
+#include "ShaderArchive.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SHADER_ARCHIVE_MAGIC 0x4B505348 // "HSPK"
+#define SHADER_ARCHIVE_FORMAT_VERSION 1
+
+ShaderArchive::ShaderArchive()
+{
+	this->data = 0;
+	this->size = 0;
+	this->slots = 0;
+	this->slotCount = 0;
+	this->maxProbeCount = 0;
+}
+
+ShaderArchive::~ShaderArchive()
+{
+	this->Close();
+}
+
+// --------------------------------------------------------
+// Lays out the header, index and bytecode of an archive.
+// Fails on an empty entry or a key that's already packed.
+// --------------------------------------------------------
+bool ShaderArchive::Pack(const std::vector<ShaderArchiveEntry>& entries, unsigned long long sourceHash, std::vector<unsigned char>& archive)
+{
+	unsigned int entryCount = (unsigned int)entries.size();
+	unsigned int slotCount = 1;
+	while (slotCount < entryCount * 2)
+		slotCount *= 2;
+
+	// Place every entry in the index first
+	std::vector<ShaderArchiveSlot> index(slotCount);
+	memset(&index[0], 0, sizeof(ShaderArchiveSlot) * slotCount);
+
+	std::vector<unsigned int> offsets(entryCount);
+	size_t offset = sizeof(ShaderArchiveHeader) + sizeof(ShaderArchiveSlot) * slotCount;
+	for (unsigned int e = 0; e < entryCount; e++)
+	{
+		const ShaderArchiveEntry& entry = entries[e];
+		if (entry.bytecode.empty())
+			return false;
+
+		unsigned int s = GetHomeSlot(entry.key, slotCount);
+		while (index[s].size != 0)
+		{
+			if (index[s].key == entry.key)
+				return false;
+			s = (s + 1) & (slotCount - 1);
+		}
+
+		offsets[e] = (unsigned int)offset;
+		index[s].key = entry.key;
+		index[s].offset = offsets[e];
+		index[s].size = (unsigned int)entry.bytecode.size();
+		offset = (offset + entry.bytecode.size() + 3) & ~(size_t)3;
+	}
+
+	ShaderArchiveHeader header = {};
+	header.magic = SHADER_ARCHIVE_MAGIC;
+	header.formatVersion = SHADER_ARCHIVE_FORMAT_VERSION;
+	header.entryCount = entryCount;
+	header.slotCount = slotCount;
+	header.sourceHash = sourceHash;
+
+	// Then copy everything into place, padding included
+	archive.assign(offset, 0);
+	memcpy(&archive[0], &header, sizeof(ShaderArchiveHeader));
+	memcpy(&archive[sizeof(ShaderArchiveHeader)], &index[0], sizeof(ShaderArchiveSlot) * slotCount);
+	for (unsigned int e = 0; e < entryCount; e++)
+		memcpy(&archive[offsets[e]], &entries[e].bytecode[0], entries[e].bytecode.size());
+
+	return true;
+}
+
+bool ShaderArchive::Save(const char* filename, const std::vector<unsigned char>& archive)
+{
+	if (archive.empty())
+		return false;
+
+	FILE* file = fopen(filename, "wb");
+	if (!file)
+		return false;
+
+	bool result = fwrite(&archive[0], 1, archive.size(), file) == archive.size();
+	result = fclose(file) == 0 && result;
+
+	// Never leave a partial archive behind
+	if (!result)
+		remove(filename);
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Maps the whole archive read-only, for as long as it's
+// open
+// --------------------------------------------------------
+bool ShaderArchive::Load(const char* filename)
+{
+	this->Close();
+
+	if (!this->file.Open(filename))
+		return false;
+
+	if (!this->ReadIndex(this->file.GetData(), this->file.GetSize()))
+	{
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Uses an archive already in memory, which has to outlive
+// this object (or the next Open(), Load() or Close())
+// --------------------------------------------------------
+bool ShaderArchive::Open(const void* data, size_t size)
+{
+	this->Close();
+	return this->ReadIndex(data, size);
+}
+
+// --------------------------------------------------------
+// Checks the header and everything the index points at up
+// front, so Find() can trust it, then starts using them
+// --------------------------------------------------------
+bool ShaderArchive::ReadIndex(const void* data, size_t size)
+{
+	if (size < sizeof(ShaderArchiveHeader))
+		return false;
+
+	const ShaderArchiveHeader* header = (const ShaderArchiveHeader*)data;
+	if (header->magic != SHADER_ARCHIVE_MAGIC ||
+		header->formatVersion != SHADER_ARCHIVE_FORMAT_VERSION ||
+		header->slotCount == 0 ||
+		(header->slotCount & (header->slotCount - 1)) != 0 ||
+		header->slotCount < (unsigned long long)header->entryCount * 2 ||
+		size < sizeof(ShaderArchiveHeader) + (unsigned long long)sizeof(ShaderArchiveSlot) * header->slotCount)
+		return false;
+
+	const ShaderArchiveSlot* index = (const ShaderArchiveSlot*)((const unsigned char*)data + sizeof(ShaderArchiveHeader));
+	unsigned int entryCount = 0;
+	unsigned int maxProbeCount = 0;
+	for (unsigned int s = 0; s < header->slotCount; s++)
+	{
+		if (index[s].size == 0)
+			continue;
+
+		if ((unsigned long long)index[s].offset + index[s].size > size)
+			return false;
+
+		// How far past its home slot linear probing put it
+		unsigned int probeCount = ((s - GetHomeSlot(index[s].key, header->slotCount)) & (header->slotCount - 1)) + 1;
+		if (probeCount > maxProbeCount)
+			maxProbeCount = probeCount;
+
+		entryCount++;
+	}
+
+	if (entryCount != header->entryCount)
+		return false;
+
+	this->data = (const unsigned char*)data;
+	this->size = size;
+	this->slots = index;
+	this->slotCount = header->slotCount;
+	this->maxProbeCount = maxProbeCount;
+	return true;
+}
+
+void ShaderArchive::Close()
+{
+	this->file.Close();
+
+	this->data = 0;
+	this->size = 0;
+	this->slots = 0;
+	this->slotCount = 0;
+	this->maxProbeCount = 0;
+}
+
+// --------------------------------------------------------
+// Probes from the key's home slot until it finds the key or
+// an empty slot, which means the key was never packed
+// --------------------------------------------------------
+const void* ShaderArchive::Find(unsigned long long key, unsigned int& size)
+{
+	size = 0;
+	if (this->slotCount == 0)
+		return 0;
+
+	unsigned int s = GetHomeSlot(key, this->slotCount);
+	while (this->slots[s].size != 0)
+	{
+		if (this->slots[s].key == key)
+		{
+			size = this->slots[s].size;
+			return this->data + this->slots[s].offset;
+		}
+		s = (s + 1) & (this->slotCount - 1);
+	}
+
+	return 0;
+}
+
+unsigned int ShaderArchive::GetEntryCount()
+{
+	return this->data ? ((const ShaderArchiveHeader*)this->data)->entryCount : 0;
+}
+
+unsigned int ShaderArchive::GetSlotCount()
+{
+	return this->slotCount;
+}
+
+unsigned int ShaderArchive::GetMaxProbeCount()
+{
+	return this->maxProbeCount;
+}
+
+unsigned long long ShaderArchive::GetSourceHash()
+{
+	return this->data ? ((const ShaderArchiveHeader*)this->data)->sourceHash : 0;
+}
+
+size_t ShaderArchive::GetSize()
+{
+	return this->size;
+}
+
+// --------------------------------------------------------
+// Keys are already hashes, so just fold the high half in
+// --------------------------------------------------------
+unsigned int ShaderArchive::GetHomeSlot(unsigned long long key, unsigned int slotCount)
+{
+	return (unsigned int)(key ^ (key >> 32)) & (slotCount - 1);
+}
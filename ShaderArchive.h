@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+#include "MappedFile.h"
+
+// --------------------------------------------------------
+// Header at the start of every shader archive.  It is
+// followed by the index (slotCount ShaderArchiveSlots) and
+// then every entry's bytecode, each starting 4-byte aligned.
+// --------------------------------------------------------
+struct ShaderArchiveHeader
+{
+	unsigned int magic;
+	unsigned int formatVersion;
+	unsigned int entryCount;
+	unsigned int slotCount;			// A power of two, at least twice entryCount
+
+	// Whatever the archive was built from, for the builder
+	// to tell when it's stale
+	unsigned long long sourceHash;
+};
+
+// --------------------------------------------------------
+// One slot of the index, an open addressing hash table with
+// linear probing.  An entry starts looking at the slot its
+// key hashes to and takes the first empty one after that.
+// --------------------------------------------------------
+struct ShaderArchiveSlot
+{
+	unsigned long long key;
+	unsigned int offset;			// From the start of the archive
+	unsigned int size;				// 0 for an empty slot
+};
+
+// One compiled shader to pack
+struct ShaderArchiveEntry
+{
+	unsigned long long key;
+	std::vector<unsigned char> bytecode;
+};
+
+// --------------------------------------------------------
+// Many compiled shaders packed into one file, found by a
+// 64-bit key (see ShaderPermutations::GetKey())
+//
+// - Pack() builds an archive in memory and Save() writes it
+// - Load() maps the file read-only and Find() hands back
+//   pointers into the mapping, so nothing is read or copied
+//   until a shader is actually created from it
+// - The index is at most half full, so Find() expects about
+//   1.5 probes for a key that's there (2.5 for one that
+//   isn't) however many entries there are.  Open() also
+//   records the longest probe any entry needs.
+//
+// Only Load() and Save() touch the file system; Open() and
+// Find() work on any archive already in memory and need no
+// Direct3D device at all.
+// --------------------------------------------------------
+class ShaderArchive {
+public:
+	ShaderArchive();
+	~ShaderArchive();
+
+	static bool Pack(const std::vector<ShaderArchiveEntry>& entries, unsigned long long sourceHash, std::vector<unsigned char>& archive);
+	static bool Save(const char* filename, const std::vector<unsigned char>& archive);
+
+	bool Load(const char* filename);
+	bool Open(const void* data, size_t size);
+	void Close();
+
+	// Null (and size 0) if the archive has no such entry
+	const void* Find(unsigned long long key, unsigned int& size);
+
+	unsigned int GetEntryCount();
+	unsigned int GetSlotCount();
+	unsigned int GetMaxProbeCount();
+	unsigned long long GetSourceHash();
+	size_t GetSize();
+
+private:
+	static unsigned int GetHomeSlot(unsigned long long key, unsigned int slotCount);
+	bool ReadIndex(const void* data, size_t size);
+
+	const unsigned char* data;
+	size_t size;
+	const ShaderArchiveSlot* slots;
+	unsigned int slotCount;
+	unsigned int maxProbeCount;
+
+	// What Load() mapped, if the data is ours to unmap
+	MappedFile file;
+};
@@ -0,0 +1,175 @@
+#include "ShaderArchive.h"
+#include "ShaderPermutations.h"
+#include <Windows.h>
+#include <wrl/client.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#pragma comment(lib, "d3dcompiler.lib")
+#include <d3dcompiler.h>
+
+// The files PixelShader.hlsl's permutations are compiled
+// from, relative to its directory
+static const char* PixelShaderSources[] = { "PixelShader.hlsl", "Lighting.hlsli", "ShaderStructs.hlsli" };
+
+// --------------------------------------------------------
+// Reads a whole (small) file into memory
+// --------------------------------------------------------
+static bool ReadWholeFile(const std::string& filename, std::vector<unsigned char>& contents)
+{
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	DWORD bytesRead = 0;
+	bool result = GetFileSizeEx(file, &fileSize) != 0;
+	if (result)
+	{
+		contents.resize((size_t)fileSize.QuadPart);
+		result = contents.empty() || (ReadFile(file, &contents[0], (DWORD)contents.size(), &bytesRead, 0) && bytesRead == contents.size());
+	}
+
+	CloseHandle(file);
+	return result;
+}
+
+// --------------------------------------------------------
+// A hash of everything the archive is built from: the HLSL,
+// the compile flags and every permutation's defines
+// --------------------------------------------------------
+static bool HashPixelShaderSources(const std::string& sourceDirectory, UINT flags, unsigned long long& hash)
+{
+	hash = ShaderPermutations::Hash(&flags, sizeof(flags));
+
+	std::vector<unsigned char> contents;
+	for (unsigned int i = 0; i < ARRAYSIZE(PixelShaderSources); i++)
+	{
+		if (!ReadWholeFile(sourceDirectory + PixelShaderSources[i], contents))
+		{
+			fprintf(stderr, "ShaderPacker: error: can't read %s%s\n", sourceDirectory.c_str(), PixelShaderSources[i]);
+			return false;
+		}
+
+		if (!contents.empty())
+			hash = ShaderPermutations::Hash(&contents[0], contents.size(), hash);
+	}
+
+	for (unsigned int p = 0; p < ShaderPermutations::Count; p++)
+	{
+		unsigned long long key = ShaderPermutations::GetKey(p);
+		hash = ShaderPermutations::Hash(&key, sizeof(key), hash);
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Compiles every permutation of PixelShader.hlsl and packs
+// them into one archive
+// --------------------------------------------------------
+static bool BuildPixelShaderArchive(const std::wstring& sourceFile, UINT flags, unsigned long long sourceHash, std::vector<unsigned char>& archive)
+{
+	std::vector<ShaderArchiveEntry> entries(ShaderPermutations::Count);
+	std::vector<ShaderDefine> defines;
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (unsigned int p = 0; p < ShaderPermutations::Count; p++)
+	{
+		ShaderPermutations::GetDefines(p, defines);
+		macros.clear();
+		for (unsigned int d = 0; d < defines.size(); d++)
+			macros.push_back({ defines[d].name.c_str(), defines[d].value.c_str() });
+		macros.push_back({ 0, 0 });
+
+		Microsoft::WRL::ComPtr<ID3DBlob> bytecode;
+		Microsoft::WRL::ComPtr<ID3DBlob> errors;
+		HRESULT hr = D3DCompileFromFile(
+			sourceFile.c_str(),
+			&macros[0],
+			D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			"main",
+			"ps_5_0",
+			flags,
+			0,
+			bytecode.GetAddressOf(),
+			errors.GetAddressOf());
+
+		if (FAILED(hr))
+		{
+			fprintf(stderr, "ShaderPacker: error: %s failed to compile\n%s",
+				ShaderPermutations::GetName(p).c_str(),
+				errors ? (const char*)errors->GetBufferPointer() : "");
+			return false;
+		}
+
+		const unsigned char* code = (const unsigned char*)bytecode->GetBufferPointer();
+		entries[p].key = ShaderPermutations::GetKey(p);
+		entries[p].bytecode.assign(code, code + bytecode->GetBufferSize());
+	}
+
+	return ShaderArchive::Pack(entries, sourceHash, archive);
+}
+
+// --------------------------------------------------------
+// Builds PixelShader.shaderpack ahead of time, as a post
+// build step of the game (see DX11Starter.vcxproj), so the
+// game itself only ever maps the finished archive:
+//
+//   ShaderPacker <PixelShader.hlsl> <output.shaderpack> [-debug]
+//
+// -debug compiles with debug info, like the game's .cso
+// files in debug builds.  The archive is only rebuilt when
+// its sources, flags or permutations changed since it was
+// written, so most builds just hash the HLSL and exit.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: ShaderPacker <PixelShader.hlsl> <output.shaderpack> [-debug]\n");
+		return 1;
+	}
+
+	std::string sourceFile = argv[1];
+	std::string archiveFile = argv[2];
+	std::string sourceDirectory = sourceFile.substr(0, sourceFile.find_last_of("\\/") + 1);
+
+	UINT flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
+	if (argc > 3 && strcmp(argv[3], "-debug") == 0)
+		flags |= D3DCOMPILE_DEBUG;
+
+	unsigned long long sourceHash = 0;
+	if (!HashPixelShaderSources(sourceDirectory, flags, sourceHash))
+		return 1;
+
+	// Up to date already
+	{
+		ShaderArchive existing;
+		if (existing.Load(archiveFile.c_str()) && existing.GetSourceHash() == sourceHash)
+			return 0;
+	}
+
+	LARGE_INTEGER startTime, endTime, frequency;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&startTime);
+
+	std::vector<unsigned char> archive;
+	if (!BuildPixelShaderArchive(std::wstring(sourceFile.begin(), sourceFile.end()), flags, sourceHash, archive))
+		return 1;
+
+	if (!ShaderArchive::Save(archiveFile.c_str(), archive))
+	{
+		fprintf(stderr, "ShaderPacker: error: can't write %s\n", archiveFile.c_str());
+		return 1;
+	}
+
+	QueryPerformanceCounter(&endTime);
+	printf("ShaderPacker: %u permutations (%.1f KB) in %.0f ms\n",
+		ShaderPermutations::Count,
+		archive.size() / 1024.0,
+		(double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / frequency.QuadPart);
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include "ShaderPermutations.h"
+#include <string.h>
+
+// The file every key is hashed with, so other shaders can
+// share an archive without their keys colliding
+static const char* ShaderName = "PixelShader.hlsl";
+
+unsigned int ShaderPermutations::GetPermutation(unsigned int features, LightCountClass lightCount)
+{
+	return (features & PIXEL_SHADER_ALL_FEATURES) | ((unsigned int)lightCount << FeatureBits);
+}
+
+unsigned int ShaderPermutations::GetFeatures(unsigned int permutation)
+{
+	return permutation & PIXEL_SHADER_ALL_FEATURES;
+}
+
+LightCountClass ShaderPermutations::GetLightCountClass(unsigned int permutation)
+{
+	return (LightCountClass)(permutation >> FeatureBits);
+}
+
+// --------------------------------------------------------
+// Every define is always given a value, so the defaults at
+// the top of PixelShader.hlsl never apply to a permutation
+// --------------------------------------------------------
+void ShaderPermutations::GetDefines(unsigned int permutation, std::vector<ShaderDefine>& defines)
+{
+	unsigned int features = GetFeatures(permutation);
+
+	defines.clear();
+	defines.push_back({ "NORMAL_MAP", (features & PIXEL_SHADER_NORMAL_MAP) ? "1" : "0" });
+	defines.push_back({ "EMISSIVE", (features & PIXEL_SHADER_EMISSIVE) ? "1" : "0" });
+	defines.push_back({ "LIGHTING_PBR", (features & PIXEL_SHADER_PBR) ? "1" : "0" });
+	defines.push_back({ "LIGHT_COUNT_CLASS", std::to_string((unsigned int)GetLightCountClass(permutation)) });
+}
+
+// --------------------------------------------------------
+// The defines as one line, e.g. "NORMAL_MAP=1 EMISSIVE=0
+// LIGHTING_PBR=1 LIGHT_COUNT_CLASS=2"
+// --------------------------------------------------------
+std::string ShaderPermutations::GetName(unsigned int permutation)
+{
+	std::vector<ShaderDefine> defines;
+	GetDefines(permutation, defines);
+
+	std::string name;
+	for (unsigned int i = 0; i < defines.size(); i++)
+	{
+		if (i > 0)
+			name += " ";
+		name += defines[i].name + "=" + defines[i].value;
+	}
+	return name;
+}
+
+unsigned long long ShaderPermutations::GetKey(unsigned int permutation)
+{
+	std::string name = GetName(permutation);
+
+	unsigned long long key = Hash(ShaderName, strlen(ShaderName));
+	key = Hash("|", 1, key);
+	return Hash(name.c_str(), name.size(), key);
+}
+
+unsigned long long ShaderPermutations::Hash(const void* data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
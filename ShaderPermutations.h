@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Features PixelShader.hlsl can be compiled with or without.
+// Must match the defines at the top of PixelShader.hlsl
+enum PixelShaderFeature
+{
+	PIXEL_SHADER_NORMAL_MAP = 1 << 0,
+	PIXEL_SHADER_EMISSIVE = 1 << 1,
+	PIXEL_SHADER_PBR = 1 << 2,		// Blinn-Phong without it
+	PIXEL_SHADER_ALL_FEATURES = (1 << 3) - 1
+};
+
+// How many lights PixelShader.hlsl loops over
+enum LightCountClass
+{
+	LIGHT_COUNT_NONE,			// Ambient (and emissive) only
+	LIGHT_COUNT_SINGLE,			// Just the first light, no cluster lookup
+	LIGHT_COUNT_CLUSTERED,		// Every light in the pixel's cluster
+	LIGHT_COUNT_CLASS_COUNT
+};
+
+// One preprocessor define, as handed to the shader compiler
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+// --------------------------------------------------------
+// Every combination of PixelShader.hlsl's feature defines,
+// numbered 0 to Count - 1
+//
+// - A permutation's key is a 64-bit FNV-1a hash of the
+//   shader's name and its full define list, so renaming or
+//   adding a define changes every key, and a stale archive
+//   misses instead of handing back the wrong bytecode
+// - GetDefines() is what the compiler gets; everything else
+//   is for looking permutations up
+//
+// Needs no Direct3D device at all.
+// --------------------------------------------------------
+class ShaderPermutations {
+public:
+	static const unsigned int FeatureBits = 3;
+	static const unsigned int Count = (1 << FeatureBits) * LIGHT_COUNT_CLASS_COUNT;
+
+	static unsigned int GetPermutation(unsigned int features, LightCountClass lightCount);
+	static unsigned int GetFeatures(unsigned int permutation);
+	static LightCountClass GetLightCountClass(unsigned int permutation);
+
+	static void GetDefines(unsigned int permutation, std::vector<ShaderDefine>& defines);
+	static std::string GetName(unsigned int permutation);
+	static unsigned long long GetKey(unsigned int permutation);
+
+	// 64-bit FNV-1a, continuing from a previous hash
+	static unsigned long long Hash(const void* data, size_t size, unsigned long long hash = 0xCBF29CE484222325ull);
+};
@@ -11,6 +11,10 @@ bool ISimpleShader::ReportWarnings = false;
 // ISimpleShader::ReportErrors = true;
 // ISimpleShader::ReportWarnings = true;
 
+// Next shader ID to hand out.  IDs are never reused, so
+// a render queue can sort by them across frames.
+static unsigned int NextShaderID = 0;
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -29,6 +33,7 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+	this->id = NextShaderID++;
 }
 
 // --------------------------------------------------------
@@ -94,6 +99,45 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	return LoadShaderBlob(shaderFile);
+}
+
+// --------------------------------------------------------
+// Loads a shader that's already compiled in memory (such as
+// an entry of a ShaderArchive) and builds the variable table
+// using shader reflection.  The bytecode is copied, so it
+// only has to live until this returns.
+//
+// bytecode - The compiled shader
+// size     - Its size in bytes
+// 
+// Returns true if shader is loaded properly, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::LoadShaderBytecode(const void* bytecode, size_t size)
+{
+	HRESULT hr = D3DCreateBlob(size, shaderBlob.GetAddressOf());
+	if (hr != S_OK)
+	{
+		if (ReportErrors)
+			LogError("SimpleShader::LoadShaderBytecode() - Error creating a blob for the bytecode.\n");
+
+		return false;
+	}
+
+	memcpy(shaderBlob->GetBufferPointer(), bytecode, size);
+	return LoadShaderBlob(L"(bytecode)");
+}
+
+// --------------------------------------------------------
+// Creates the shader from shaderBlob and builds the variable
+// table using shader reflection
+//
+// shaderName - Where the blob came from, for error messages
+// 
+// Returns true if shader is loaded properly, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::LoadShaderBlob(LPCWSTR shaderName)
+{
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -101,8 +145,8 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	{
 		if (ReportErrors)
 		{
-			LogError("SimpleShader::LoadShaderFile() - Error creating shader from file '");
-			LogW(shaderFile);
+			LogError("SimpleShader::LoadShaderBlob() - Error creating shader from '");
+			LogW(shaderName);
 			LogError("'. Ensure the type of shader (vertex, pixel, etc.) matches the SimpleShader type (SimpleVertexShader, SimplePixelShader, etc.) you're using.\n");
 		}
 
@@ -189,11 +233,12 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
 		// Create this constant buffer
+		// - Dynamic, so uploads can Map() with WRITE_DISCARD
 		D3D11_BUFFER_DESC newBuffDesc = {};
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
+		newBuffDesc.Usage = D3D11_USAGE_DYNAMIC;
 		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
 		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
@@ -203,6 +248,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
 
+		// The GPU copy has never been written, so all of it is dirty
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = bufferDesc.Size;
+
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
 		{
@@ -278,6 +327,46 @@ SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
 	return result->second;
 }
 
+// --------------------------------------------------------
+// Copies data into a constant buffer's local data, growing
+// its dirty range only if the bytes actually change, so
+// re-setting a value to what it already was costs no upload
+// --------------------------------------------------------
+void ISimpleShader::WriteLocalData(SimpleConstantBuffer* cb, unsigned int byteOffset, const void* data, unsigned int size)
+{
+	unsigned char* destination = cb->LocalDataBuffer + byteOffset;
+	if (memcmp(destination, data, size) == 0)
+		return;
+
+	memcpy(destination, data, size);
+
+	bool clean = cb->DirtyStart == cb->DirtyEnd;
+	if (clean || byteOffset < cb->DirtyStart)
+		cb->DirtyStart = byteOffset;
+	if (clean || byteOffset + size > cb->DirtyEnd)
+		cb->DirtyEnd = byteOffset + size;
+}
+
+// --------------------------------------------------------
+// Copies a constant buffer's local data to the GPU and marks
+// it clean.  WRITE_DISCARD replaces the whole buffer (Direct3D
+// 11.0 can't partially update a constant buffer), but gives
+// fresh memory rather than waiting on draws still using the
+// old contents.
+// --------------------------------------------------------
+void ISimpleShader::UploadBufferData(SimpleConstantBuffer* cb)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (deviceContext->Map(cb->ConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped) != S_OK)
+		return;
+
+	memcpy(mapped.pData, cb->LocalDataBuffer, cb->Size);
+	deviceContext->Unmap(cb->ConstantBuffer.Get(), 0);
+
+	cb->DirtyStart = 0;
+	cb->DirtyEnd = 0;
+}
+
 // --------------------------------------------------------
 // Prints the specified message to the console with the 
 // given color and Visual Studio's output window
@@ -337,21 +426,20 @@ void ISimpleShader::SetShader()
 
 // --------------------------------------------------------
 // Copies the relevant data to the all of this 
-// shader's constant buffers.  To just copy one
-// buffer, use CopyBufferData()
+// shader's constant buffers.  Buffers whose data hasn't
+// changed since their last copy are skipped.  To just
+// copy one buffer, use CopyBufferData()
 // --------------------------------------------------------
 void ISimpleShader::CopyAllBufferData()
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy changed data
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		if (constantBuffers[i].DirtyStart != constantBuffers[i].DirtyEnd)
+			UploadBufferData(&constantBuffers[i]);
 	}
 }
 
@@ -380,9 +468,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBufferData(cb);
 }
 
 // --------------------------------------------------------
@@ -402,9 +488,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBufferData(cb);
 }
 
 
@@ -446,15 +530,95 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 	}
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteLocalData(&constantBuffers[var->ConstantBufferIndex], var->ByteOffset, data, size);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Looks up a variable once, for use with the handle-based
+// setters.  The handle's Size is 0 if it doesn't exist.
+//
+// name - The name of the shader variable
+// --------------------------------------------------------
+SimpleShaderHandle ISimpleShader::GetHandle(std::string name)
+{
+	SimpleShaderHandle handle = {};
+
+	SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var == 0)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::GetHandle() - Shader variable '");
+			Log(name);
+			LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
+		}
+		return handle;
+	}
+
+	handle.ConstantBufferIndex = var->ConstantBufferIndex;
+	handle.ByteOffset = var->ByteOffset;
+	handle.Size = var->Size;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Sets a variable through a handle with arbitrary data of
+// the specified size
+//
+// handle - The variable, from GetHandle()
+// data - The data to set in the buffer
+// size - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if the handle is
+// invalid or the data doesn't fit
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const SimpleShaderHandle& handle, const void* data, unsigned int size)
+{
+	// Also catches handles from another shader that don't
+	// fit this one's buffers
+	if (size > handle.Size ||
+		handle.ConstantBufferIndex >= constantBufferCount ||
+		handle.ByteOffset + size > constantBuffers[handle.ConstantBufferIndex].Size)
+		return false;
+
+	WriteLocalData(&constantBuffers[handle.ConstantBufferIndex], handle.ByteOffset, data, size);
+
+	return true;
+}
+
+bool ISimpleShader::SetInt(const SimpleShaderHandle& handle, int data)
+{
+	return this->SetData(handle, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(const SimpleShaderHandle& handle, float data)
+{
+	return this->SetData(handle, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat2(const SimpleShaderHandle& handle, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 2);
+}
+
+bool ISimpleShader::SetFloat3(const SimpleShaderHandle& handle, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
@@ -962,6 +1126,16 @@ SimplePixelShader::SimplePixelShader(Microsoft::WRL::ComPtr<ID3D11Device> device
 	this->LoadShaderFile(shaderFile);
 }
 
+// --------------------------------------------------------
+// Constructor for bytecode already in memory, such as a
+// permutation from a ShaderArchive
+// --------------------------------------------------------
+SimplePixelShader::SimplePixelShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const void* bytecode, size_t bytecodeSize)
+	: ISimpleShader(device, context)
+{
+	this->LoadShaderBytecode(bytecode, bytecodeSize);
+}
+
 // --------------------------------------------------------
 // Destructor - Clean up actual shader (base will be called automatically)
 // --------------------------------------------------------
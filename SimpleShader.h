@@ -23,6 +23,19 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// A shader variable resolved ahead of time with GetHandle(),
+// so setting it skips the name lookup.  Only valid for the
+// shader it came from.  Size is 0 if the variable wasn't
+// found.
+// --------------------------------------------------------
+struct SimpleShaderHandle
+{
+	unsigned int ConstantBufferIndex;
+	unsigned int ByteOffset;
+	unsigned int Size;
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -37,6 +50,11 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Bytes of LocalDataBuffer changed since the last upload,
+	// as [DirtyStart, DirtyEnd); empty when they're equal
+	unsigned int DirtyStart = 0;
+	unsigned int DirtyEnd = 0;
 };
 
 // --------------------------------------------------------
@@ -68,6 +86,7 @@ public:
 
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
+	unsigned int GetID() { return id; }
 
 	// Activating the shader and copying data
 	void SetShader();
@@ -89,6 +108,19 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Sets shader data through handles from GetHandle(), for
+	// variables set often enough that the lookup matters
+	SimpleShaderHandle GetHandle(std::string name);
+
+	bool SetData(const SimpleShaderHandle& handle, const void* data, unsigned int size);
+
+	bool SetInt(const SimpleShaderHandle& handle, int data);
+	bool SetFloat(const SimpleShaderHandle& handle, float data);
+	bool SetFloat2(const SimpleShaderHandle& handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const SimpleShaderHandle& handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4X4& data);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
 	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
@@ -125,6 +157,7 @@ public:
 protected:
 	
 	bool shaderValid;
+	unsigned int id;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
@@ -141,8 +174,10 @@ protected:
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
-	// Initialization method
+	// Initialization methods
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadShaderBytecode(const void* bytecode, size_t size);
+	bool LoadShaderBlob(LPCWSTR shaderName);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
@@ -154,6 +189,10 @@ protected:
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
 
+	// Helpers for changing and uploading local data
+	void WriteLocalData(SimpleConstantBuffer* cb, unsigned int byteOffset, const void* data, unsigned int size);
+	virtual void UploadBufferData(SimpleConstantBuffer* cb);
+
 	// Error logging
 	void Log(std::string message, WORD color);
 	void LogW(std::wstring message, WORD color);
@@ -198,6 +237,7 @@ class SimplePixelShader : public ISimpleShader
 {
 public:
 	SimplePixelShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile);
+	SimplePixelShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const void* bytecode, size_t bytecodeSize);
 	~SimplePixelShader();
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> GetDirectXShader() { return shader; }
 
@@ -38,7 +38,7 @@ void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_
 	this->vertexShader->SetShader();
 	this->pixelShader->SetShader();
 
-	this->mesh->Draw(camera->GetTransform(), camera);
+	this->mesh->Draw();
 
 	context->RSSetState(nullptr);
 	context->OMSetDepthStencilState(nullptr, 0);
@@ -5,5 +5,7 @@ SamplerState BasicSampler : register(s0);
 
 float4 main(VertexToPixel_Sky input) : SV_TARGET
 {
-	return Skybox.Sample(BasicSampler, input.sampleDir);
+	// Decoded to linear, like the albedo in PixelShader
+	float4 skyColor = Skybox.Sample(BasicSampler, input.sampleDir);
+	return float4(pow(skyColor.rgb, 2.2), 1);
 }
\ No newline at end of file
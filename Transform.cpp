@@ -9,6 +9,8 @@ Transform::Transform()
 
 	DirectX::XMStoreFloat4x4(&worldMatrix, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixIdentity());
+	this->matricesDirty = true;
+	this->parent = 0;
 }
 
 Transform::Transform(DirectX::XMFLOAT3 position)
@@ -19,6 +21,8 @@ Transform::Transform(DirectX::XMFLOAT3 position)
 	
 	DirectX::XMStoreFloat4x4(&worldMatrix, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixIdentity());
+	this->matricesDirty = true;
+	this->parent = 0;
 }
 
 Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale)
@@ -29,6 +33,8 @@ Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale)
 	
 	DirectX::XMStoreFloat4x4(&worldMatrix, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixIdentity());
+	this->matricesDirty = true;
+	this->parent = 0;
 }
 
 Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation)
@@ -39,6 +45,8 @@ Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation)
 	
 	DirectX::XMStoreFloat4x4(&worldMatrix, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixIdentity());
+	this->matricesDirty = true;
+	this->parent = 0;
 }
 
 Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT4 rotation)
@@ -49,30 +57,130 @@ Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, Direct
 	
 	DirectX::XMStoreFloat4x4(&worldMatrix, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixIdentity());
+	this->matricesDirty = true;
+	this->parent = 0;
 }
 
+Transform::Transform(const Transform& other)
+{
+	this->position = other.position;
+	this->scale = other.scale;
+	this->rotation = other.rotation;
+	this->worldMatrix = other.worldMatrix;
+	this->worldInverseTransposeMatrix = other.worldInverseTransposeMatrix;
+
+	// The copy starts out detached, so its cached matrices
+	// (which may include the other's ancestors) are stale
+	this->matricesDirty = true;
+	this->parent = 0;
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+	if (this == &other)
+		return *this;
+
+	// Keep our own place in the hierarchy, only take the values
+	this->position = other.position;
+	this->scale = other.scale;
+	this->rotation = other.rotation;
+	this->MarkDirty();
+	return *this;
+}
+
+// --------------------------------------------------------
+// Detaches from the parent, and leaves any children as roots
+// --------------------------------------------------------
 Transform::~Transform()
 {
+	this->SetParent(0);
+
+	for (unsigned int i = 0; i < this->children.size(); i++)
+	{
+		this->children[i]->parent = 0;
+		this->children[i]->MarkDirty();
+	}
+}
+
+// --------------------------------------------------------
+// Attaches this transform to a new parent (or makes it a root
+// when parent is null).  Position, rotation and scale are kept
+// as they are, now relative to the new parent.  Requests that
+// would create a cycle are ignored.
+// --------------------------------------------------------
+void Transform::SetParent(Transform* parent)
+{
+	if (parent == this->parent)
+		return;
+
+	// Parenting to itself or to any of its descendants would
+	// loop forever in UpdateMatrices(), so walk up the new
+	// parent's chain even for a leaf
+	for (Transform* ancestor = parent; ancestor != 0; ancestor = ancestor->parent)
+	{
+		if (ancestor == this)
+			return;
+	}
+
+	if (this->parent)
+	{
+		// Searched from the back, as children are most often
+		// detached in the reverse order they were attached
+		std::vector<Transform*>& siblings = this->parent->children;
+		for (size_t i = siblings.size(); i-- > 0;)
+		{
+			if (siblings[i] == this)
+			{
+				siblings.erase(siblings.begin() + i);
+				break;
+			}
+		}
+	}
+
+	this->parent = parent;
+	if (parent)
+		parent->children.push_back(this);
+
+	this->MarkDirty();
+}
+
+Transform* Transform::GetParent()
+{
+	return this->parent;
+}
+
+Transform* Transform::GetChild(unsigned int index)
+{
+	return index < this->children.size() ? this->children[index] : 0;
+}
+
+unsigned int Transform::GetChildCount()
+{
+	return (unsigned int)this->children.size();
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
 	this->position = DirectX::XMFLOAT3(x, y, z);
+	this->MarkDirty();
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
 	this->rotation = DirectX::XMFLOAT4(pitch, yaw, roll, 1);
+	this->MarkDirty();
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
 	this->scale = DirectX::XMFLOAT3(x, y, z);
+	this->MarkDirty();
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
 	this->position = DirectX::XMFLOAT3(this->position.x + x, this->position.y + y, this->position.z + z);
+	this->MarkDirty();
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -82,16 +190,19 @@ void Transform::MoveRelative(float x, float y, float z)
 	DirectX::XMVECTOR rotatedDirection = DirectX::XMVector3Rotate(direction, rotation);
 	rotatedDirection = DirectX::XMVectorAdd(rotatedDirection, DirectX::XMLoadFloat3(&(this->position)));
 	DirectX::XMStoreFloat3(&(this->position), rotatedDirection);
+	this->MarkDirty();
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
 {	
 	this->rotation = DirectX::XMFLOAT4(this->rotation.x + pitch, this->rotation.y + yaw, this->rotation.z + roll, 1);
+	this->MarkDirty();
 }
 
 void Transform::Scale(float x, float y, float z)
 {
 	this->scale = DirectX::XMFLOAT3(this->scale.x + x, this->scale.y + y, this->scale.z + z);
+	this->MarkDirty();
 }
 
 DirectX::XMFLOAT3 Transform::GetPosition()
@@ -141,30 +252,135 @@ DirectX::XMFLOAT3 Transform::GetForward()
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	this->UpdateMatrices();
+	if (this->matricesDirty)
+		this->UpdateMatrices();
 	return worldMatrix;
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	this->UpdateMatrices();
+	if (this->matricesDirty)
+		this->UpdateMatrices();
 	return worldInverseTransposeMatrix;
 }
 
+// --------------------------------------------------------
+// Builds scale * rotation * translation and its inverse
+// transpose from the given local values
+//
+// Since the matrix is always a TRS, its inverse transpose has
+// a closed form: the rotation rows divided by their scale,
+// with -(row . translation) in the last column.  No general
+// 4x4 inverse is needed.
+// --------------------------------------------------------
+void Transform::BuildLocalMatrices(
+	DirectX::XMFLOAT3 position,
+	DirectX::XMFLOAT3 pitchYawRoll,
+	DirectX::XMFLOAT3 scale,
+	DirectX::XMMATRIX& local,
+	DirectX::XMMATRIX& localInverseTranspose)
+{
+	DirectX::XMMATRIX rotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+	DirectX::XMVECTOR translation = DirectX::XMVectorSet(position.x, position.y, position.z, 1.0f);
+
+	// Scale * rotation * translation
+	local.r[0] = DirectX::XMVectorScale(rotationMatrix.r[0], scale.x);
+	local.r[1] = DirectX::XMVectorScale(rotationMatrix.r[1], scale.y);
+	local.r[2] = DirectX::XMVectorScale(rotationMatrix.r[2], scale.z);
+	local.r[3] = translation;
+
+	// Inverse transpose = rotation rows / scale, with the
+	// translation folded into the last column
+	localInverseTranspose.r[0] = DirectX::XMVectorScale(rotationMatrix.r[0], 1.0f / scale.x);
+	localInverseTranspose.r[1] = DirectX::XMVectorScale(rotationMatrix.r[1], 1.0f / scale.y);
+	localInverseTranspose.r[2] = DirectX::XMVectorScale(rotationMatrix.r[2], 1.0f / scale.z);
+	for (int i = 0; i < 3; i++)
+	{
+		DirectX::XMVECTOR offset = DirectX::XMVectorNegate(DirectX::XMVector3Dot(localInverseTranspose.r[i], translation));
+		localInverseTranspose.r[i] = DirectX::XMVectorSelect(localInverseTranspose.r[i], offset, DirectX::g_XMSelect0001);
+	}
+	localInverseTranspose.r[3] = DirectX::g_XMIdentityR3;
+}
+
+// --------------------------------------------------------
+// Marks this transform and its whole subtree as needing new
+// matrices.  A dirty transform's descendants are always dirty
+// as well, so already-dirty branches are skipped.
+// --------------------------------------------------------
+void Transform::MarkDirty()
+{
+	if (this->matricesDirty)
+		return;
+
+	this->matricesDirty = true;
+	if (this->children.empty())
+		return;
+
+	// Explicit stack, since hierarchies can be far deeper
+	// than the call stack allows
+	std::vector<Transform*> pending(this->children);
+	while (!pending.empty())
+	{
+		Transform* transform = pending.back();
+		pending.pop_back();
+
+		if (transform->matricesDirty)
+			continue;
+
+		transform->matricesDirty = true;
+		pending.insert(pending.end(), transform->children.begin(), transform->children.end());
+	}
+}
+
+// --------------------------------------------------------
+// Rebuilds both cached matrices, along with those of any
+// dirty ancestors (top-down, since each needs its parent's)
+// --------------------------------------------------------
 void Transform::UpdateMatrices()
 {
-	DirectX::XMMATRIX translationMatrix = DirectX::XMMatrixTranslation(this->position.x, this->position.y, this->position.z);
-	DirectX::XMMATRIX rotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(this->rotation.x, this->rotation.y, this->rotation.z);
-	DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(this->scale.x, this->scale.y, this->scale.z);
-	DirectX::XMMATRIX world = scaleMatrix * rotationMatrix * translationMatrix;
+	if (this->parent && this->parent->matricesDirty)
+	{
+		std::vector<Transform*> dirtyAncestors;
+		for (Transform* ancestor = this->parent; ancestor && ancestor->matricesDirty; ancestor = ancestor->parent)
+			dirtyAncestors.push_back(ancestor);
+
+		for (size_t i = dirtyAncestors.size(); i-- > 0;)
+			dirtyAncestors[i]->RebuildMatrices();
+	}
+
+	this->RebuildMatrices();
+}
+
+// --------------------------------------------------------
+// Rebuilds this transform's matrices alone, assuming the
+// parent's are already up to date
+// --------------------------------------------------------
+void Transform::RebuildMatrices()
+{
+	DirectX::XMFLOAT3 pitchYawRoll(this->rotation.x, this->rotation.y, this->rotation.z);
+	DirectX::XMMATRIX world, inverseTranspose;
+	BuildLocalMatrices(this->position, pitchYawRoll, this->scale, world, inverseTranspose);
+
+	// World = local * parent's world, and the inverse
+	// transpose of a product is the product of theirs
+	if (this->parent)
+	{
+		world = DirectX::XMMatrixMultiply(world, DirectX::XMLoadFloat4x4(&this->parent->worldMatrix));
+		inverseTranspose = DirectX::XMMatrixMultiply(inverseTranspose, DirectX::XMLoadFloat4x4(&this->parent->worldInverseTransposeMatrix));
+	}
 
-	DirectX::XMStoreFloat4x4(&worldMatrix, world);
-	DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixInverse(0, DirectX::XMMatrixTranspose(world)));
+	DirectX::XMStoreFloat4x4(&this->worldMatrix, world);
+	DirectX::XMStoreFloat4x4(&this->worldInverseTransposeMatrix, inverseTranspose);
+	this->matricesDirty = false;
 }
 
 void Transform::ClampPitch(float min, float max) 
 {
 	float pitch = this->rotation.x;
 	pitch = std::max(min, std::min(pitch, max));
-	this->rotation.x = pitch;
+	if (pitch != this->rotation.x)
+	{
+		this->rotation.x = pitch;
+		this->MarkDirty();
+	}
 }
\ No newline at end of file
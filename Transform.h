@@ -3,6 +3,7 @@
 
 #include <DirectXMath.h>
 #include <math.h>
+#include <vector>
 
 class Transform {
 public:
@@ -11,8 +12,16 @@ public:
 	Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale);
 	Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation);
 	Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT4 rotation);
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
 	~Transform();
 
+	// Hierarchy - copies never carry their parent or children
+	void SetParent(Transform* parent);
+	Transform* GetParent();
+	Transform* GetChild(unsigned int index);
+	unsigned int GetChildCount();
+
 	void SetPosition(float x, float y, float z);
 	void SetRotation(float pitch, float yaw, float roll);
 	void SetScale(float x, float y, float z);
@@ -31,11 +40,22 @@ public:
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
 
+	// Position, rotation and scale are relative to the parent,
+	// while these matrices include all of its ancestors
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 
+	static void BuildLocalMatrices(
+		DirectX::XMFLOAT3 position,
+		DirectX::XMFLOAT3 pitchYawRoll,
+		DirectX::XMFLOAT3 scale,
+		DirectX::XMMATRIX& local,
+		DirectX::XMMATRIX& localInverseTranspose);
+
 private:
+	void MarkDirty();
 	void UpdateMatrices();
+	void RebuildMatrices();
 	DirectX::XMMATRIX XMMatrixTranslation();
 	DirectX::XMMATRIX XMMatrixScaling();
 	DirectX::XMMATRIX XMMatrixRotationRollPitchYaw();
@@ -46,4 +66,12 @@ private:
 	DirectX::XMFLOAT3 position;
 	DirectX::XMFLOAT3 scale;
 	DirectX::XMFLOAT4 rotation;
+
+	// Set whenever position, rotation or scale change (here or
+	// on any ancestor), so the matrices are only rebuilt when
+	// they're actually needed
+	bool matricesDirty;
+
+	Transform* parent;
+	std::vector<Transform*> children;
 };
\ No newline at end of file
@@ -1,9 +1,14 @@
 #include "ShaderStructs.hlsli"
 
-cbuffer ExternalData : register(b0) {
-	matrix worldMatrix;
+// Set once per frame
+cbuffer PerFrame : register(b0) {
 	matrix viewMatrix;
 	matrix projectionMatrix;
+}
+
+// Set for every object drawn
+cbuffer PerObject : register(b1) {
+	matrix worldMatrix;
 	matrix worldInvTranspose;
 }
 